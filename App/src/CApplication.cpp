@@ -8,6 +8,7 @@
 #include "video/CVideoCamera.hpp"
 #include "video/CVideoFile.hpp"
 #include "detector/CDetector.hpp"
+#include "detector/CSquareDetector.hpp"
 #include "renderer/CRenderer.hpp"
 
 namespace NApp
@@ -18,10 +19,15 @@ const unsigned int CApplication::WINDOW_WIDTH = 640u;
 const unsigned int CApplication::COLORBITS = 32u;
 const unsigned int CApplication::MULTISAMPLING = 4u;
 const std::string CApplication::MODELS_CONFIGURATION_PATH("my_file.txt");
+const DetectorType::EType CApplication::DEFAULT_DETECTOR = DetectorType::ALVAR;
+const std::string CApplication::ICON_PATH("data/icon.png");
  
 CApplication::CApplication()
    : mSurface(0)
    , mStartTime(0)
+   , mDetectorType(DEFAULT_DETECTOR)
+   , mPreprocessing(false)
+   , mIcon(INVALID_IMAGE)
 {
 }
 
@@ -89,10 +95,9 @@ bool CApplication::createComponents(int argc, const char argv[])
       return false;
    }
 
-   mDetector = std::make_shared<CDetector>();
-   if (false == mDetector->initialize())
+   if (false == createDetector(mDetectorType))
    {
-      std::cerr << "mDetector->initialize() failed." << std::endl;
+      std::cerr << "createDetector() failed." << std::endl;
       return false;
    }
 
@@ -122,6 +127,29 @@ bool CApplication::createComponents(int argc, const char argv[])
       return false;
    }
 
+   mIcon = mRenderer->loadImage(ICON_PATH);
+
+   return true;
+}
+
+bool CApplication::createDetector(DetectorType::EType type)
+{
+   std::shared_ptr<IDetector> detector;
+   switch (type)
+   {
+   case DetectorType::SQUARE: detector = std::make_shared<CSquareDetector>(); break;
+   case DetectorType::ALVAR:
+   default:                   detector = std::make_shared<CDetector>(); break;
+   }
+
+   if (false == detector->initialize())
+   {
+      std::cerr << "detector->initialize() failed." << std::endl;
+      return false;
+   }
+
+   mDetector = detector;
+   mDetectorType = type;
    return true;
 }
  
@@ -200,6 +228,18 @@ void CApplication::runMainLoop()
             case SDLK_DOWN:  mRenderer->translateModel(glm::vec3(  0, 0,  2)); break;
            
 			case SDLK_SPACE: mRenderer->screenshot(); break;
+
+            case SDLK_F2:
+               createDetector(
+                  (DetectorType::ALVAR == mDetectorType) ? DetectorType::SQUARE : DetectorType::ALVAR);
+               break;
+
+            case SDLK_F3:
+               if (true == mRenderer->enablePreprocessing(!mPreprocessing))
+               {
+                  mPreprocessing = !mPreprocessing;
+               }
+               break;
 				 
 
 				
@@ -240,6 +280,16 @@ bool CApplication::performTask()
       return false;
    }
 
+   // transfer to GPU goes in parallel with detection
+   mRenderer->uploadFrame(*frame);
+
+   cv::Mat binary;
+   cv::Mat source;
+   if (true == mRenderer->getPreprocessedFrame(binary, source))
+   {
+      mDetector->setPreprocessedFrame(binary, source);
+   }
+
    std::shared_ptr<CMarkersData> markers = mDetector->detect(*frame);
    if (0 == markers)
    {
@@ -250,14 +300,36 @@ bool CApplication::performTask()
 
    mRenderer->render(ellapsed, *frame, *markers);
 
-   IconData icon = IconData::loadFromFile("data/icon.png");
-   mRenderer->renderIcon(icon, glm::ivec2(10, 10));
+   mRenderer->renderIcon(mIcon, glm::ivec2(10, 10));
    
 
    //mRenderer->renderText(FontSize::SMALL, "SAR!", glm::ivec2(40, 20), glm::ivec3(20, 255, 30));
 
+   mRenderer->finishFrame();
+
    std::stringstream sstr;
-   sstr << "FPS: " << mRenderer->getFps(); 
+   sstr << "FPS: " << mRenderer->getFps()
+        << " | " << ((DetectorType::ALVAR == mDetectorType) ? "ALVAR" : "SQUARE") << " (F2)";
+
+   const RenderStats renderStats = mRenderer->getStats();
+   sstr << " | draws: " << renderStats.DrawCalls
+        << " | states: " << renderStats.StateChanges
+        << " | lookups: " << renderStats.NameLookups
+        << " | uniforms: " << renderStats.UniformBytes << " B"
+        << " | models: " << renderStats.ResidentModels << ", " << renderStats.ModelMemory / 1024 << " MB";
+
+   const DetectorStats stats = mDetector->getStats();
+   if (0. != stats.PreprocessTime)
+   {
+      sstr.precision(2);
+      sstr << std::fixed
+           << " | " << (stats.UsesPreprocessedFrame ? "GPU" : "CPU") << " prep (F3): "
+           << stats.PreprocessTime << " ms";
+      if (true == stats.UsesPreprocessedFrame)
+      {
+         sstr << ", saved " << (stats.CpuPreprocessTime - stats.PreprocessTime) << " ms";
+      }
+   }
    SDL_WM_SetCaption(sstr.str().c_str(), "");
 
    return true;
@@ -2,6 +2,8 @@
 
 #include <memory> // for std::shared_ptr
 #include <string>
+#include "detector/IDetector.hpp"
+#include "renderer/IRenderer.hpp"
  
 
 struct SDL_Surface;
@@ -10,7 +12,6 @@ namespace NApp
 {
 
 class IVideo;
-class IDetector;
 class IRenderer;
 
 /** Implements application logic. */
@@ -32,6 +33,12 @@ private:
 
    bool createComponents(int argc, const char argv[]);
 
+   /**
+    * (Re)create markers detector of given type.
+    * @return true if succes, false - otherwise (previous detector is kept).
+    */
+   bool createDetector(DetectorType::EType type);
+
    void runMainLoop();
    void Screenshot(int w, int h);
 
@@ -43,10 +50,15 @@ private:
    static const unsigned int COLORBITS;
    static const unsigned int MULTISAMPLING;
    static const std::string  MODELS_CONFIGURATION_PATH;
+   static const DetectorType::EType DEFAULT_DETECTOR;
+   static const std::string  ICON_PATH;
 
 private:
    SDL_Surface * mSurface;
    unsigned int mStartTime;
+   DetectorType::EType mDetectorType;
+   bool mPreprocessing;
+   tImageHandle mIcon;
 
    std::shared_ptr<IVideo>    mVideo;
    std::shared_ptr<IDetector> mDetector;
@@ -1,5 +1,5 @@
-#include <glm/gtc/type_ptr.hpp>
 #include "detector/CDetector.hpp"
+#include "detector/CPoseUtils.hpp"
 
 namespace NApp
 {
@@ -27,40 +27,7 @@ std::shared_ptr<CMarkersData> CDetector::detect(const CFrame & frame)
    {
       alvar::MarkerData & marker = (*mMarkerDetector.markers)[i];
 
-      unsigned int id = marker.GetId();
-      alvar::Pose & pose = marker.pose;
-
-      double tmpQuat[4];
-      CvMat quat = cvMat(4, 1, CV_64F, tmpQuat);
-      pose.GetQuaternion(&quat);
-
-      double tmpTrans[3];
-      CvMat trans = cvMat(3, 1, CV_64F, tmpTrans);
-      pose.GetTranslation(&trans);
-
-      double tmpView[16] = { 0 };
-      pose.GetMatrixGL(tmpView);
-      float tmpViewF[16] = {
-         tmpView[0],  tmpView[1],  tmpView[2],  tmpView[3],
-         tmpView[4],  tmpView[5],  tmpView[6],  tmpView[7],
-         tmpView[8],  tmpView[9],  tmpView[10], tmpView[11],
-         tmpView[12], tmpView[13], tmpView[14], tmpView[15],
-      };
-      glm::mat4 view = glm::make_mat4(tmpViewF);
-
-      markers.push_back(Marker(
-         id,
-         view,
-         glm::quat(
-            (float)cvmGet(&quat, 0, 0),
-            (float)cvmGet(&quat, 1, 0),
-            (float)cvmGet(&quat, 2, 0),
-            (float)cvmGet(&quat, 3, 0)),
-         glm::vec3(
-            (float)cvmGet(&trans, 0, 0),
-            (float)cvmGet(&trans, 1, 0),
-            (float)cvmGet(&trans, 2, 0))
-         ));
+      markers.push_back(createMarker(marker.GetId(), marker.pose));
    }
 
    return std::shared_ptr<CMarkersData>(new CMarkersData(markers));
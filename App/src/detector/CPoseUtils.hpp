@@ -0,0 +1,50 @@
+#pragma once
+
+#include <glm/gtc/type_ptr.hpp>
+#include <ALVAR/Pose.h>
+#include "detector/CMarkersData.hpp"
+
+namespace NApp
+{
+
+/**
+ * Convert ALVAR pose of detected marker to renderer marker description.
+ * @param id marker identifier
+ * @param pose estimated pose of marker
+ * @return marker with OpenGL view matrix, rotation and translation.
+ */
+inline
+Marker createMarker(unsigned int id, alvar::Pose & pose)
+{
+   double tmpQuat[4];
+   CvMat quat = cvMat(4, 1, CV_64F, tmpQuat);
+   pose.GetQuaternion(&quat);
+
+   double tmpTrans[3];
+   CvMat trans = cvMat(3, 1, CV_64F, tmpTrans);
+   pose.GetTranslation(&trans);
+
+   double tmpView[16] = { 0 };
+   pose.GetMatrixGL(tmpView);
+   float tmpViewF[16];
+   for (int i = 0; i < 16; ++i)
+   {
+      tmpViewF[i] = (float)tmpView[i];
+   }
+   glm::mat4 view = glm::make_mat4(tmpViewF);
+
+   return Marker(
+      id,
+      view,
+      glm::quat(
+         (float)cvmGet(&quat, 0, 0),
+         (float)cvmGet(&quat, 1, 0),
+         (float)cvmGet(&quat, 2, 0),
+         (float)cvmGet(&quat, 3, 0)),
+      glm::vec3(
+         (float)cvmGet(&trans, 0, 0),
+         (float)cvmGet(&trans, 1, 0),
+         (float)cvmGet(&trans, 2, 0)));
+}
+
+} /* namespace NApp */
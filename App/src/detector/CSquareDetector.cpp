@@ -0,0 +1,666 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "detector/CSquareDetector.hpp"
+#include "detector/CPoseUtils.hpp"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define NAPP_SQUARE_DETECTOR_SSE2
+#endif
+
+namespace NApp
+{
+
+const int   CSquareDetector::THRESHOLD_RADIUS = 15;
+const float CSquareDetector::THRESHOLD_OFFSET = 5.f;
+const int   CSquareDetector::MIN_PERIMETER = 40;
+const float CSquareDetector::MIN_AREA = 100.f;
+const float CSquareDetector::MAX_MARKER_ERROR = 0.08f;
+/** With preprocessed frames CPU path still runs every n-th frame to measure the saving. */
+const unsigned int CSquareDetector::REFERENCE_INTERVAL = 30u;
+
+/** Same marker geometry as default of alvar::MarkerDetector. */
+static const double MARKER_EDGE_LENGTH = 1.0;
+static const int    MARKER_RESOLUTION = 5;
+static const double MARKER_MARGIN = 2.0;
+
+/** Border following directions: E, NE, N, NW, W, SW, S, SE (y axis points down). */
+static const int DELTA_X[8] = { 1,  1,  0, -1, -1, -1, 0, 1 };
+static const int DELTA_Y[8] = { 0, -1, -1, -1,  0,  1, 1, 1 };
+
+/** Part of each quad side that is skipped near corners by line fitting. */
+static const float EDGE_CORNER_SKIP = 0.15f;
+
+/** Weight of new value in averaged timings. */
+static const double TIME_SMOOTHING = 0.1;
+
+static double elapsedMs(int64 start)
+{
+   return (cv::getTickCount() - start) * 1000. / cv::getTickFrequency();
+}
+
+static void updateAverage(double & average, double value)
+{
+   average = (0. == average) ? value : (1. - TIME_SMOOTHING) * average + TIME_SMOOTHING * value;
+}
+
+/**
+ * Marks pixel as foreground when it is darker than mean of the
+ * (2 * radius + 1)^2 window around it minus offset.
+ */
+class ThresholdBody : public cv::ParallelLoopBody
+{
+public:
+   ThresholdBody(
+         const cv::Mat & gray,
+         const cv::Mat & integral,
+         cv::Mat & binary,
+         int radius,
+         float offset)
+      : mGray(gray)
+      , mIntegral(integral)
+      , mBinary(binary)
+      , mRadius(radius)
+      , mOffset(offset)
+   {
+   }
+
+   virtual void operator()(const cv::Range & range) const
+   {
+      const int width = mGray.cols;
+      const int height = mGray.rows;
+
+      // columns which window does not cross left and right image border
+      const int interiorBegin = std::min(mRadius, width);
+      const int interiorEnd = std::max(width - mRadius, interiorBegin);
+
+      for (int y = range.start; y < range.end; ++y)
+      {
+         const int y1 = std::max(y - mRadius, 0);
+         const int y2 = std::min(y + mRadius + 1, height);
+         const int * top = mIntegral.ptr<int>(y1);
+         const int * bottom = mIntegral.ptr<int>(y2);
+         const uchar * src = mGray.ptr<uchar>(y);
+         uchar * dst = mBinary.ptr<uchar>(y);
+
+         int x = 0;
+         for (; x < interiorBegin; ++x)
+         {
+            dst[x] = thresholdPixel(top, bottom, src, x, y2 - y1);
+         }
+
+#ifdef NAPP_SQUARE_DETECTOR_SSE2
+         const __m128 invArea = _mm_set1_ps(1.f / ((y2 - y1) * (2 * mRadius + 1)));
+         const __m128 offset = _mm_set1_ps(mOffset);
+         const __m128i zero = _mm_setzero_si128();
+
+         for (; x + 4 <= interiorEnd; x += 4)
+         {
+            const __m128i a = _mm_loadu_si128((const __m128i *)(bottom + x + mRadius + 1));
+            const __m128i b = _mm_loadu_si128((const __m128i *)(bottom + x - mRadius));
+            const __m128i c = _mm_loadu_si128((const __m128i *)(top + x + mRadius + 1));
+            const __m128i d = _mm_loadu_si128((const __m128i *)(top + x - mRadius));
+            const __m128i sum = _mm_add_epi32(_mm_sub_epi32(a, b), _mm_sub_epi32(d, c));
+            const __m128 mean = _mm_mul_ps(_mm_cvtepi32_ps(sum), invArea);
+
+            int pixels;
+            memcpy(&pixels, src + x, sizeof(pixels));
+            __m128i value = _mm_unpacklo_epi8(_mm_cvtsi32_si128(pixels), zero);
+            value = _mm_unpacklo_epi16(value, zero);
+
+            __m128i mask = _mm_castps_si128(
+               _mm_cmplt_ps(_mm_add_ps(_mm_cvtepi32_ps(value), offset), mean));
+            mask = _mm_packs_epi32(mask, mask);
+            mask = _mm_packs_epi16(mask, mask);
+
+            const int result = _mm_cvtsi128_si32(mask);
+            memcpy(dst + x, &result, sizeof(result));
+         }
+#endif
+
+         for (; x < width; ++x)
+         {
+            dst[x] = thresholdPixel(top, bottom, src, x, y2 - y1);
+         }
+      }
+   }
+
+private:
+   uchar thresholdPixel(
+      const int * top,
+      const int * bottom,
+      const uchar * src,
+      int x,
+      int windowHeight) const
+   {
+      const int x1 = std::max(x - mRadius, 0);
+      const int x2 = std::min(x + mRadius + 1, mGray.cols);
+      const int sum = bottom[x2] - bottom[x1] - top[x2] + top[x1];
+      const float mean = (float)sum / ((x2 - x1) * windowHeight);
+
+      return (src[x] + mOffset < mean) ? 255 : 0;
+   }
+
+private:
+   const cv::Mat & mGray;
+   const cv::Mat & mIntegral;
+   cv::Mat & mBinary;
+   int mRadius;
+   float mOffset;
+};
+
+static float cross(const cv::Point2f & a, const cv::Point2f & b)
+{
+   return a.x * b.y - a.y * b.x;
+}
+
+/** Distance from point to line through a and b (a != b). */
+static float distanceToLine(const cv::Point2f & p, const cv::Point2f & a, const cv::Point2f & b)
+{
+   const cv::Point2f ab = b - a;
+   return std::fabs(cross(ab, p - a)) / std::sqrt(ab.dot(ab));
+}
+
+/** Index of contour point farthest from point. */
+static size_t findFarthest(const std::vector<cv::Point> & contour, const cv::Point & point)
+{
+   size_t result = 0;
+   int maxDistance = -1;
+   for (size_t i = 0; i < contour.size(); ++i)
+   {
+      const cv::Point d = contour[i] - point;
+      const int distance = d.dot(d);
+      if (distance > maxDistance)
+      {
+         maxDistance = distance;
+         result = i;
+      }
+   }
+   return result;
+}
+
+/** Index of point of cyclic arc [begin, end) farthest from line through a and b. */
+static size_t findFarthestFromLine(
+   const std::vector<cv::Point> & contour,
+   size_t begin,
+   size_t end,
+   float & maxDistance)
+{
+   const cv::Point2f a = contour[begin];
+   const cv::Point2f b = contour[end];
+   size_t result = begin;
+   maxDistance = 0.f;
+   for (size_t i = begin; i != end; i = (i + 1) % contour.size())
+   {
+      const float distance = distanceToLine(contour[i], a, b);
+      if (distance > maxDistance)
+      {
+         maxDistance = distance;
+         result = i;
+      }
+   }
+   return result;
+}
+
+/**
+ * Least squares line through points of cyclic arc [begin, end),
+ * skipping points near the ends.
+ * @return false if there are too few points.
+ */
+static bool fitLine(
+   const std::vector<cv::Point> & contour,
+   size_t begin,
+   size_t end,
+   cv::Point2f & origin,
+   cv::Point2f & direction)
+{
+   const size_t n = contour.size();
+   const size_t length = (end + n - begin) % n;
+   const size_t skip = std::max<size_t>(1, (size_t)(length * EDGE_CORNER_SKIP));
+   if (length < 2 * skip + 3)
+   {
+      return false;
+   }
+
+   float sx = 0.f, sy = 0.f;
+   size_t count = 0;
+   for (size_t k = skip; k < length - skip; ++k, ++count)
+   {
+      const cv::Point & p = contour[(begin + k) % n];
+      sx += p.x;
+      sy += p.y;
+   }
+   origin = cv::Point2f(sx / count, sy / count);
+
+   float sxx = 0.f, sxy = 0.f, syy = 0.f;
+   for (size_t k = skip; k < length - skip; ++k)
+   {
+      const cv::Point & p = contour[(begin + k) % n];
+      const cv::Point2f d((float)p.x - origin.x, (float)p.y - origin.y);
+      sxx += d.x * d.x;
+      sxy += d.x * d.y;
+      syy += d.y * d.y;
+   }
+
+   const float angle = 0.5f * std::atan2(2.f * sxy, sxx - syy);
+   direction = cv::Point2f(std::cos(angle), std::sin(angle));
+   return true;
+}
+
+CSquareDetector::CSquareDetector()
+   : mScale(1)
+   , mFrameCount(0)
+{
+}
+
+bool CSquareDetector::initialize()
+{
+   return true;
+}
+
+void CSquareDetector::setPreprocessedFrame(const cv::Mat & binary, const cv::Mat & source)
+{
+   mPreprocessed = binary;
+   mSource = source;
+}
+
+DetectorStats CSquareDetector::getStats() const
+{
+   return mStats;
+}
+
+std::shared_ptr<CMarkersData> CSquareDetector::detect(const CFrame & frame)
+{
+   std::vector<Marker> markers;
+
+   int64 start = cv::getTickCount();
+
+   // binary image comes from earlier frame, corners and content are taken from it too
+   mScale = getPreprocessedScale(mSource);
+   const bool usePreprocessed = (0 != mScale);
+   const cv::Mat img = (true == usePreprocessed) ? mSource : frame.getMat();
+   const cv::Rect frameRect(0, 0, img.cols, img.rows);
+   mSource.release();
+   if (true == usePreprocessed)
+   {
+      cv::swap(mBinary, mPreprocessed);
+      mPreprocessed.release();
+      clearBorder(mBinary);
+      mGray.create(img.size(), CV_8U);
+   }
+   else
+   {
+      mScale = 1;
+      convertGray(img, frameRect);
+      computeIntegral();
+      computeThreshold(mBinary);
+   }
+   double preprocessTime = elapsedMs(start);
+
+   findContours();
+
+   std::vector<tQuad> quads;
+   for (size_t i = 0; i < mContours.size(); ++i)
+   {
+      tQuad quad;
+      if (true == fitQuad(mContours[i], quad))
+      {
+         quads.push_back(quad);
+      }
+   }
+
+   // back to frame coordinates
+   const int window = 1 + 2 * mScale;
+   std::vector<cv::Point2f> corners;
+   start = cv::getTickCount();
+   for (size_t i = 0; i < quads.size(); ++i)
+   {
+      for (int k = 0; k < 4; ++k)
+      {
+         quads[i][k] = (quads[i][k] + cv::Point2f(0.5f, 0.5f)) * (float)mScale - cv::Point2f(0.5f, 0.5f);
+      }
+      corners.insert(corners.end(), quads[i].begin(), quads[i].end());
+
+      if (true == usePreprocessed)
+      {
+         cv::Rect roi = cv::boundingRect(quads[i]);
+         roi.x -= window + 2;
+         roi.y -= window + 2;
+         roi.width += 2 * (window + 2);
+         roi.height += 2 * (window + 2);
+         convertGray(img, roi & frameRect);
+      }
+   }
+   preprocessTime += elapsedMs(start);
+
+   if (false == corners.empty())
+   {
+      cv::cornerSubPix(
+         mGray,
+         corners,
+         cv::Size(window, window),
+         cv::Size(-1, -1),
+         cv::TermCriteria(CV_TERMCRIT_EPS | CV_TERMCRIT_ITER, 10, 0.01));
+   }
+
+   for (size_t i = 0; i < quads.size(); ++i)
+   {
+      std::copy(corners.begin() + 4 * i, corners.begin() + 4 * (i + 1), quads[i].begin());
+      decodeMarker(quads[i], markers);
+   }
+
+   updateAverage(mStats.PreprocessTime, preprocessTime);
+   mStats.UsesPreprocessedFrame = usePreprocessed;
+   if (false == usePreprocessed)
+   {
+      updateAverage(mStats.CpuPreprocessTime, preprocessTime);
+   }
+   else if (0 == mFrameCount % REFERENCE_INTERVAL)
+   {
+      start = cv::getTickCount();
+      convertGray(img, frameRect);
+      computeIntegral();
+      computeThreshold(mReference);
+      updateAverage(mStats.CpuPreprocessTime, elapsedMs(start));
+   }
+   ++mFrameCount;
+
+   return std::shared_ptr<CMarkersData>(new CMarkersData(markers));
+}
+
+int CSquareDetector::getPreprocessedScale(const cv::Mat & frame) const
+{
+   if (true == mPreprocessed.empty() || CV_8U != mPreprocessed.type())
+   {
+      return 0;
+   }
+
+   const int scale = frame.cols / mPreprocessed.cols;
+   if ( 0 == scale
+     || frame.cols / scale != mPreprocessed.cols
+     || frame.rows / scale != mPreprocessed.rows)
+   {
+      return 0;
+   }
+   return scale;
+}
+
+void CSquareDetector::convertGray(const cv::Mat & frame, const cv::Rect & roi)
+{
+   mGray.create(frame.size(), CV_8U);
+   if (roi.width <= 0 || roi.height <= 0)
+   {
+      return;
+   }
+
+   cv::Mat gray = mGray(roi);
+   if (1 == frame.channels())
+   {
+      frame(roi).copyTo(gray);
+   }
+   else
+   {
+      cv::cvtColor(frame(roi), gray, CV_RGB2GRAY);
+   }
+}
+
+void CSquareDetector::computeIntegral()
+{
+   const int width = mGray.cols;
+   const int height = mGray.rows;
+
+   mIntegral.create(height + 1, width + 1, CV_32S);
+   memset(mIntegral.ptr<int>(0), 0, (width + 1) * sizeof(int));
+
+   for (int y = 0; y < height; ++y)
+   {
+      const uchar * src = mGray.ptr<uchar>(y);
+      const int * prev = mIntegral.ptr<int>(y);
+      int * dst = mIntegral.ptr<int>(y + 1);
+
+      int rowSum = 0;
+      dst[0] = 0;
+      for (int x = 0; x < width; ++x)
+      {
+         rowSum += src[x];
+         dst[x + 1] = prev[x + 1] + rowSum;
+      }
+   }
+}
+
+void CSquareDetector::computeThreshold(cv::Mat & binary)
+{
+   binary.create(mGray.size(), CV_8U);
+
+   cv::parallel_for_(
+      cv::Range(0, mGray.rows),
+      ThresholdBody(mGray, mIntegral, binary, THRESHOLD_RADIUS, THRESHOLD_OFFSET));
+
+   clearBorder(binary);
+}
+
+void CSquareDetector::clearBorder(cv::Mat & binary)
+{
+   // one pixel frame guarantees that border following never leaves the image
+   binary.row(0).setTo(0);
+   binary.row(binary.rows - 1).setTo(0);
+   binary.col(0).setTo(0);
+   binary.col(binary.cols - 1).setTo(0);
+}
+
+void CSquareDetector::findContours()
+{
+   const int width = mBinary.cols;
+   const int height = mBinary.rows;
+   const size_t maxPerimeter = 4 * (width + height);
+
+   mTraced.create(mBinary.size(), CV_8U);
+   mTraced.setTo(0);
+   mContours.clear();
+
+   tContour contour;
+   for (int y = 1; y < height - 1; ++y)
+   {
+      const uchar * row = mBinary.ptr<uchar>(y);
+      const uchar * traced = mTraced.ptr<uchar>(y);
+
+      for (int x = 1; x < width - 1; ++x)
+      {
+         if (0 == row[x] || 0 != row[x - 1] || 0 != traced[x])
+         {
+            continue;
+         }
+
+         // find first foreground neighbour clockwise from west
+         const cv::Point start(x, y);
+         cv::Point second;
+         int s = 4;
+         do
+         {
+            s = (s - 1) & 7;
+            second = cv::Point(x + DELTA_X[s], y + DELTA_Y[s]);
+         }
+         while (0 == mBinary.at<uchar>(second) && 4 != s);
+
+         if (4 == s)
+         {
+            mTraced.at<uchar>(start) = 1;
+            continue;
+         }
+
+         // follow the border until the first edge is visited again
+         contour.clear();
+         cv::Point current = start;
+         for (;;)
+         {
+            cv::Point next;
+            for (;;)
+            {
+               ++s;
+               next = cv::Point(current.x + DELTA_X[s & 7], current.y + DELTA_Y[s & 7]);
+               if (0 != mBinary.at<uchar>(next))
+               {
+                  break;
+               }
+            }
+            s &= 7;
+
+            mTraced.at<uchar>(current) = 1;
+            if (contour.size() <= maxPerimeter)
+            {
+               contour.push_back(current);
+            }
+
+            if (next == start && current == second)
+            {
+               break;
+            }
+            current = next;
+            s = (s + 4) & 7;
+         }
+
+         if (MIN_PERIMETER <= (int)contour.size() * mScale && maxPerimeter >= contour.size())
+         {
+            mContours.push_back(contour);
+         }
+      }
+   }
+}
+
+bool CSquareDetector::fitQuad(const tContour & contour, tQuad & quad) const
+{
+   // rough corners: two farthest points and farthest points from diagonal between them
+   size_t index[4];
+   index[0] = findFarthest(contour, contour[0]);
+   index[2] = findFarthest(contour, contour[index[0]]);
+
+   float distance1 = 0.f;
+   float distance3 = 0.f;
+   index[1] = findFarthestFromLine(contour, index[0], index[2], distance1);
+   index[3] = findFarthestFromLine(contour, index[2], index[0], distance3);
+   if (distance1 < 2.f || distance3 < 2.f)
+   {
+      return false;
+   }
+
+   cv::Point2f rough[4];
+   for (int k = 0; k < 4; ++k)
+   {
+      rough[k] = contour[index[k]];
+   }
+
+   // every side has to be straight
+   for (int k = 0; k < 4; ++k)
+   {
+      const cv::Point2f & a = rough[k];
+      const cv::Point2f & b = rough[(k + 1) % 4];
+      const cv::Point2f ab = b - a;
+      const float tolerance = std::max(1.5f, 0.05f * std::sqrt(ab.dot(ab)));
+
+      float deviation = 0.f;
+      findFarthestFromLine(contour, index[k], index[(k + 1) % 4], deviation);
+      if (deviation > tolerance)
+      {
+         return false;
+      }
+   }
+
+   // convex with reasonable area
+   float area = 0.f;
+   bool hasPositiveTurn = false;
+   bool hasNegativeTurn = false;
+   for (int k = 0; k < 4; ++k)
+   {
+      area += cross(rough[k], rough[(k + 1) % 4]);
+
+      const float turn = cross(rough[(k + 1) % 4] - rough[k], rough[(k + 2) % 4] - rough[(k + 1) % 4]);
+      hasPositiveTurn = hasPositiveTurn || (turn > 0.f);
+      hasNegativeTurn = hasNegativeTurn || (turn < 0.f);
+   }
+   if ((hasPositiveTurn && hasNegativeTurn) || std::fabs(0.5f * area) * mScale * mScale < MIN_AREA)
+   {
+      return false;
+   }
+
+   // refine corners as intersections of edge lines
+   cv::Point2f origins[4];
+   cv::Point2f directions[4];
+   bool fitted[4];
+   for (int k = 0; k < 4; ++k)
+   {
+      fitted[k] = fitLine(contour, index[k], index[(k + 1) % 4], origins[k], directions[k]);
+   }
+
+   quad.resize(4);
+   for (int k = 0; k < 4; ++k)
+   {
+      const int prev = (k + 3) % 4;
+      quad[k] = rough[k];
+
+      if (fitted[prev] && fitted[k])
+      {
+         const float denominator = cross(directions[prev], directions[k]);
+         if (std::fabs(denominator) > 1e-3f)
+         {
+            const float t = cross(origins[k] - origins[prev], directions[k]) / denominator;
+            const cv::Point2f corner = origins[prev] + directions[prev] * t;
+            const cv::Point2f shift = corner - rough[k];
+            if (shift.dot(shift) * mScale * mScale < 25.f)
+            {
+               quad[k] = corner;
+            }
+         }
+      }
+
+      if ( quad[k].x < 1.f || quad[k].x > mBinary.cols - 2.f
+        || quad[k].y < 1.f || quad[k].y > mBinary.rows - 2.f)
+      {
+         return false;
+      }
+   }
+
+   // ALVAR expects corners counter-clockwise on screen
+   if (area > 0.f)
+   {
+      std::swap(quad[1], quad[3]);
+   }
+
+   return true;
+}
+
+bool CSquareDetector::decodeMarker(const tQuad & quad, std::vector<Marker> & markers)
+{
+   std::vector<alvar::PointDouble> corners(4);
+   for (int k = 0; k < 4; ++k)
+   {
+      corners[k].x = quad[k].x;
+      corners[k].y = quad[k].y;
+   }
+
+   IplImage gray = mGray;
+   alvar::MarkerData marker(MARKER_EDGE_LENGTH, MARKER_RESOLUTION, MARKER_MARGIN);
+
+   if (false == marker.UpdateContent(corners, &gray, &mCamera))
+   {
+      return false;
+   }
+
+   int orientation = 0;
+   if (false == marker.DecodeContent(&orientation))
+   {
+      return false;
+   }
+
+   if (marker.GetError(alvar::Marker::MARGIN_ERROR | alvar::Marker::DECODE_ERROR) > MAX_MARKER_ERROR)
+   {
+      return false;
+   }
+
+   marker.UpdatePose(corners, &mCamera, orientation);
+   markers.push_back(createMarker(marker.GetId(), marker.pose));
+
+   return true;
+}
+
+} /* namespace NApp */
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include <ALVAR/Camera.h>
+#include <ALVAR/Marker.h>
+#include "detector/IDetector.hpp"
+
+namespace NApp
+{
+
+/**
+ * Square markers detector independent of ALVAR's labeling pipeline.
+ *
+ * Frame is processed by own code end to end:
+ *  - adaptive threshold against local mean taken from integral image
+ *    (SSE2 inner loop, rows are processed in parallel), or binary image
+ *    prepared on GPU if it was provided by setPreprocessedFrame();
+ *  - border following of dark components;
+ *  - quad fitting with least squares edge lines and subpixel corner refinement.
+ * Only content decoding and pose estimation of the found quads are delegated
+ * to alvar::MarkerData, so marker ids are the same as with CDetector.
+ */
+class CSquareDetector : public IDetector
+{
+public:
+   CSquareDetector();
+
+   /** @copydoc IDetector::initialize() */
+   virtual bool initialize();
+
+   /** @copydoc IDetector::detect() */
+   virtual std::shared_ptr<CMarkersData> detect(const CFrame & frame);
+
+   /**
+    * @copydoc IDetector::setPreprocessedFrame()
+    * Only candidates search runs on binary image, grayscale of source frame
+    * for refinement and decoding is converted around candidates only, so
+    * corners and content match the candidates. Image data is reused.
+    */
+   virtual void setPreprocessedFrame(const cv::Mat & binary, const cv::Mat & source);
+
+   /** @copydoc IDetector::getStats() */
+   virtual DetectorStats getStats() const;
+
+private:
+   typedef std::vector<cv::Point> tContour;
+   typedef std::vector<cv::Point2f> tQuad;
+
+   int getPreprocessedScale(const cv::Mat & frame) const;
+
+   void convertGray(const cv::Mat & frame, const cv::Rect & roi);
+   void computeIntegral();
+   void computeThreshold(cv::Mat & binary);
+   void clearBorder(cv::Mat & binary);
+   void findContours();
+
+   bool fitQuad(const tContour & contour, tQuad & quad) const;
+   bool decodeMarker(const tQuad & quad, std::vector<Marker> & markers);
+
+private:
+   static const int   THRESHOLD_RADIUS;
+   static const float THRESHOLD_OFFSET;
+   static const int   MIN_PERIMETER;
+   static const float MIN_AREA;
+   static const float MAX_MARKER_ERROR;
+   static const unsigned int REFERENCE_INTERVAL;
+
+private:
+   alvar::Camera mCamera;
+
+   cv::Mat mGray;      ///< grayscale frame, 8U
+   cv::Mat mIntegral;  ///< integral image of mGray, 32S, (rows + 1) x (cols + 1)
+   cv::Mat mBinary;    ///< dark pixels of mGray, 255 - foreground
+   cv::Mat mTraced;    ///< pixels already visited by border following
+
+   cv::Mat mPreprocessed; ///< binary image from setPreprocessedFrame()
+   cv::Mat mSource;       ///< frame of mPreprocessed
+   cv::Mat mReference;    ///< scratch binary image of reference CPU path timing
+   int mScale;            ///< ratio between frame and mBinary size
+
+   std::vector<tContour> mContours;
+
+   unsigned int mFrameCount;
+   DetectorStats mStats;
+};
+
+} /* namespace NApp */
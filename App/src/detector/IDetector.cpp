@@ -7,4 +7,13 @@ IDetector::~IDetector()
 {
 }
 
+void IDetector::setPreprocessedFrame(const cv::Mat & /*binary*/, const cv::Mat & /*source*/)
+{
+}
+
+DetectorStats IDetector::getStats() const
+{
+   return DetectorStats();
+}
+
 } /* namespace NApp */
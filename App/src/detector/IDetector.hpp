@@ -7,6 +7,31 @@
 namespace NApp
 {
 
+/** Available implementations of markers detector. */
+struct DetectorType
+{
+   enum EType
+   {
+      ALVAR,   ///< ALVAR MarkerDetector pipeline
+      SQUARE   ///< own square-marker pipeline (CSquareDetector)
+   };
+};
+
+/** Timings of frame preprocessing (grayscale, threshold) of detector. */
+struct DetectorStats
+{
+   DetectorStats()
+      : PreprocessTime(0.)
+      , CpuPreprocessTime(0.)
+      , UsesPreprocessedFrame(false)
+   {
+   }
+
+   double PreprocessTime;      ///< averaged CPU time of preprocessing per frame, ms
+   double CpuPreprocessTime;   ///< averaged CPU time of pure CPU preprocessing path, ms
+   bool UsesPreprocessedFrame; ///< true if frames from setPreprocessedFrame() are used
+};
+
 /** Interface of markers detector. */
 class IDetector
 {
@@ -26,6 +51,19 @@ public:
     * @return smart pointer to markers data.
     */
    virtual std::shared_ptr<CMarkersData> detect(const CFrame & frame) = 0;
+
+   /**
+    * @brief Provide binary image of frame prepared elsewhere (e.g. on GPU)
+    * for the next detect() call. It's usually made from one of the previous
+    * frames, then markers are detected on that frame instead of the given one.
+    * Default implementation ignores it.
+    * @param binary dark pixels are 255, size is frame size divided by integer factor.
+    * @param source frame binary image was made from.
+    */
+   virtual void setPreprocessedFrame(const cv::Mat & binary, const cv::Mat & source);
+
+   /** Get preprocessing timings. Default implementation returns zeros. */
+   virtual DetectorStats getStats() const;
 };
 
 } /* namespace NApp */
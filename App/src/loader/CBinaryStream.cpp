@@ -0,0 +1,75 @@
+#include <algorithm>
+#include "loader/CBinaryStream.hpp"
+
+namespace NApp
+{
+
+CBinaryWriter::CBinaryWriter(std::vector<unsigned char> & data)
+   : mData(data)
+{
+}
+
+void CBinaryWriter::write(const void * data, size_t size)
+{
+   const unsigned char * bytes = (const unsigned char *)data;
+   mData.insert(mData.end(), bytes, bytes + size);
+}
+
+void CBinaryWriter::writeString(const std::string & str)
+{
+   write((unsigned int)str.size());
+   write(str.data(), str.size());
+}
+
+void CBinaryWriter::align(size_t alignment)
+{
+   const size_t padding = (alignment - mData.size() % alignment) % alignment;
+   mData.insert(mData.end(), padding, 0);
+}
+
+CBinaryReader::CBinaryReader(const unsigned char * data, size_t size)
+   : mData(data)
+   , mSize(size)
+   , mOffset(0)
+   , mValid(0 != data)
+{
+}
+
+const unsigned char * CBinaryReader::skip(size_t size)
+{
+   if (false == mValid || size > mSize - mOffset)
+   {
+      mValid = false;
+      return 0;
+   }
+
+   const unsigned char * data = mData + mOffset;
+   mOffset += size;
+   return data;
+}
+
+bool CBinaryReader::readString(std::string & str)
+{
+   unsigned int length = 0;
+   if (false == read(length))
+   {
+      return false;
+   }
+
+   const unsigned char * data = skip(length);
+   if (0 == data)
+   {
+      return false;
+   }
+   str.assign((const char *)data, length);
+   return true;
+}
+
+bool CBinaryReader::align(size_t alignment)
+{
+   const size_t padding = (alignment - mOffset % alignment) % alignment;
+   skip(padding);
+   return mValid;
+}
+
+} /* namespace NApp */
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace NApp
+{
+
+/**
+ * Writer of plain data into byte array. Values are written in memory
+ * layout of this platform, readers check version of format instead.
+ */
+class CBinaryWriter
+{
+public:
+   explicit CBinaryWriter(std::vector<unsigned char> & data);
+
+   /** Write value of trivially copyable type. */
+   template <typename T>
+   void write(const T & value);
+
+   void write(const void * data, size_t size);
+
+   /** Write length and characters. */
+   void writeString(const std::string & str);
+
+   /** Pad data to multiple of alignment. */
+   void align(size_t alignment);
+
+private:
+   std::vector<unsigned char> & mData;
+};
+
+/**
+ * Reader of data written by CBinaryWriter. Every read checks that data
+ * is long enough, after the first failure all following reads fail.
+ */
+class CBinaryReader
+{
+public:
+   CBinaryReader(const unsigned char * data, size_t size);
+
+   template <typename T>
+   bool read(T & value);
+
+   /**
+    * Skip bytes.
+    * @return pointer to skipped bytes, 0 if data is too short
+    */
+   const unsigned char * skip(size_t size);
+
+   bool readString(std::string & str);
+
+   /** Skip padding written by CBinaryWriter::align(). */
+   bool align(size_t alignment);
+
+   /** @return false if some read failed */
+   bool isValid() const;
+
+   /** @return number of bytes which aren't read yet */
+   size_t getRemaining() const;
+
+private:
+   const unsigned char * mData;
+   size_t mSize;
+   size_t mOffset;
+   bool mValid;
+};
+
+template <typename T>
+inline
+void CBinaryWriter::write(const T & value)
+{
+   write(&value, sizeof(T));
+}
+
+template <typename T>
+inline
+bool CBinaryReader::read(T & value)
+{
+   const unsigned char * data = skip(sizeof(T));
+   if (0 == data)
+   {
+      return false;
+   }
+   std::copy(data, data + sizeof(T), (unsigned char *)&value);
+   return true;
+}
+
+inline
+bool CBinaryReader::isValid() const
+{
+   return mValid;
+}
+
+inline
+size_t CBinaryReader::getRemaining() const
+{
+   return mSize - mOffset;
+}
+
+} /* namespace NApp */
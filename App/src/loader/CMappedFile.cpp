@@ -0,0 +1,139 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "loader/CMappedFile.hpp"
+
+namespace NApp
+{
+
+CMappedFile::CMappedFile()
+   : mData(0)
+   , mSize(0)
+#ifdef _WIN32
+   , mFile(INVALID_HANDLE_VALUE)
+   , mMapping(0)
+#else
+   , mFile(-1)
+#endif
+{
+}
+
+CMappedFile::~CMappedFile()
+{
+   close();
+}
+
+#ifdef _WIN32
+
+bool CMappedFile::open(const std::string & path)
+{
+   close();
+
+   mFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0,
+      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, 0);
+   if (INVALID_HANDLE_VALUE == mFile)
+   {
+      return false;
+   }
+
+   LARGE_INTEGER size;
+   if (FALSE == GetFileSizeEx(mFile, &size) || 0 == size.QuadPart)
+   {
+      close();
+      return false;
+   }
+
+   mMapping = CreateFileMappingA(mFile, 0, PAGE_READONLY, 0, 0, 0);
+   if (0 == mMapping)
+   {
+      close();
+      return false;
+   }
+
+   mData = (const unsigned char *)MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+   if (0 == mData)
+   {
+      close();
+      return false;
+   }
+
+   mSize = (size_t)size.QuadPart;
+   return true;
+}
+
+void CMappedFile::close()
+{
+   if (0 != mData)
+   {
+      UnmapViewOfFile(mData);
+   }
+   if (0 != mMapping)
+   {
+      CloseHandle(mMapping);
+   }
+   if (INVALID_HANDLE_VALUE != mFile)
+   {
+      CloseHandle(mFile);
+   }
+
+   mData = 0;
+   mSize = 0;
+   mMapping = 0;
+   mFile = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool CMappedFile::open(const std::string & path)
+{
+   close();
+
+   mFile = ::open(path.c_str(), O_RDONLY);
+   if (-1 == mFile)
+   {
+      return false;
+   }
+
+   struct stat info;
+   if (0 != fstat(mFile, &info) || 0 == info.st_size)
+   {
+      close();
+      return false;
+   }
+
+   void * data = mmap(0, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, mFile, 0);
+   if (MAP_FAILED == data)
+   {
+      close();
+      return false;
+   }
+
+   mData = (const unsigned char *)data;
+   mSize = (size_t)info.st_size;
+   return true;
+}
+
+void CMappedFile::close()
+{
+   if (0 != mData)
+   {
+      munmap((void *)mData, mSize);
+   }
+   if (-1 != mFile)
+   {
+      ::close(mFile);
+   }
+
+   mData = 0;
+   mSize = 0;
+   mFile = -1;
+}
+
+#endif
+
+} /* namespace NApp */
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace NApp
+{
+
+/**
+ * Read-only memory mapping of whole file. Pages are read by the system
+ * on first access, so data can go to buffer uploads without a copy.
+ */
+class CMappedFile
+{
+public:
+   CMappedFile();
+   ~CMappedFile();
+
+   /**
+    * Map file, previously mapped one is closed.
+    * @return false if file can't be opened or is empty
+    */
+   bool open(const std::string & path);
+
+   void close();
+
+   /** @return mapped data, 0 if file isn't open */
+   const unsigned char * getData() const;
+
+   size_t getSize() const;
+
+private:
+   CMappedFile(const CMappedFile &);
+   CMappedFile & operator=(const CMappedFile &);
+
+private:
+   const unsigned char * mData;
+   size_t mSize;
+#ifdef _WIN32
+   void * mFile;    ///< HANDLE of file
+   void * mMapping; ///< HANDLE of mapping object
+#else
+   int mFile;
+#endif
+};
+
+inline
+const unsigned char * CMappedFile::getData() const
+{
+   return mData;
+}
+
+inline
+size_t CMappedFile::getSize() const
+{
+   return mSize;
+}
+
+} /* namespace NApp */
@@ -0,0 +1,78 @@
+#include <algorithm>
+#include "loader/CThreadPool.hpp"
+
+namespace NApp
+{
+
+CThreadPool::CThreadPool(unsigned int threadCount)
+   : mStopping(false)
+{
+   if (0 == threadCount)
+   {
+      // hardware_concurrency() may not know, one worker still overlaps with GL work
+      threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+   }
+
+   for (unsigned int i = 0; i < threadCount; ++i)
+   {
+      mThreads.push_back(std::thread(&CThreadPool::run, this));
+   }
+}
+
+CThreadPool::~CThreadPool()
+{
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mStopping = true;
+      mTasks.clear();
+   }
+   mCondition.notify_all();
+
+   for (size_t i = 0; i < mThreads.size(); ++i)
+   {
+      mThreads[i].join();
+   }
+}
+
+void CThreadPool::add(const std::function<void()> & task, int priority)
+{
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+
+      // after all tasks of the same or higher priority
+      std::deque<tTask>::iterator it = mTasks.end();
+      while (mTasks.begin() != it && (it - 1)->first < priority)
+      {
+         --it;
+      }
+      mTasks.insert(it, tTask(priority, task));
+   }
+   mCondition.notify_one();
+}
+
+void CThreadPool::run()
+{
+   for (;;)
+   {
+      std::function<void()> task;
+      {
+         std::unique_lock<std::mutex> lock(mMutex);
+         while (false == mStopping && true == mTasks.empty())
+         {
+            mCondition.wait(lock);
+         }
+
+         if (true == mStopping)
+         {
+            return;
+         }
+
+         task = mTasks.front().second;
+         mTasks.pop_front();
+      }
+
+      task();
+   }
+}
+
+} /* namespace NApp */
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace NApp
+{
+
+/**
+ * Fixed set of worker threads running queued tasks by priority, tasks of
+ * the same priority in order of submission. Tasks must not touch GL,
+ * context is current only on the main thread.
+ */
+class CThreadPool
+{
+public:
+   /**
+    * Constructor.
+    * @param threadCount number of workers, 0 for one per hardware thread
+    */
+   explicit CThreadPool(unsigned int threadCount = 0);
+
+   /**
+    * Destructor, waits for running tasks. Tasks which aren't started are
+    * dropped, futures of them report broken promise.
+    */
+   ~CThreadPool();
+
+   /**
+    * Queue task.
+    * @param priority tasks of higher priority are started first
+    */
+   void add(const std::function<void()> & task, int priority = 0);
+
+   /**
+    * Queue task with result.
+    * @param priority tasks of higher priority are started first
+    * @return future of result, exception of task is rethrown by its get()
+    */
+   template <typename T>
+   std::future<T> submit(const std::function<T()> & task, int priority = 0);
+
+   unsigned int getThreadCount() const;
+
+private:
+   CThreadPool(const CThreadPool &);
+   CThreadPool & operator=(const CThreadPool &);
+
+   void run();
+
+   /** Runs packaged task, std::function needs copyable target. */
+   template <typename T>
+   static void runTask(const std::shared_ptr<std::packaged_task<T()> > & task);
+
+private:
+   typedef std::pair<int, std::function<void()> > tTask;
+
+private:
+   std::vector<std::thread> mThreads;
+   std::deque<tTask> mTasks; ///< sorted by priority, highest first
+   std::mutex mMutex;
+   std::condition_variable mCondition;
+   bool mStopping;
+};
+
+template <typename T>
+inline
+std::future<T> CThreadPool::submit(const std::function<T()> & task, int priority)
+{
+   std::shared_ptr<std::packaged_task<T()> > packaged = std::make_shared<std::packaged_task<T()> >(task);
+   std::future<T> result = packaged->get_future();
+   add(std::bind(&CThreadPool::runTask<T>, packaged), priority);
+   return result;
+}
+
+template <typename T>
+inline
+void CThreadPool::runTask(const std::shared_ptr<std::packaged_task<T()> > & task)
+{
+   (*task)();
+}
+
+inline
+unsigned int CThreadPool::getThreadCount() const
+{
+   return (unsigned int)mThreads.size();
+}
+
+} /* namespace NApp */
@@ -1,3 +1,4 @@
+#include <climits>
 #include "renderer/CAnimator.hpp"
 
 namespace NApp
@@ -5,211 +6,109 @@ namespace NApp
 
 static const float ANIMATION_TICKS_PER_SECOND = 20.f;
 
-/**
- * A little tree structure to match the scene's node structure,
- * but holding additional data.
- */
-struct AnimationNode
+const unsigned int Skeleton::NONE = UINT_MAX;
+
+SkeletonNode::SkeletonNode()
+   : mParent(Skeleton::NONE)
+   , mFirstMesh(0)
+   , mMeshCount(0)
 {
-   std::string Name;
-   AnimationNode * Parent;
-   std::vector<AnimationNode *> Children;
-   aiMatrix4x4 LocalTransform;   // most recently calculated local transform
-   aiMatrix4x4 GlobalTransform;  // same, but in world space
-   unsigned int ChannelIndex;    // index in the current animation's channel array.
-
-   AnimationNode()
-      : Parent(0)
-      , ChannelIndex(UINT_MAX)
-   {
-   }
+}
 
-   AnimationNode(const std::string & name)
-      : Name(name)
-      , Parent(0)
-      , ChannelIndex(UINT_MAX)
-   {
-   }
+SkeletonBone::SkeletonBone()
+   : mNode(Skeleton::NONE)
+{
+}
 
-   ~AnimationNode()
-   {
-      for (std::vector<AnimationNode *>::iterator it = Children.begin(); it != Children.end(); ++it)
-      {
-         delete *it;
-      }
-   }
-};
+Animation::Animation()
+   : mDuration(0.0)
+   , mTicksPerSecond(0.0)
+{
+}
 
-CAnimator::CAnimator(const aiScene * scene, unsigned int animationIndex) {
-   mScene = scene;
-   mLastTime = 0.0;
-   mRootNode = 0;
-   mCurrentAnimationIndex = UINT_MAX;
-   mCurrentAnimation = 0;
-   mLastFramePosition = 0;
-   mIdentityMatrix = aiMatrix4x4();
-
-   //build the nodes-for-bones table
-   for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+size_t Skeleton::getMemory() const
+{
+   size_t size = mNodes.capacity() * sizeof(SkeletonNode)
+      + mNodeMeshes.capacity() * sizeof(unsigned int)
+      + mBones.capacity() * sizeof(SkeletonBone)
+      + mAnimations.capacity() * sizeof(Animation);
+
+   for (size_t i = 0; i < mAnimations.size(); ++i)
    {
-      const aiMesh & currentMesh = *scene->mMeshes[i];
-      for (unsigned int j = 0; j < currentMesh.mNumBones; ++j)
+      const Animation & animation = mAnimations[i];
+      size += animation.mChannels.capacity() * sizeof(AnimationChannel)
+         + animation.mNodeChannels.capacity() * sizeof(unsigned int);
+      for (size_t j = 0; j < animation.mChannels.size(); ++j)
       {
-         const aiBone & currentBone = *currentMesh.mBones[j];
-         mMapBoneNodesByName[currentBone.mName.data] = mScene->mRootNode->FindNode(currentBone.mName);
+         const AnimationChannel & channel = animation.mChannels[j];
+         size += channel.mPositionKeys.capacity() * sizeof(aiVectorKey)
+            + channel.mRotationKeys.capacity() * sizeof(aiQuatKey)
+            + channel.mScalingKeys.capacity() * sizeof(aiVectorKey);
       }
    }
-
-  //changing the current animation also creates the node tree for this animation
-  setAnimationIndex(animationIndex);
+   return size;
 }
 
-CAnimator::~CAnimator()
+CAnimator::CAnimator(const Skeleton & skeleton, unsigned int animationIndex)
+   : mSkeleton(skeleton)
+   , mCurrentAnimationIndex(Skeleton::NONE)
+   , mCurrentAnimation(0)
+   , mLastTime(0.0)
+   , mGlobalTransforms(skeleton.mNodes.size())
 {
-   if (mRootNode != 0) {
-      delete mRootNode;
-   }
-
-   if (mLastFramePosition != 0)
-   {
-      delete [] mLastFramePosition;
-   }
+   //changing the current animation also sets up the bind pose
+   setAnimationIndex(animationIndex);
 }
 
-void CAnimator::setAnimationIndex(unsigned int animationIndex) {
+void CAnimator::setAnimationIndex(unsigned int animationIndex)
+{
    if (animationIndex == mCurrentAnimationIndex)
    {
       return;
    }
 
-   //kill data of the previous anim
-   if (mRootNode != 0)
-   {
-      delete mRootNode;
-      mRootNode = 0;
-   }
-
-   if (mLastFramePosition != 0)
-   {
-      delete[] mLastFramePosition;
-   }
-
-   mMapNodesByName.clear();
-   mCurrentAnimation = 0;
-
    mCurrentAnimationIndex = animationIndex;
-   mCurrentAnimation = mScene->mAnimations[mCurrentAnimationIndex];
-
-   //create the internal node tree. Do this even in case of invalid animation index
-   //so that the transformation matrices are properly set up to mimic the current scene
-   mRootNode = createNodeTree(mScene->mRootNode, 0);
+   mCurrentAnimation = (animationIndex < mSkeleton.mAnimations.size())
+      ? &mSkeleton.mAnimations[animationIndex]
+      : 0;
 
-   //invalid anim index
-   if (animationIndex >= mScene->mNumAnimations)
-   {
-      mCurrentAnimationIndex = 0;
-      mCurrentAnimation = mScene->mAnimations[mCurrentAnimationIndex];
-   }
-
-   mLastFramePosition = new glm::uvec3[mCurrentAnimation->mNumChannels];
-}
-
-AnimationNode * CAnimator::createNodeTree(aiNode * node, AnimationNode * parent)
-{
-   //create a node
-   AnimationNode * internalNode = new AnimationNode(node->mName.data);
-   internalNode->Parent = parent;
-   mMapNodesByName[node] = internalNode;
-
-   //copy its transformation
-   internalNode->LocalTransform = node->mTransformation;
-   calculateGlobalTransform(internalNode);
-
-   //find the index of the animation track affecting this node, if any
-   if (mCurrentAnimationIndex < mScene->mNumAnimations)
-   {
-      internalNode->ChannelIndex = -1;
-
-      for (unsigned int a = 0; a < mCurrentAnimation->mNumChannels; a++)
-      {
-         if (mCurrentAnimation->mChannels[a]->mNodeName.data == internalNode->Name)
-         {
-            internalNode->ChannelIndex = a;
-            break;
-         }
-      }
-   }
-
-   //continue for all child nodes and assign the created internal nodes as our children
-   for (unsigned int a = 0; a < node->mNumChildren; a++)
-   {
-      AnimationNode * childNode = createNodeTree(node->mChildren[a], internalNode);
-      internalNode->Children.push_back(childNode);
-   }
+   mLastTime = 0.0;
+   mLastFramePosition.assign(
+      (0 != mCurrentAnimation) ? mCurrentAnimation->mChannels.size() : 0,
+      glm::uvec3(0));
 
-   return internalNode;
+   updateTransforms(0);
 }
 
 const std::vector<aiMatrix4x4> & CAnimator::getBoneMatrices(
-   const aiNode & node,
-   unsigned int nodeMeshIndex)
+   unsigned int node,
+   unsigned int firstBone,
+   unsigned int boneCount)
 {
-   if (nodeMeshIndex < node.mNumMeshes)
-   {
-      unsigned int meshIndex = node.mMeshes[nodeMeshIndex];
-
-      if ((mScene != 0) && (meshIndex < mScene->mNumMeshes))
-      {
-         const aiMesh & mesh = *mScene->mMeshes[meshIndex];
-
-         for (unsigned int i = 0; i < mTransforms.size(); ++i)
-         {
-            mTransforms[i] = aiMatrix4x4();
-         }
-
-         //resize array and initialise it with identity matrices
-         mTransforms.resize(mesh.mNumBones, aiMatrix4x4());
+   mBoneMatrices.resize(boneCount);
 
-         //calculate the mesh's inverse global transform
-         aiMatrix4x4 mGlobalInverseMeshTransform = getGlobalTransform(node);
-         mGlobalInverseMeshTransform.Inverse();
+   //calculate the mesh's inverse global transform
+   aiMatrix4x4 globalInverseMeshTransform = getGlobalTransform(node);
+   globalInverseMeshTransform.Inverse();
 
-         //Bone matrices transform from mesh coordinates in bind pose to mesh coordinates in skinned pose
-         //Therefore the formula is offsetMatrix * currentGlobalTransform * inverseCurrentMeshTransform
-         for (unsigned int i = 0; i < mesh.mNumBones; ++i)
-         {
-            const aiBone & bone = *mesh.mBones[i];
-            const aiMatrix4x4 & mCurrentGlobalTransform = getGlobalTransform(*mMapBoneNodesByName[bone.mName.data]);
-            mTransforms[i] = mGlobalInverseMeshTransform * mCurrentGlobalTransform * bone.mOffsetMatrix;
-         }
-      }
+   //Bone matrices transform from mesh coordinates in bind pose to mesh coordinates in skinned pose
+   //Therefore the formula is offsetMatrix * currentGlobalTransform * inverseCurrentMeshTransform
+   for (unsigned int i = 0; i < boneCount; ++i)
+   {
+      const SkeletonBone & bone = mSkeleton.mBones[firstBone + i];
+      mBoneMatrices[i] = globalInverseMeshTransform * getGlobalTransform(bone.mNode) * bone.mOffset;
    }
 
-   //and return the result
-   return mTransforms;
-}
-
-void CAnimator::calculateGlobalTransform(AnimationNode * internalNode)
-{
-   //concatenate all parent transforms to get the global transform for this node
-   internalNode->GlobalTransform = internalNode->LocalTransform;
-   AnimationNode * node = internalNode->Parent;
-
-    while (0 != node)
-    {
-      internalNode->GlobalTransform = node->LocalTransform * internalNode->GlobalTransform;
-      node = node->Parent;
-   }
+   return mBoneMatrices;
 }
 
-const aiMatrix4x4& CAnimator::getGlobalTransform(const aiNode & node) const
+const aiMatrix4x4 & CAnimator::getGlobalTransform(unsigned int node) const
 {
-   tNodeMap::const_iterator it = mMapNodesByName.find(&node);
-   if (it == mMapNodesByName.end())
+   if (node >= mGlobalTransforms.size())
    {
       return mIdentityMatrix;
    }
-   return it->second->GlobalTransform;
+   return mGlobalTransforms[node];
 }
 
 void CAnimator::updateAnimation(long elapsedTime, double ticksPerSecond)
@@ -229,27 +128,27 @@ void CAnimator::updateAnimation(long elapsedTime, double ticksPerSecond)
          timeInTicks = fmod(time * ticksPerSecondCorrected, mCurrentAnimation->mDuration);
       }
 
-      if (mTransforms.size() != mCurrentAnimation->mNumChannels)
+      if (mChannelTransforms.size() != mCurrentAnimation->mChannels.size())
       {
-         mTransforms.resize(mCurrentAnimation->mNumChannels);
+         mChannelTransforms.resize(mCurrentAnimation->mChannels.size());
       }
 
       //calculate the transformations for each animation channel
-      for (unsigned int i = 0; i < mCurrentAnimation->mNumChannels; ++i)
+      for (size_t i = 0; i < mCurrentAnimation->mChannels.size(); ++i)
       {
-         const aiNodeAnim* channel = mCurrentAnimation->mChannels[i];
+         const AnimationChannel & channel = mCurrentAnimation->mChannels[i];
 
          //******** Position *****
          aiVector3D presentPosition(0.f, 0.f, 0.f);
-         if (channel->mNumPositionKeys > 0)
+         if (channel.mPositionKeys.size() > 0)
          {
             //Look for present frame number. Search from last position if time is after the last time, else from beginning
             //Should be much quicker than always looking from start for the average use case.
             unsigned int frame = (timeInTicks >= mLastTime) ? mLastFramePosition[i].x : 0;
 
-            while (frame < channel->mNumPositionKeys - 1)
+            while (frame < channel.mPositionKeys.size() - 1)
             {
-               if (timeInTicks < channel->mPositionKeys[frame + 1].mTime)
+               if (timeInTicks < channel.mPositionKeys[frame + 1].mTime)
                {
                   break;
                }
@@ -257,9 +156,9 @@ void CAnimator::updateAnimation(long elapsedTime, double ticksPerSecond)
             }
 
             //interpolate between this frame's value and next frame's value
-            unsigned int nextFrame = (frame + 1) % channel->mNumPositionKeys;
-            const aiVectorKey & key = channel->mPositionKeys[frame];
-            const aiVectorKey & nextKey = channel->mPositionKeys[nextFrame];
+            unsigned int nextFrame = (unsigned int)((frame + 1) % channel.mPositionKeys.size());
+            const aiVectorKey & key = channel.mPositionKeys[frame];
+            const aiVectorKey & nextKey = channel.mPositionKeys[nextFrame];
             double timeDifference = nextKey.mTime - key.mTime;
 
             if (timeDifference < 0.0)
@@ -282,13 +181,13 @@ void CAnimator::updateAnimation(long elapsedTime, double ticksPerSecond)
 
          //******** Rotation *********
          aiQuaternion presentRotation(1, 0, 0, 0);
-         if (channel->mNumRotationKeys > 0)
+         if (channel.mRotationKeys.size() > 0)
          {
             unsigned int frame = (timeInTicks >= mLastTime) ? mLastFramePosition[i].y : 0;
 
-            while (frame < channel->mNumRotationKeys - 1)
+            while (frame < channel.mRotationKeys.size() - 1)
             {
-               if (timeInTicks < channel->mRotationKeys[frame + 1].mTime)
+               if (timeInTicks < channel.mRotationKeys[frame + 1].mTime)
                {
                   break;
                }
@@ -297,9 +196,9 @@ void CAnimator::updateAnimation(long elapsedTime, double ticksPerSecond)
             }
 
             //interpolate between this frame's value and next frame's value
-            unsigned int nextFrame = (frame + 1) % channel->mNumRotationKeys;
-            const aiQuatKey & key = channel->mRotationKeys[frame];
-            const aiQuatKey & nextKey = channel->mRotationKeys[nextFrame];
+            unsigned int nextFrame = (unsigned int)((frame + 1) % channel.mRotationKeys.size());
+            const aiQuatKey & key = channel.mRotationKeys[frame];
+            const aiQuatKey & nextKey = channel.mRotationKeys[nextFrame];
             double timeDifference = nextKey.mTime - key.mTime;
 
             if (timeDifference < 0.0)
@@ -322,12 +221,12 @@ void CAnimator::updateAnimation(long elapsedTime, double ticksPerSecond)
 
          //******** Scaling **********
          aiVector3D presentScaling(1.f, 1.f, 1.f);
-         if (channel->mNumScalingKeys > 0)
+         if (channel.mScalingKeys.size() > 0)
          {
             unsigned int frame = (timeInTicks >= mLastTime) ? mLastFramePosition[i].z : 0;
-            while (frame < channel->mNumScalingKeys - 1)
+            while (frame < channel.mScalingKeys.size() - 1)
             {
-               if (timeInTicks < channel->mScalingKeys[frame + 1].mTime)
+               if (timeInTicks < channel.mScalingKeys[frame + 1].mTime)
                {
                   break;
                }
@@ -335,12 +234,12 @@ void CAnimator::updateAnimation(long elapsedTime, double ticksPerSecond)
                frame++;
             }
 
-            presentScaling = channel->mScalingKeys[frame].mValue;
+            presentScaling = channel.mScalingKeys[frame].mValue;
             mLastFramePosition[i].z = frame;
          }
 
          //build a transformation matrix from it
-         aiMatrix4x4 & mTransformation = mTransforms[i];
+         aiMatrix4x4 & mTransformation = mChannelTransforms[i];
          mTransformation = aiMatrix4x4(presentRotation.GetMatrix());
          mTransformation.a1 *= presentScaling.x;
          mTransformation.b1 *= presentScaling.x;
@@ -359,36 +258,24 @@ void CAnimator::updateAnimation(long elapsedTime, double ticksPerSecond)
       mLastTime = timeInTicks;
 
       //and update all node transformations with the results
-      updateTransforms(mRootNode, mTransforms);
+      updateTransforms(mCurrentAnimation);
    }
 }
 
-void CAnimator::updateTransforms(AnimationNode * node, const std::vector<aiMatrix4x4> & transforms)
+void CAnimator::updateTransforms(const Animation * animation)
 {
-   //update node local transform
-   if (node->ChannelIndex != UINT_MAX)
-   {
-      if (node->ChannelIndex >= transforms.size())
-      {
-         return;
-      }
-      node->LocalTransform = transforms[node->ChannelIndex];
-   }
-
-   //concatenate all parent transforms to get the global transform for this node
-   node->GlobalTransform = node->LocalTransform;
-   AnimationNode * parentNode = node->Parent;
-   while (0 != parentNode)
-   {
-      node->GlobalTransform = parentNode->LocalTransform * node->GlobalTransform;
-      parentNode = parentNode->Parent;
-   }
-
-   //continue for all children
-   std::vector<AnimationNode *>::iterator it;
-   for (it = node->Children.begin(); it != node->Children.end(); ++it)
+   //parents precede children, so global transform of parent is ready
+   for (size_t i = 0; i < mSkeleton.mNodes.size(); ++i)
    {
-      updateTransforms(*it, transforms);
+      const SkeletonNode & node = mSkeleton.mNodes[i];
+      const unsigned int channel = (0 != animation) ? animation->mNodeChannels[i] : Skeleton::NONE;
+      const aiMatrix4x4 & localTransform = (Skeleton::NONE != channel && channel < mChannelTransforms.size())
+         ? mChannelTransforms[channel]
+         : node.mTransform;
+
+      mGlobalTransforms[i] = (Skeleton::NONE != node.mParent)
+         ? mGlobalTransforms[node.mParent] * localTransform
+         : localTransform;
    }
 }
 
@@ -1,48 +1,100 @@
 #pragma once
 
 #include <vector>
-#include <map>
 #include <glm/glm.hpp>
 #include <assimp/scene.h>
 
 namespace NApp
 {
 
-struct AnimationNode;
+/** Node of model hierarchy. */
+struct SkeletonNode
+{
+   SkeletonNode();
+
+   unsigned int mParent;    ///< index of parent node, Skeleton::NONE for root
+   aiMatrix4x4 mTransform;  ///< transform relative to parent in bind pose
+   unsigned int mFirstMesh; ///< first mesh of node in Skeleton::mNodeMeshes
+   unsigned int mMeshCount;
+};
+
+/** Bone of mesh. */
+struct SkeletonBone
+{
+   SkeletonBone();
+
+   unsigned int mNode;   ///< node moving bone, Skeleton::NONE if model has no such node
+   aiMatrix4x4 mOffset;  ///< from mesh space to bone space in bind pose
+};
+
+/** Keys of one animated node. */
+struct AnimationChannel
+{
+   std::vector<aiVectorKey> mPositionKeys;
+   std::vector<aiQuatKey> mRotationKeys;
+   std::vector<aiVectorKey> mScalingKeys;
+};
+
+struct Animation
+{
+   Animation();
+
+   double mDuration;       ///< in ticks
+   double mTicksPerSecond; ///< 0 if file doesn't tell
+   std::vector<AnimationChannel> mChannels;
+   std::vector<unsigned int> mNodeChannels; ///< channel of each node, Skeleton::NONE if node isn't animated
+};
 
 /**
- * Calculates the animated node transformations for a given scene and timestamp.
+ * Node tree, bones and animations of model in the form the animator uses.
+ * Names of nodes are resolved to indices when model is read, so neither
+ * names nor Assimp structures are kept.
+ */
+struct Skeleton
+{
+   /** Index of missing node or channel. */
+   static const unsigned int NONE;
+
+   /** Estimate memory held by skeleton. */
+   size_t getMemory() const;
+
+   std::vector<SkeletonNode> mNodes;      ///< depth first, parents before children
+   std::vector<unsigned int> mNodeMeshes; ///< mesh indices of all nodes
+   std::vector<SkeletonBone> mBones;      ///< bones of all meshes, meshes keep their ranges
+   std::vector<Animation> mAnimations;
+};
+
+/**
+ * Calculates the animated node transformations for a given skeleton and timestamp.
  *
- *  Create an instance for a aiScene you want to animate and set the current animation
+ *  Create an instance for a skeleton you want to animate and set the current animation
  *  to play. You can then have the instance calculate the current pose for all nodes
- *  by calling Calculate() for a given timestamp. After this you can retrieve the
- *  present transformation for a given node by calling GetLocalTransform() or
- *  GetGlobalTransform().
+ *  by calling updateAnimation() for a given timestamp. After this you can retrieve the
+ *  present transformation for a given node by calling getGlobalTransform() or the
+ *  bone matrices of a mesh by calling getBoneMatrices().
  */
 class CAnimator
 {
 public:
-   /** Constructor for a given scene.
+   /** Constructor for a given skeleton.
     *
-    * The object keeps a reference to the scene during its lifetime, but
+    * The object keeps a reference to the skeleton during its lifetime, but
     * ownership stays at the caller.
-    * @param scene The scene to animate.
+    * @param skeleton The skeleton to animate.
     * @param animIndex Index of the animation to play.
     */
-   CAnimator(const aiScene * scene, unsigned int animIndex);
-   ~CAnimator();
+   CAnimator(const Skeleton & skeleton, unsigned int animIndex);
 
-   /** Sets the animation to use for playback. This also recreates the internal
-    * mapping structures, which might take a few cycles.
-    * @param animIndex Index of the animation in the scene's animation array
+   /** Sets the animation to use for playback. Nodes are reset to bind pose.
+    * @param animIndex Index of the animation in the skeleton's animation array,
+    *   invalid index keeps bind pose
     */
    void setAnimationIndex(unsigned int animIndex);
 
-   /** Calculates the node transformations for the scene. Call this to get
+   /** Calculates the node transformations for the skeleton. Call this to get
     * up-to-date results before calling one of the getters.
-    * Evaluates the animation tracks for a given time stamp. The calculated pose can be retrieved as a
-    * array of transformation matrices afterwards by calling GetTransformations().
     * @param elapsedTime Elapsed time since animation start in ms.
+    * @param ticksPerSecond Ticks per second of animation, 0 for the default.
     */
    void updateAnimation(long elapsedTime, double ticksPerSecond);
 
@@ -54,63 +106,50 @@ public:
     * @code
     * projMatrix * viewMatrix * worldMatrix * boneMatrix
     * @endcode
-    * @param node The node carrying the mesh.
-    * @param meshIndex Index of the mesh in the node's mesh array. The NODE's
-    *   mesh array, not  the scene's mesh array! Leave out to use the first mesh
-    *   of the node, which is usually also the only one.
+    * @param node Index of the node carrying the mesh.
+    * @param firstBone Index of the first bone of the mesh in the skeleton.
+    * @param boneCount Number of bones of the mesh.
     * @return A reference to a vector of bone matrices. Stays stable till the
-    *   next call to GetBoneMatrices();
+    *   next call to getBoneMatrices();
     */
-   const std::vector<aiMatrix4x4> & getBoneMatrices(const aiNode & node, unsigned int meshIndex = 0);
+   const std::vector<aiMatrix4x4> & getBoneMatrices(
+      unsigned int node,
+      unsigned int firstBone,
+      unsigned int boneCount);
 
    /** Retrieves the most recent global transformation matrix for the given node.
     *
     * The returned matrix is in world space, which is the same coordinate space
-    * as the transformation of the scene's root node. If the node is not animated,
-    * the node's original transformation is returned so that you can safely use or
-    * assign it to the node itsself. If there is no node with the given name, the
-    * identity matrix is returned. All transformations are updated whenever
-    * Calculate() is called.
-    * @param pNodeName Name of the node
+    * as the transformation of the root node. If the node is not animated, its
+    * bind pose transformation is used. For Skeleton::NONE the identity matrix
+    * is returned.
+    * @param node Index of the node
     * @return A reference to the node's most recently calculated global
     *   transformation matrix.
     */
-   const aiMatrix4x4 & getGlobalTransform(const aiNode & node) const;
+   const aiMatrix4x4 & getGlobalTransform(unsigned int node) const;
 
 private:
-   /** Recursively creates an internal node structure matching the current scene and animation. */
-   AnimationNode * createNodeTree(aiNode * node, AnimationNode * parent);
+   /** Updates global transformations of all nodes, animation may be 0 for bind pose. */
+   void updateTransforms(const Animation * animation);
 
-   /** Calculates the global transformation matrix for the given internal node */
-   void calculateGlobalTransform(AnimationNode * internalNode);
-
-   /** Recursively updates the internal node transformations from the given matrix array */
-   void updateTransforms(AnimationNode* node, const std::vector<aiMatrix4x4> & transforms);
-
-   /** Name to node map to quickly find nodes by their name */
-   typedef std::map<const aiNode *, AnimationNode *> tNodeMap;
-   tNodeMap mMapNodesByName;
-
-   /** Name to node map to quickly find nodes for given bones by their name */
-   typedef std::map<const char *, const aiNode *> tBoneMap;
-   tBoneMap mMapBoneNodesByName;
+private:
+   const Skeleton & mSkeleton;
+   unsigned int mCurrentAnimationIndex;
+   const Animation * mCurrentAnimation;
 
    /** At which frame the last evaluation happened for each channel.
     * Useful to quickly find the corresponding frame for slightly increased time stamps
     */
    double mLastTime;
-   glm::uvec3 * mLastFramePosition;
+   std::vector<glm::uvec3> mLastFramePosition;
 
-   /** Array to return transformations results inside. */
-   std::vector<aiMatrix4x4> mTransforms;
+   std::vector<aiMatrix4x4> mChannelTransforms; ///< local transforms of channels
+   std::vector<aiMatrix4x4> mGlobalTransforms;  ///< by node
+   std::vector<aiMatrix4x4> mBoneMatrices;      ///< result of getBoneMatrices()
 
    /** Identity matrix to return a reference to in case of error */
    aiMatrix4x4 mIdentityMatrix;
-
-   const aiScene * mScene;
-   AnimationNode * mRootNode;
-   unsigned int mCurrentAnimationIndex;
-   const aiAnimation * mCurrentAnimation;
 };
 
 } /* namespace NApp */
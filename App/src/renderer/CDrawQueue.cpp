@@ -0,0 +1,133 @@
+#include <algorithm>
+#include "renderer/CDrawQueue.hpp"
+#include "renderer/CGLState.hpp"
+#include "renderer/CModel.hpp"
+#include "renderer/CShader.hpp"
+#include "renderer/CShaderLibrary.hpp"
+
+namespace NApp
+{
+
+static const UniformHandle<glm::mat4> UNIFORM_MODEL_MATRIX("modelMatrix");
+static const UniformHandle<glm::vec4> UNIFORM_MATERIAL_COLOR("materialColor");
+
+DrawCommand::DrawCommand()
+   : mVariant(0)
+   , mTexture(0)
+   , mMesh(0)
+   , mLod(0)
+   , mModelMatrix(1.f)
+   , mColor(1.f)
+   , mBones(0)
+   , mBoneCount(0)
+   , mFirstInstance(0)
+   , mInstanceCount(0)
+{
+}
+
+/** Orders commands by the most expensive state first. */
+struct CDrawQueue::CommandLess
+{
+   explicit CommandLess(const std::vector<DrawCommand> & commands)
+      : mCommands(commands)
+   {
+   }
+
+   bool operator()(unsigned int left, unsigned int right) const
+   {
+      const DrawCommand & a = mCommands[left];
+      const DrawCommand & b = mCommands[right];
+
+      if (a.mVariant != b.mVariant)
+      {
+         return a.mVariant < b.mVariant;
+      }
+      if (a.mTexture != b.mTexture)
+      {
+         return a.mTexture < b.mTexture;
+      }
+      if (a.mMesh->mVertexArray != b.mMesh->mVertexArray)
+      {
+         return a.mMesh->mVertexArray < b.mMesh->mVertexArray;
+      }
+      // keep order of submission within group
+      return left < right;
+   }
+
+   const std::vector<DrawCommand> & mCommands;
+};
+
+CDrawQueue::CDrawQueue()
+{
+}
+
+void CDrawQueue::add(const DrawCommand & command)
+{
+   mCommands.push_back(command);
+}
+
+void CDrawQueue::execute(CShaderLibrary & shaders, CGLState & state)
+{
+   mOrder.resize(mCommands.size());
+   for (size_t i = 0; i < mOrder.size(); ++i)
+   {
+      mOrder[i] = (unsigned int)i;
+   }
+   std::sort(mOrder.begin(), mOrder.end(), CommandLess(mCommands));
+
+   for (size_t i = 0; i < mOrder.size(); ++i)
+   {
+      const DrawCommand & command = mCommands[mOrder[i]];
+      const Mesh & mesh = *command.mMesh;
+
+      CShader & shader = shaders.bind(command.mVariant);
+      shader.setUniform(UNIFORM_MODEL_MATRIX, command.mModelMatrix);
+
+      if (0 != command.mBones)
+      {
+         shaders.setBones(shader, command.mBones, command.mBoneCount);
+      }
+
+      if (0 != command.mTexture)
+      {
+         state.bindTexture(0, command.mTexture);
+      }
+      else
+      {
+         shader.setUniform(UNIFORM_MATERIAL_COLOR, command.mColor);
+      }
+
+      if (0 != mesh.mVertexArray)
+      {
+         state.bindVertexArray(mesh.mVertexArray);
+      }
+      else
+      {
+         // vertex array objects aren't supported, attributes are set per draw
+         CModel::bindMeshBuffers(mesh);
+      }
+
+      const MeshLod & lod = mesh.mLods[command.mLod];
+      state.countDraws(shaders.drawElements(
+         mesh.mIndexType, lod.mIndexCount, lod.mFirstIndex,
+         command.mFirstInstance, command.mInstanceCount));
+
+      if (0 == mesh.mVertexArray)
+      {
+         CModel::unbindMeshBuffers();
+      }
+   }
+
+   if (false == mCommands.empty())
+   {
+      if (GLEW_VERSION_3_0 || GLEW_ARB_vertex_array_object)
+      {
+         state.bindVertexArray(0);
+      }
+      shaders.unbind();
+   }
+
+   mCommands.clear();
+}
+
+} /* namespace NApp */
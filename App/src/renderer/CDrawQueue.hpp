@@ -0,0 +1,62 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace NApp
+{
+
+struct Mesh;
+class CShaderLibrary;
+class CGLState;
+
+/** Draw of one mesh on range of instances of frame. */
+struct DrawCommand
+{
+   DrawCommand();
+
+   unsigned int mVariant;       ///< shader variant
+   GLuint mTexture;             ///< 0 if mesh isn't textured
+   const Mesh * mMesh;
+   unsigned int mLod;           ///< index of Mesh::mLods
+   glm::mat4 mModelMatrix;
+   glm::vec4 mColor;            ///< material color of untextured mesh
+   const glm::mat4 * mBones;    ///< 0 if mesh isn't skinned
+   unsigned int mBoneCount;
+   unsigned int mFirstInstance; ///< see CShaderLibrary::addInstances()
+   unsigned int mInstanceCount;
+};
+
+/**
+ * Draws of all models of frame. They are executed sorted by program,
+ * texture and vertex array, so each of them is bound once per group.
+ * Data referenced by commands must live until execute().
+ */
+class CDrawQueue
+{
+public:
+   CDrawQueue();
+
+   void add(const DrawCommand & command);
+
+   /** Execute and remove queued commands. */
+   void execute(CShaderLibrary & shaders, CGLState & state);
+
+   bool isEmpty() const;
+
+private:
+   struct CommandLess;
+
+private:
+   std::vector<DrawCommand> mCommands;
+   std::vector<unsigned int> mOrder; ///< indices of commands, kept to reuse memory
+};
+
+inline
+bool CDrawQueue::isEmpty() const
+{
+   return mCommands.empty();
+}
+
+} /* namespace NApp */
@@ -0,0 +1,129 @@
+#include "renderer/CFrustum.hpp"
+
+namespace NApp
+{
+
+BoundingVolume::BoundingVolume()
+   : mMin(1e10f)
+   , mMax(-1e10f)
+   , mCenter(0.f)
+   , mRadius(0.f)
+{
+}
+
+BoundingVolume::BoundingVolume(const glm::vec3 & min, const glm::vec3 & max)
+   : mMin(min)
+   , mMax(max)
+   , mCenter(0.f)
+   , mRadius(0.f)
+{
+   updateSphere();
+}
+
+void BoundingVolume::add(const glm::vec3 & point)
+{
+   mMin = glm::min(mMin, point);
+   mMax = glm::max(mMax, point);
+}
+
+void BoundingVolume::updateSphere()
+{
+   if (true == isEmpty())
+   {
+      return;
+   }
+   mCenter = (mMin + mMax) * 0.5f;
+   mRadius = glm::length(mMax - mCenter);
+}
+
+bool BoundingVolume::isEmpty() const
+{
+   return (mMin.x > mMax.x);
+}
+
+BoundingVolume BoundingVolume::transform(const glm::mat4 & matrix) const
+{
+   BoundingVolume result;
+   if (true == isEmpty())
+   {
+      return result;
+   }
+
+   for (int i = 0; i < 8; ++i)
+   {
+      const glm::vec3 corner(
+         (0 != (i & 1)) ? mMax.x : mMin.x,
+         (0 != (i & 2)) ? mMax.y : mMin.y,
+         (0 != (i & 4)) ? mMax.z : mMin.z);
+      result.add(glm::vec3(matrix * glm::vec4(corner, 1.f)));
+   }
+   result.updateSphere();
+   return result;
+}
+
+CFrustum::CFrustum(const glm::mat4 & clip)
+{
+   // rows of clip matrix, glm matrices are column major
+   glm::vec4 rows[4];
+   for (int i = 0; i < 4; ++i)
+   {
+      rows[i] = glm::vec4(clip[0][i], clip[1][i], clip[2][i], clip[3][i]);
+   }
+
+   mPlanes[0] = rows[3] + rows[0]; // left
+   mPlanes[1] = rows[3] - rows[0]; // right
+   mPlanes[2] = rows[3] + rows[1]; // bottom
+   mPlanes[3] = rows[3] - rows[1]; // top
+   mPlanes[4] = rows[3] + rows[2]; // near
+   mPlanes[5] = rows[3] - rows[2]; // far
+
+   // distances are then in units of the model, as radius of spheres
+   for (int i = 0; i < 6; ++i)
+   {
+      mPlanes[i] /= glm::length(glm::vec3(mPlanes[i]));
+   }
+}
+
+bool CFrustum::isVisible(const BoundingVolume & volume) const
+{
+   if (true == volume.isEmpty())
+   {
+      return false;
+   }
+
+   bool crossing = false;
+   for (int i = 0; i < 6; ++i)
+   {
+      const float distance = glm::dot(glm::vec3(mPlanes[i]), volume.mCenter) + mPlanes[i].w;
+      if (distance < -volume.mRadius)
+      {
+         return false;
+      }
+      if (distance < volume.mRadius)
+      {
+         crossing = true;
+      }
+   }
+
+   if (false == crossing)
+   {
+      return true;
+   }
+
+   // corner of box which is the farthest along normal of plane
+   for (int i = 0; i < 6; ++i)
+   {
+      const glm::vec3 normal(mPlanes[i]);
+      const glm::vec3 corner(
+         (normal.x > 0.f) ? volume.mMax.x : volume.mMin.x,
+         (normal.y > 0.f) ? volume.mMax.y : volume.mMin.y,
+         (normal.z > 0.f) ? volume.mMax.z : volume.mMin.z);
+      if (glm::dot(normal, corner) + mPlanes[i].w < 0.f)
+      {
+         return false;
+      }
+   }
+   return true;
+}
+
+} /* namespace NApp */
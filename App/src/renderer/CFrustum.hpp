@@ -0,0 +1,53 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace NApp
+{
+
+/** Axis aligned box and sphere around it, both in the same space. */
+struct BoundingVolume
+{
+   /** Constructor, volume is empty. */
+   BoundingVolume();
+
+   /** Constructor of box, sphere is computed from it. */
+   BoundingVolume(const glm::vec3 & min, const glm::vec3 & max);
+
+   /** Grow box by point, call updateSphere() after the last one. */
+   void add(const glm::vec3 & point);
+
+   void updateSphere();
+
+   bool isEmpty() const;
+
+   /** Get volume around this one transformed by matrix. */
+   BoundingVolume transform(const glm::mat4 & matrix) const;
+
+   glm::vec3 mMin;
+   glm::vec3 mMax;
+   glm::vec3 mCenter;
+   float mRadius;
+};
+
+/**
+ * Frustum planes extracted from clip matrix (projection * view * model),
+ * so they are in space of the model and volumes are tested untransformed.
+ */
+class CFrustum
+{
+public:
+   explicit CFrustum(const glm::mat4 & clip);
+
+   /**
+    * Test volume against frustum. Sphere decides most cases, box
+    * is tested only if sphere crosses some plane.
+    * @return false if volume is entirely outside
+    */
+   bool isVisible(const BoundingVolume & volume) const;
+
+private:
+   glm::vec4 mPlanes[6]; ///< xyz is normal to inside, w is distance
+};
+
+} /* namespace NApp */
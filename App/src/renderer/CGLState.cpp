@@ -0,0 +1,125 @@
+#include <iostream>
+#include "renderer/CGLState.hpp"
+
+namespace NApp
+{
+
+const GLuint CGLState::UNKNOWN = 0xffffffffu;
+
+CGLState::CGLState()
+{
+   invalidate();
+}
+
+void CGLState::invalidate()
+{
+   mProgram = UNKNOWN;
+   mActiveUnit = UNKNOWN;
+   for (GLuint i = 0; i < TEXTURE_UNITS; ++i)
+   {
+      mTextures[i] = UNKNOWN;
+   }
+   mVertexArray = UNKNOWN;
+   for (int i = 0; i < Capability::COUNT; ++i)
+   {
+      mCapabilities[i] = UNKNOWN;
+   }
+}
+
+bool CGLState::change(GLuint & current, GLuint value)
+{
+   if (current == value)
+   {
+      ++mStats.SkippedChanges;
+      return false;
+   }
+
+   current = value;
+   ++mStats.StateChanges;
+   return true;
+}
+
+void CGLState::useProgram(GLuint program)
+{
+   if (true == change(mProgram, program))
+   {
+      glUseProgram(program);
+   }
+}
+
+void CGLState::bindTexture(GLuint unit, GLuint texture)
+{
+   if (unit >= TEXTURE_UNITS)
+   {
+      glActiveTexture(GL_TEXTURE0 + unit);
+      glBindTexture(GL_TEXTURE_2D, texture);
+      mActiveUnit = unit;
+      mStats.StateChanges += 2;
+      return;
+   }
+
+   if (mTextures[unit] == texture)
+   {
+      ++mStats.SkippedChanges;
+      return;
+   }
+
+   if (mActiveUnit != unit)
+   {
+      glActiveTexture(GL_TEXTURE0 + unit);
+      mActiveUnit = unit;
+      ++mStats.StateChanges;
+   }
+
+   glBindTexture(GL_TEXTURE_2D, texture);
+   mTextures[unit] = texture;
+   ++mStats.StateChanges;
+}
+
+void CGLState::bindVertexArray(GLuint vertexArray)
+{
+   if (true == change(mVertexArray, vertexArray))
+   {
+      glBindVertexArray(vertexArray);
+   }
+}
+
+void CGLState::setEnabled(GLenum capability, bool enabled)
+{
+   Capability::EIndex index;
+   switch (capability)
+   {
+   case GL_BLEND:      index = Capability::BLEND;      break;
+   case GL_DEPTH_TEST: index = Capability::DEPTH_TEST; break;
+   case GL_CULL_FACE:  index = Capability::CULL_FACE;  break;
+   default:
+      std::cerr << "Capability " << capability << " isn't tracked." << std::endl;
+      return;
+   }
+
+   if (true == change(mCapabilities[index], (true == enabled) ? GL_TRUE : GL_FALSE))
+   {
+      if (true == enabled)
+      {
+         glEnable(capability);
+      }
+      else
+      {
+         glDisable(capability);
+      }
+   }
+}
+
+void CGLState::countDraws(unsigned int count)
+{
+   mStats.DrawCalls += count;
+}
+
+GLStateStats CGLState::takeStats()
+{
+   const GLStateStats stats = mStats;
+   mStats = GLStateStats();
+   return stats;
+}
+
+} /* namespace NApp */
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <GL/glew.h>
+
+namespace NApp
+{
+
+/** Counters of GL calls since the last reset. */
+struct GLStateStats
+{
+   GLStateStats()
+      : DrawCalls(0)
+      , StateChanges(0)
+      , SkippedChanges(0)
+   {
+   }
+
+   unsigned int DrawCalls;
+   unsigned int StateChanges;   ///< state calls passed to GL
+   unsigned int SkippedChanges; ///< redundant state calls which were skipped
+};
+
+/**
+ * Shadow of GL state: program, textures, vertex array and capabilities.
+ *
+ * Calls which wouldn't change the state are skipped. Code which changes
+ * the state directly must be followed by invalidate(), then the next
+ * call of each kind goes to GL again.
+ */
+class CGLState
+{
+public:
+   /** Constructor, state is unknown. */
+   CGLState();
+
+   /** Forget tracked state. */
+   void invalidate();
+
+   void useProgram(GLuint program);
+   void bindTexture(GLuint unit, GLuint texture);
+   void bindVertexArray(GLuint vertexArray);
+
+   /**
+    * Enable or disable capability.
+    * @param capability GL_BLEND, GL_DEPTH_TEST or GL_CULL_FACE
+    */
+   void setEnabled(GLenum capability, bool enabled);
+
+   /** Count draw calls issued by caller. */
+   void countDraws(unsigned int count);
+
+   /** Get counters and reset them. */
+   GLStateStats takeStats();
+
+private:
+   bool change(GLuint & current, GLuint value);
+
+private:
+   static const GLuint UNKNOWN;
+   static const GLuint TEXTURE_UNITS = 4u;
+
+   /** Tracked capabilities. */
+   struct Capability
+   {
+      enum EIndex
+      {
+         BLEND = 0,
+         DEPTH_TEST,
+         CULL_FACE,
+         COUNT
+      };
+   };
+
+private:
+   GLuint mProgram;
+   GLuint mActiveUnit;
+   GLuint mTextures[TEXTURE_UNITS];
+   GLuint mVertexArray;
+   GLuint mCapabilities[Capability::COUNT]; ///< GL_TRUE, GL_FALSE or UNKNOWN
+
+   GLStateStats mStats;
+};
+
+} /* namespace NApp */
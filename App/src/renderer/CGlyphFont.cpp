@@ -0,0 +1,125 @@
+#include <iostream>
+#include <SDL_ttf.h>
+#include "renderer/CGlyphFont.hpp"
+#include "renderer/CTextureAtlas.hpp"
+
+namespace NApp
+{
+
+const int CGlyphFont::FIRST_CHAR = 32;
+const int CGlyphFont::LAST_CHAR = 126;
+/** Text like FPS counters changes every frame, so cache is dropped once it grows. */
+const size_t CGlyphFont::MAX_CACHED_LAYOUTS = 256u;
+
+CGlyphFont::Glyph::Glyph()
+   : valid(false)
+   , offset(0.f)
+   , size(0.f)
+   , texMin(0.f)
+   , texMax(0.f)
+   , advance(0.f)
+{
+}
+
+CGlyphFont::CGlyphFont()
+{
+}
+
+bool CGlyphFont::create(const std::string & path, int size, CTextureAtlas & atlas)
+{
+   TTF_Font * font = TTF_OpenFont(path.c_str(), size);
+   if (0 == font)
+   {
+      std::cerr << "TTF_OpenFont() failed: '" << path << "'." << std::endl;
+      return false;
+   }
+
+   const int ascent = TTF_FontAscent(font);
+   const SDL_Color white = { 255, 255, 255 };
+   bool result = true;
+
+   mGlyphs.assign(LAST_CHAR - FIRST_CHAR + 1, Glyph());
+   mLayouts.clear();
+
+   for (int ch = FIRST_CHAR; ch <= LAST_CHAR && true == result; ++ch)
+   {
+      int minx = 0, maxx = 0, miny = 0, maxy = 0, advance = 0;
+      if (0 == TTF_GlyphIsProvided(font, (Uint16)ch)
+       || 0 != TTF_GlyphMetrics(font, (Uint16)ch, &minx, &maxx, &miny, &maxy, &advance))
+      {
+         continue;
+      }
+
+      Glyph & glyph = mGlyphs[ch - FIRST_CHAR];
+      glyph.advance = (float)advance;
+
+      // white glyph, color is applied by vertices
+      SDL_Surface * surface = TTF_RenderGlyph_Blended(font, (Uint16)ch, white);
+      if (0 == surface)
+      {
+         continue;
+      }
+
+      result = atlas.insert(
+         surface->w, surface->h,
+         GL_BGRA, surface->pixels, surface->pitch,
+         glyph.texMin, glyph.texMax);
+
+      glyph.valid = result;
+      glyph.offset = glm::vec2((float)minx, (float)(ascent - maxy));
+      glyph.size = glm::vec2((float)surface->w, (float)surface->h);
+
+      SDL_FreeSurface(surface);
+   }
+
+   TTF_CloseFont(font);
+
+   if (false == result)
+   {
+      std::cerr << "Texture atlas is full, font size " << size << "." << std::endl;
+   }
+   return result;
+}
+
+const CGlyphFont::tLayout & CGlyphFont::layout(const std::string & text)
+{
+   tLayoutCache::iterator it = mLayouts.find(text);
+   if (mLayouts.end() != it)
+   {
+      return it->second;
+   }
+
+   if (mLayouts.size() >= MAX_CACHED_LAYOUTS)
+   {
+      mLayouts.clear();
+   }
+
+   tLayout & quads = mLayouts[text];
+   quads.reserve(text.size());
+
+   float pen = 0.f;
+   for (size_t i = 0; i < text.size(); ++i)
+   {
+      const int ch = (unsigned char)text[i];
+      if (ch < FIRST_CHAR || (size_t)(ch - FIRST_CHAR) >= mGlyphs.size())
+      {
+         continue;
+      }
+
+      const Glyph & glyph = mGlyphs[ch - FIRST_CHAR];
+      if (true == glyph.valid && glyph.size.x > 0.f && glyph.size.y > 0.f)
+      {
+         GlyphQuad quad;
+         quad.position = glm::vec2(pen, 0.f) + glyph.offset;
+         quad.size = glyph.size;
+         quad.texMin = glyph.texMin;
+         quad.texMax = glyph.texMax;
+         quads.push_back(quad);
+      }
+      pen += glyph.advance;
+   }
+
+   return quads;
+}
+
+} /* namespace NApp */
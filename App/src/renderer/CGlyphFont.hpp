@@ -0,0 +1,75 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace NApp
+{
+
+class CTextureAtlas;
+
+/**
+ * Font rasterized once into texture atlas.
+ *
+ * Printable ASCII glyphs are rendered by SDL_ttf at creation, text is then
+ * laid out as a list of textured quads. Layouts of recently used strings are
+ * cached, so static labels are laid out only once.
+ */
+class CGlyphFont
+{
+public:
+   /** Quad of one glyph, position is relative to top left corner of text. */
+   struct GlyphQuad
+   {
+      glm::vec2 position;
+      glm::vec2 size;
+      glm::vec2 texMin;
+      glm::vec2 texMax;
+   };
+
+   typedef std::vector<GlyphQuad> tLayout;
+
+public:
+   /** Constructor. */
+   CGlyphFont();
+
+   /**
+    * Rasterize glyphs of font into atlas.
+    * @param path path to TTF file
+    * @param size point size
+    * @param atlas atlas for glyphs
+    * @return true if success, false - otherwise.
+    */
+   bool create(const std::string & path, int size, CTextureAtlas & atlas);
+
+   /** Get quads of text (cached). Unknown characters are skipped. */
+   const tLayout & layout(const std::string & text);
+
+private:
+   struct Glyph
+   {
+      Glyph();
+
+      bool valid;
+      glm::vec2 offset; ///< from pen position at top of line
+      glm::vec2 size;
+      glm::vec2 texMin;
+      glm::vec2 texMax;
+      float advance;
+   };
+
+   typedef std::map<std::string, tLayout> tLayoutCache;
+
+private:
+   static const int FIRST_CHAR;
+   static const int LAST_CHAR;
+   static const size_t MAX_CACHED_LAYOUTS;
+
+private:
+   std::vector<Glyph> mGlyphs;
+   tLayoutCache mLayouts;
+};
+
+} /* namespace NApp */
@@ -0,0 +1,289 @@
+#include <cstring>
+#include <iostream>
+#include "renderer/CGpuPreprocessor.hpp"
+#include "renderer/CShader.hpp"
+#include "renderer/ShaderData.hpp"
+
+namespace NApp
+{
+
+/** Mip level used as local mean: 8x8 texels of downscaled image. */
+const float CGpuPreprocessor::MEAN_LEVEL = 3.f;
+/** Same offset as CPU threshold (5 of 255). */
+const float CGpuPreprocessor::THRESHOLD_OFFSET = 5.f / 255.f;
+
+static const UniformHandle<int> UNIFORM_FRAME("frame");
+static const UniformHandle<glm::vec2> UNIFORM_TEX_SCALE("texScale");
+static const UniformHandle<int> UNIFORM_GRAY("gray");
+static const UniformHandle<float> UNIFORM_MEAN_LEVEL("meanLevel");
+static const UniformHandle<float> UNIFORM_OFFSET("offset");
+
+static const GLfloat QUAD_VERTICES[] = {
+   -1.f, -1.f,
+    1.f, -1.f,
+   -1.f,  1.f,
+    1.f,  1.f
+};
+
+CGpuPreprocessor::CGpuPreprocessor(unsigned int downscale)
+   : mDownscale((0u == downscale) ? 1u : downscale)
+   , mWidth(0)
+   , mHeight(0)
+   , mQuadBuffer(0)
+   , mFramebuffer(0)
+   , mGrayTexture(0)
+   , mBinaryTexture(0)
+   , mWriteIndex(0)
+{
+   for (unsigned int i = 0; i < PIXEL_BUFFERS; ++i)
+   {
+      mPixelBuffers[i] = 0;
+      mFences[i] = 0;
+      mReady[i] = false;
+   }
+}
+
+CGpuPreprocessor::~CGpuPreprocessor()
+{
+   releaseTargets();
+
+   if (0 != mFramebuffer)
+   {
+      glDeleteFramebuffers(1, &mFramebuffer);
+   }
+   if (0 != mQuadBuffer)
+   {
+      glDeleteBuffers(1, &mQuadBuffer);
+   }
+}
+
+bool CGpuPreprocessor::initialize()
+{
+   if (!GLEW_VERSION_3_0 && !GLEW_ARB_framebuffer_object)
+   {
+      std::cerr << "GL_ARB_framebuffer_object isn't supported." << std::endl;
+      return false;
+   }
+   if (!GLEW_VERSION_2_1 && !GLEW_ARB_pixel_buffer_object)
+   {
+      std::cerr << "GL_ARB_pixel_buffer_object isn't supported." << std::endl;
+      return false;
+   }
+
+   mGrayShader = std::make_shared<CShader>(
+      PREPROCESS_VERTEX_SOURCE,
+      PREPROCESS_GRAY_FRAGMENT_SOURCE);
+
+   mThresholdShader = std::make_shared<CShader>(
+      PREPROCESS_VERTEX_SOURCE,
+      PREPROCESS_THRESHOLD_FRAGMENT_SOURCE);
+
+   glGenBuffers(1, &mQuadBuffer);
+   glBindBuffer(GL_ARRAY_BUFFER, mQuadBuffer);
+   glBufferData(GL_ARRAY_BUFFER, sizeof(QUAD_VERTICES), QUAD_VERTICES, GL_STATIC_DRAW);
+   glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+   glGenFramebuffers(1, &mFramebuffer);
+
+   return true;
+}
+
+void CGpuPreprocessor::createTargets(int width, int height)
+{
+   releaseTargets();
+
+   mWidth = width;
+   mHeight = height;
+
+   // single channel targets are renderable only with ARB_texture_rg
+   const GLint internalFormat = (GLEW_VERSION_3_0 || GLEW_ARB_texture_rg) ? GL_R8 : GL_RGBA8;
+
+   glGenTextures(1, &mGrayTexture);
+   glBindTexture(GL_TEXTURE_2D, mGrayTexture);
+   glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, mWidth, mHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+   glGenerateMipmap(GL_TEXTURE_2D);
+
+   glGenTextures(1, &mBinaryTexture);
+   glBindTexture(GL_TEXTURE_2D, mBinaryTexture);
+   glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, mWidth, mHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+   glBindTexture(GL_TEXTURE_2D, 0);
+
+   glGenBuffers(PIXEL_BUFFERS, mPixelBuffers);
+   for (unsigned int i = 0; i < PIXEL_BUFFERS; ++i)
+   {
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, mPixelBuffers[i]);
+      glBufferData(GL_PIXEL_PACK_BUFFER, mWidth * mHeight, 0, GL_STREAM_READ);
+   }
+   glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void CGpuPreprocessor::releaseTargets()
+{
+   for (unsigned int i = 0; i < PIXEL_BUFFERS; ++i)
+   {
+      releaseFence(i);
+      mReady[i] = false;
+      mSources[i].release();
+   }
+
+   if (0 != mPixelBuffers[0])
+   {
+      glDeleteBuffers(PIXEL_BUFFERS, mPixelBuffers);
+      for (unsigned int i = 0; i < PIXEL_BUFFERS; ++i)
+      {
+         mPixelBuffers[i] = 0;
+      }
+   }
+   if (0 != mGrayTexture)
+   {
+      glDeleteTextures(1, &mGrayTexture);
+      mGrayTexture = 0;
+   }
+   if (0 != mBinaryTexture)
+   {
+      glDeleteTextures(1, &mBinaryTexture);
+      mBinaryTexture = 0;
+   }
+}
+
+void CGpuPreprocessor::process(GLuint frameTexture, const cv::Mat & frame, const glm::vec2 & texScale)
+{
+   const int targetWidth = frame.cols / mDownscale;
+   const int targetHeight = frame.rows / mDownscale;
+   if (targetWidth != mWidth || targetHeight != mHeight)
+   {
+      createTargets(targetWidth, targetHeight);
+   }
+
+   glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+   glViewport(0, 0, mWidth, mHeight);
+   glDisable(GL_BLEND);
+   glActiveTexture(GL_TEXTURE0);
+
+   // grayscale and downscale, bilinear fetch averages 2x2 texels
+   glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mGrayTexture, 0);
+   glBindTexture(GL_TEXTURE_2D, frameTexture);
+   mGrayShader->bind();
+   mGrayShader->setUniform(UNIFORM_FRAME, 0);
+   mGrayShader->setUniform(UNIFORM_TEX_SCALE, texScale);
+   drawQuad();
+
+   // mip chain of grayscale image gives local means
+   glBindTexture(GL_TEXTURE_2D, mGrayTexture);
+   glGenerateMipmap(GL_TEXTURE_2D);
+
+   glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mBinaryTexture, 0);
+   mThresholdShader->bind();
+   mThresholdShader->setUniform(UNIFORM_GRAY, 0);
+   mThresholdShader->setUniform(UNIFORM_MEAN_LEVEL, MEAN_LEVEL);
+   mThresholdShader->setUniform(UNIFORM_OFFSET, THRESHOLD_OFFSET);
+   drawQuad();
+   mThresholdShader->unbind();
+
+   // asynchronous readback, rows come bottom-up which matches frame rows order
+   const unsigned int slot = mWriteIndex;
+   releaseFence(slot);
+
+   glPixelStorei(GL_PACK_ALIGNMENT, 1);
+   glBindBuffer(GL_PIXEL_PACK_BUFFER, mPixelBuffers[slot]);
+   glReadPixels(0, 0, mWidth, mHeight, GL_RED, GL_UNSIGNED_BYTE, 0);
+   glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+   if (GLEW_VERSION_3_2 || GLEW_ARB_sync)
+   {
+      mFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+   }
+   mReady[slot] = true;
+   mSources[slot] = frame;
+   mWriteIndex = (mWriteIndex + 1) % PIXEL_BUFFERS;
+
+   glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+   glBindFramebuffer(GL_FRAMEBUFFER, 0);
+   glBindTexture(GL_TEXTURE_2D, 0);
+   glEnable(GL_BLEND);
+}
+
+bool CGpuPreprocessor::getResult(cv::Mat & binary, cv::Mat & source)
+{
+   // the newest finished readback, mapping of pending one would wait for GPU
+   unsigned int age = 0;
+   for (unsigned int k = 1; k <= PIXEL_BUFFERS && 0 == age; ++k)
+   {
+      const unsigned int slot = (mWriteIndex + PIXEL_BUFFERS - k) % PIXEL_BUFFERS;
+      if (true == mReady[slot] && true == isFinished(slot))
+      {
+         age = k;
+      }
+   }
+
+   if (0 == age)
+   {
+      return false;
+   }
+
+   const unsigned int selected = (mWriteIndex + PIXEL_BUFFERS - age) % PIXEL_BUFFERS;
+
+   glBindBuffer(GL_PIXEL_PACK_BUFFER, mPixelBuffers[selected]);
+   const void * data = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+   if (0 != data)
+   {
+      binary.create(mHeight, mWidth, CV_8U);
+      memcpy(binary.data, data, mWidth * mHeight);
+      glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+      source = mSources[selected];
+   }
+   glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+   // selected result and everything older are consumed
+   for (unsigned int k = age; k <= PIXEL_BUFFERS; ++k)
+   {
+      const unsigned int slot = (mWriteIndex + PIXEL_BUFFERS - k) % PIXEL_BUFFERS;
+      releaseFence(slot);
+      mReady[slot] = false;
+      mSources[slot].release();
+   }
+
+   return (0 != data);
+}
+
+void CGpuPreprocessor::drawQuad()
+{
+   glBindBuffer(GL_ARRAY_BUFFER, mQuadBuffer);
+   glEnableVertexAttribArray(VertexAttribute::POSITION);
+   glVertexAttribPointer(VertexAttribute::POSITION, 2, GL_FLOAT, GL_FALSE, 0, 0);
+
+   glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+   glDisableVertexAttribArray(VertexAttribute::POSITION);
+   glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+bool CGpuPreprocessor::isFinished(unsigned int slot) const
+{
+   if (0 == mFences[slot])
+   {
+      // without sync objects readback is taken once a newer one was issued
+      return (slot != (mWriteIndex + PIXEL_BUFFERS - 1) % PIXEL_BUFFERS);
+   }
+
+   const GLenum status = glClientWaitSync(mFences[slot], 0, 0);
+   return (GL_ALREADY_SIGNALED == status) || (GL_CONDITION_SATISFIED == status);
+}
+
+void CGpuPreprocessor::releaseFence(unsigned int slot)
+{
+   if (0 != mFences[slot])
+   {
+      glDeleteSync(mFences[slot]);
+      mFences[slot] = 0;
+   }
+}
+
+} /* namespace NApp */
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <opencv2/opencv.hpp>
+
+namespace NApp
+{
+
+class CShader;
+
+/**
+ * Prepares camera frame for markers detection on GPU.
+ *
+ * Frame texture which is already uploaded for background is converted to
+ * grayscale, downscaled and thresholded against local mean in fragment
+ * shaders. Only the small binary image is read back, asynchronously through
+ * pixel pack buffers, so result of process() is available in one of the next
+ * frames. Source frame is kept with its readback, detector works on the
+ * frame the binary image was made from. Uses only OpenGL 2.1 + FBO features, so it works on Mesa's
+ * software rasterizer as well.
+ */
+class CGpuPreprocessor
+{
+public:
+   /**
+    * Constructor.
+    * @param downscale ratio between frame and binary image size.
+    */
+   explicit CGpuPreprocessor(unsigned int downscale);
+
+   /** Destructor. */
+   ~CGpuPreprocessor();
+
+   /**
+    * Create GL resources.
+    * @return false if required extensions are not supported.
+    */
+   bool initialize();
+
+   /**
+    * Run preprocessing passes and start readback of binary image.
+    * Changes viewport, program and texture bindings; restores default framebuffer.
+    * @param frameTexture RGB texture with camera frame
+    * @param frame camera frame in texture, kept till its result is taken
+    * @param texScale texture coordinates of bottom right corner of frame
+    */
+   void process(GLuint frameTexture, const cv::Mat & frame, const glm::vec2 & texScale);
+
+   /**
+    * Get the most recent finished binary image (dark pixels are 255).
+    * Each result is returned only once, readback which GPU hasn't finished
+    * is never waited for.
+    * @param[out] source frame binary image was made from
+    * @return false if there is no new finished result yet.
+    */
+   bool getResult(cv::Mat & binary, cv::Mat & source);
+
+private:
+   void createTargets(int width, int height);
+   void releaseTargets();
+   void drawQuad();
+   bool isFinished(unsigned int slot) const;
+   void releaseFence(unsigned int slot);
+
+private:
+   static const unsigned int PIXEL_BUFFERS = 2u;
+   static const float MEAN_LEVEL;
+   static const float THRESHOLD_OFFSET;
+
+private:
+   unsigned int mDownscale;
+   int mWidth;
+   int mHeight;
+
+   std::shared_ptr<CShader> mGrayShader;
+   std::shared_ptr<CShader> mThresholdShader;
+
+   GLuint mQuadBuffer;
+   GLuint mFramebuffer;
+   GLuint mGrayTexture;
+   GLuint mBinaryTexture;
+
+   GLuint mPixelBuffers[PIXEL_BUFFERS];
+   GLsync mFences[PIXEL_BUFFERS];
+   bool mReady[PIXEL_BUFFERS];
+   cv::Mat mSources[PIXEL_BUFFERS]; ///< frames of readbacks
+   unsigned int mWriteIndex;
+};
+
+} /* namespace NApp */
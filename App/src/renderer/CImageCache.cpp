@@ -0,0 +1,94 @@
+#include <iostream>
+#include "renderer/CImageCache.hpp"
+#include "renderer/CTextureAtlas.hpp"
+
+namespace NApp
+{
+
+CImageCache::CImageCache(CTextureAtlas & atlas)
+   : mAtlas(atlas)
+{
+}
+
+CImageCache::~CImageCache()
+{
+   if (false == mOwnTextures.empty())
+   {
+      glDeleteTextures((GLsizei)mOwnTextures.size(), &mOwnTextures[0]);
+   }
+}
+
+tImageHandle CImageCache::load(const std::string & path)
+{
+   tHandles::const_iterator it = mHandles.find(path);
+   if (mHandles.end() != it)
+   {
+      return it->second;
+   }
+
+   // failures are remembered as well, so missing file isn't read again
+   tImageHandle & handle = mHandles[path];
+   handle = INVALID_IMAGE;
+
+   IconData icon = IconData::loadFromFile(path);
+   if (true == icon.img.empty() || CV_8U != icon.img.depth())
+   {
+      std::cerr << "Image isn't loaded: '" << path << "'." << std::endl;
+      return handle;
+   }
+
+   cv::Mat bgra;
+   switch (icon.img.channels())
+   {
+   case 1:  cv::cvtColor(icon.img, bgra, CV_GRAY2BGRA); break;
+   case 3:  cv::cvtColor(icon.img, bgra, CV_BGR2BGRA); break;
+   default: bgra = icon.img; break;
+   }
+
+   Image image;
+   image.size = glm::vec2((float)bgra.cols, (float)bgra.rows);
+   image.texture = mAtlas.getTexture();
+
+   if (false == mAtlas.insert(
+         bgra.cols, bgra.rows,
+         GL_BGRA, bgra.data, (int)bgra.step,
+         image.texMin, image.texMax))
+   {
+      glGenTextures(1, &image.texture);
+      glBindTexture(GL_TEXTURE_2D, image.texture);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+      glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint)(bgra.step / 4));
+      glTexImage2D(
+         GL_TEXTURE_2D,
+         0,
+         GL_RGBA,
+         bgra.cols, bgra.rows,
+         0,
+         GL_BGRA, GL_UNSIGNED_BYTE,
+         bgra.data);
+      glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+      glBindTexture(GL_TEXTURE_2D, 0);
+
+      image.texMin = glm::vec2(0.f);
+      image.texMax = glm::vec2(1.f);
+      mOwnTextures.push_back(image.texture);
+   }
+
+   mImages.push_back(image);
+   handle = (tImageHandle)mImages.size();
+
+   return handle;
+}
+
+const CImageCache::Image * CImageCache::get(tImageHandle handle) const
+{
+   if (INVALID_IMAGE == handle || handle > mImages.size())
+   {
+      return 0;
+   }
+   return &mImages[handle - 1];
+}
+
+} /* namespace NApp */
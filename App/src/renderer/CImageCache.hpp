@@ -0,0 +1,68 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <map>
+#include <string>
+#include <vector>
+#include "renderer/IRenderer.hpp"
+
+namespace NApp
+{
+
+class CTextureAtlas;
+
+/**
+ * Images loaded once and referenced by handle.
+ *
+ * Each path is read and decoded only at the first request, repeated
+ * requests return the same handle. Pixels are packed into texture atlas
+ * (the one shared with fonts), so overlays are drawn from one texture.
+ * Images which don't fit into atlas get own texture.
+ */
+class CImageCache
+{
+public:
+   /** Image placement in texture. */
+   struct Image
+   {
+      GLuint texture;
+      glm::vec2 size;
+      glm::vec2 texMin;
+      glm::vec2 texMax;
+   };
+
+public:
+   /**
+    * Constructor.
+    * @param atlas atlas for images, must outlive cache
+    */
+   explicit CImageCache(CTextureAtlas & atlas);
+
+   /** Destructor. */
+   ~CImageCache();
+
+   /**
+    * Get handle of image, load it if it isn't loaded yet.
+    * @return INVALID_IMAGE if image can't be loaded.
+    */
+   tImageHandle load(const std::string & path);
+
+   /** Get image by handle, 0 for invalid handle. */
+   const Image * get(tImageHandle handle) const;
+
+private:
+   CImageCache(const CImageCache &);
+   CImageCache & operator=(const CImageCache &);
+
+private:
+   typedef std::map<std::string, tImageHandle> tHandles;
+
+private:
+   CTextureAtlas & mAtlas;
+   tHandles mHandles;
+   std::vector<Image> mImages;
+   std::vector<GLuint> mOwnTextures;
+};
+
+} /* namespace NApp */
@@ -0,0 +1,326 @@
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include "renderer/CMeshSimplifier.hpp"
+
+namespace NApp
+{
+
+const unsigned int CMeshSimplifier::REMOVED = 0xffffffffu;
+const double CMeshSimplifier::BORDER_WEIGHT = 100.;
+const float CMeshSimplifier::MAX_SKIN_DISTANCE = 0.25f;
+const float CMeshSimplifier::MIN_NORMAL_DOT = 0.2f;
+
+CMeshSimplifier::Quadric::Quadric()
+{
+   std::fill(m, m + 10, 0.);
+}
+
+void CMeshSimplifier::Quadric::addPlane(const glm::dvec3 & normal, double distance, double weight)
+{
+   const double & a = normal.x;
+   const double & b = normal.y;
+   const double & c = normal.z;
+   const double & d = distance;
+
+   m[0] += weight * a * a; m[1] += weight * a * b; m[2] += weight * a * c; m[3] += weight * a * d;
+   m[4] += weight * b * b; m[5] += weight * b * c; m[6] += weight * b * d;
+   m[7] += weight * c * c; m[8] += weight * c * d;
+   m[9] += weight * d * d;
+}
+
+void CMeshSimplifier::Quadric::add(const Quadric & other)
+{
+   for (int i = 0; i < 10; ++i)
+   {
+      m[i] += other.m[i];
+   }
+}
+
+double CMeshSimplifier::Quadric::evaluate(const glm::dvec3 & p) const
+{
+   return m[0] * p.x * p.x + 2. * m[1] * p.x * p.y + 2. * m[2] * p.x * p.z + 2. * m[3] * p.x
+        + m[4] * p.y * p.y + 2. * m[5] * p.y * p.z + 2. * m[6] * p.y
+        + m[7] * p.z * p.z + 2. * m[8] * p.z
+        + m[9];
+}
+
+bool CMeshSimplifier::Collapse::operator>(const Collapse & other) const
+{
+   return cost > other.cost;
+}
+
+CMeshSimplifier::CMeshSimplifier(const std::vector<glm::vec3> & positions, const std::vector<unsigned int> & indices)
+   : mPositions(positions)
+   , mTriangles(indices)
+   , mLiveTriangles(indices.size() / 3)
+   , mVertexTriangles(positions.size())
+   , mQuadrics(positions.size())
+   , mVersions(positions.size(), 0)
+   , mRemoved(positions.size(), false)
+   , mInitialized(false)
+{
+   mTriangles.resize(mLiveTriangles * 3);
+   for (size_t i = 0; i < mTriangles.size(); ++i)
+   {
+      mVertexTriangles[mTriangles[i]].push_back((unsigned int)(i / 3));
+   }
+}
+
+void CMeshSimplifier::setSkin(const std::vector<glm::vec4> & boneIndices, const std::vector<glm::vec4> & boneWeights)
+{
+   mBoneIndices = boneIndices;
+   mBoneWeights = boneWeights;
+}
+
+void CMeshSimplifier::simplify(size_t targetIndexCount, std::vector<unsigned int> & indices)
+{
+   if (false == mInitialized)
+   {
+      initQuadrics();
+      for (unsigned int i = 0; i < mPositions.size(); ++i)
+      {
+         pushCollapses(i);
+      }
+      mInitialized = true;
+   }
+
+   while (mLiveTriangles * 3 > targetIndexCount && false == mCollapses.empty())
+   {
+      const Collapse top = mCollapses.top();
+      mCollapses.pop();
+
+      if ( true == mRemoved[top.from]
+        || true == mRemoved[top.to]
+        || mVersions[top.from] != top.fromVersion
+        || mVersions[top.to] != top.toVersion)
+      {
+         continue;
+      }
+
+      if (false == canCollapse(top.from, top.to))
+      {
+         continue;
+      }
+
+      collapse(top.from, top.to);
+   }
+
+   indices.clear();
+   indices.reserve(mLiveTriangles * 3);
+   for (unsigned int i = 0; i < mTriangles.size() / 3; ++i)
+   {
+      if (true == isAlive(i))
+      {
+         indices.insert(indices.end(), mTriangles.begin() + i * 3, mTriangles.begin() + i * 3 + 3);
+      }
+   }
+}
+
+void CMeshSimplifier::initQuadrics()
+{
+   // edges used by one triangle are borders, key is (min, max) vertex
+   typedef std::map<std::pair<unsigned int, unsigned int>, unsigned int> tEdges;
+   tEdges edges;
+
+   for (unsigned int t = 0; t < mTriangles.size() / 3; ++t)
+   {
+      const unsigned int * v = &mTriangles[t * 3];
+      const glm::dvec3 p0(mPositions[v[0]]);
+      const glm::dvec3 cross = glm::cross(glm::dvec3(mPositions[v[1]]) - p0, glm::dvec3(mPositions[v[2]]) - p0);
+      const double area = glm::length(cross);
+      if (0. == area)
+      {
+         continue;
+      }
+
+      const glm::dvec3 normal = cross / area;
+      for (int i = 0; i < 3; ++i)
+      {
+         mQuadrics[v[i]].addPlane(normal, -glm::dot(normal, p0), area);
+
+         const unsigned int a = v[i];
+         const unsigned int b = v[(i + 1) % 3];
+         ++edges[std::make_pair(std::min(a, b), std::max(a, b))];
+      }
+   }
+
+   // plane through border edge perpendicular to its triangle keeps outline
+   for (unsigned int t = 0; t < mTriangles.size() / 3; ++t)
+   {
+      const unsigned int * v = &mTriangles[t * 3];
+      const glm::dvec3 faceNormal(getNormal(v[0], v[1], v[2]));
+
+      for (int i = 0; i < 3; ++i)
+      {
+         const unsigned int a = v[i];
+         const unsigned int b = v[(i + 1) % 3];
+         if (1 != edges[std::make_pair(std::min(a, b), std::max(a, b))])
+         {
+            continue;
+         }
+
+         const glm::dvec3 pa(mPositions[a]);
+         const glm::dvec3 edge = glm::dvec3(mPositions[b]) - pa;
+         const glm::dvec3 cross = glm::cross(edge, faceNormal);
+         const double length = glm::length(cross);
+         if (0. == length)
+         {
+            continue;
+         }
+
+         const glm::dvec3 normal = cross / length;
+         const double weight = BORDER_WEIGHT * glm::dot(edge, edge);
+         mQuadrics[a].addPlane(normal, -glm::dot(normal, pa), weight);
+         mQuadrics[b].addPlane(normal, -glm::dot(normal, pa), weight);
+      }
+   }
+}
+
+void CMeshSimplifier::pushCollapse(unsigned int from, unsigned int to)
+{
+   if (false == mBoneWeights.empty() && getSkinDistance(from, to) > MAX_SKIN_DISTANCE)
+   {
+      return;
+   }
+
+   Quadric quadric = mQuadrics[from];
+   quadric.add(mQuadrics[to]);
+
+   Collapse collapse;
+   collapse.cost = std::max(0., quadric.evaluate(glm::dvec3(mPositions[to])));
+   collapse.from = from;
+   collapse.to = to;
+   collapse.fromVersion = mVersions[from];
+   collapse.toVersion = mVersions[to];
+   mCollapses.push(collapse);
+}
+
+void CMeshSimplifier::pushCollapses(unsigned int vertex)
+{
+   const std::vector<unsigned int> & triangles = mVertexTriangles[vertex];
+   for (size_t i = 0; i < triangles.size(); ++i)
+   {
+      if (false == isAlive(triangles[i]))
+      {
+         continue;
+      }
+
+      const unsigned int * v = &mTriangles[triangles[i] * 3];
+      for (int j = 0; j < 3; ++j)
+      {
+         if (vertex != v[j])
+         {
+            pushCollapse(vertex, v[j]);
+            pushCollapse(v[j], vertex);
+         }
+      }
+   }
+}
+
+bool CMeshSimplifier::isAlive(unsigned int triangle) const
+{
+   return (REMOVED != mTriangles[triangle * 3]);
+}
+
+bool CMeshSimplifier::canCollapse(unsigned int from, unsigned int to) const
+{
+   // triangles which stay must not flip or become degenerate
+   const std::vector<unsigned int> & triangles = mVertexTriangles[from];
+   for (size_t i = 0; i < triangles.size(); ++i)
+   {
+      if (false == isAlive(triangles[i]))
+      {
+         continue;
+      }
+
+      const unsigned int * v = &mTriangles[triangles[i] * 3];
+      if (to == v[0] || to == v[1] || to == v[2])
+      {
+         continue;
+      }
+
+      unsigned int moved[3] = { v[0], v[1], v[2] };
+      std::replace(moved, moved + 3, from, to);
+
+      const glm::vec3 before = getNormal(v[0], v[1], v[2]);
+      const glm::vec3 after = getNormal(moved[0], moved[1], moved[2]);
+      if (glm::dot(before, after) < MIN_NORMAL_DOT)
+      {
+         return false;
+      }
+   }
+   return true;
+}
+
+void CMeshSimplifier::collapse(unsigned int from, unsigned int to)
+{
+   std::vector<unsigned int> & triangles = mVertexTriangles[from];
+   for (size_t i = 0; i < triangles.size(); ++i)
+   {
+      const unsigned int t = triangles[i];
+      if (false == isAlive(t))
+      {
+         continue;
+      }
+
+      unsigned int * v = &mTriangles[t * 3];
+      if (to == v[0] || to == v[1] || to == v[2])
+      {
+         std::fill(v, v + 3, REMOVED);
+         --mLiveTriangles;
+      }
+      else
+      {
+         std::replace(v, v + 3, from, to);
+         mVertexTriangles[to].push_back(t);
+      }
+   }
+   std::vector<unsigned int>().swap(triangles);
+
+   mRemoved[from] = true;
+   mQuadrics[to].add(mQuadrics[from]);
+   ++mVersions[to];
+
+   pushCollapses(to);
+}
+
+float CMeshSimplifier::getSkinDistance(unsigned int a, unsigned int b) const
+{
+   // sum of weight differences over bones of both vertices
+   float distance = 0.f;
+   for (int i = 0; i < 4; ++i)
+   {
+      if (0.f != mBoneWeights[a][i])
+      {
+         distance += std::abs(mBoneWeights[a][i] - getBoneWeight(b, mBoneIndices[a][i]));
+      }
+      if (0.f != mBoneWeights[b][i] && 0.f == getBoneWeight(a, mBoneIndices[b][i]))
+      {
+         distance += mBoneWeights[b][i];
+      }
+   }
+   return distance;
+}
+
+float CMeshSimplifier::getBoneWeight(unsigned int vertex, float bone) const
+{
+   float weight = 0.f;
+   for (int i = 0; i < 4; ++i)
+   {
+      if (bone == mBoneIndices[vertex][i])
+      {
+         weight += mBoneWeights[vertex][i];
+      }
+   }
+   return weight;
+}
+
+glm::vec3 CMeshSimplifier::getNormal(unsigned int a, unsigned int b, unsigned int c) const
+{
+   const glm::vec3 cross = glm::cross(mPositions[b] - mPositions[a], mPositions[c] - mPositions[a]);
+   const float length = glm::length(cross);
+   return (0.f != length) ? cross / length : glm::vec3(0.f);
+}
+
+} /* namespace NApp */
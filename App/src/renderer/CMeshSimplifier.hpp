@@ -0,0 +1,106 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <functional>
+#include <queue>
+#include <vector>
+
+namespace NApp
+{
+
+/**
+ * Simplification of triangle mesh by quadric error metric edge collapses.
+ *
+ * Each collapse moves a vertex onto its neighbour (half edge collapse), so
+ * simplified meshes reference the original vertices and can share vertex
+ * buffer with the full mesh; only index lists differ. Open borders,
+ * including texture seams where vertices are split, are kept by penalty
+ * planes. Collapses between vertices of different bone weights are not
+ * done, so skinned LODs deform like the full mesh.
+ */
+class CMeshSimplifier
+{
+public:
+   /**
+    * Constructor.
+    * @param positions positions of vertices
+    * @param indices triangle list
+    */
+   CMeshSimplifier(const std::vector<glm::vec3> & positions, const std::vector<unsigned int> & indices);
+
+   /**
+    * Set skin of vertices, 4 bones per vertex.
+    * @param boneIndices indices of bones
+    * @param boneWeights weights of bones, 0 for unused
+    */
+   void setSkin(const std::vector<glm::vec4> & boneIndices, const std::vector<glm::vec4> & boneWeights);
+
+   /**
+    * Collapse edges until mesh has at most target indices or no collapse
+    * is allowed. Following calls continue from the result, so LODs are
+    * generated from the finest to the coarsest.
+    * @param targetIndexCount wanted number of indices
+    * @param[out] indices triangle list of simplified mesh
+    */
+   void simplify(size_t targetIndexCount, std::vector<unsigned int> & indices);
+
+private:
+   /** Symmetric 4x4 matrix of sum of squared distances to planes. */
+   struct Quadric
+   {
+      Quadric();
+
+      void addPlane(const glm::dvec3 & normal, double distance, double weight);
+      void add(const Quadric & other);
+      double evaluate(const glm::dvec3 & point) const;
+
+      double m[10];
+   };
+
+   struct Collapse
+   {
+      double cost;
+      unsigned int from;
+      unsigned int to;
+      unsigned int fromVersion;
+      unsigned int toVersion;
+
+      bool operator>(const Collapse & other) const;
+   };
+
+   typedef std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse> > tCollapses;
+
+   void initQuadrics();
+   void pushCollapse(unsigned int from, unsigned int to);
+   void pushCollapses(unsigned int vertex);
+   bool isAlive(unsigned int triangle) const;
+   bool canCollapse(unsigned int from, unsigned int to) const;
+   void collapse(unsigned int from, unsigned int to);
+   float getSkinDistance(unsigned int a, unsigned int b) const;
+   float getBoneWeight(unsigned int vertex, float bone) const;
+   glm::vec3 getNormal(unsigned int a, unsigned int b, unsigned int c) const;
+
+private:
+   static const unsigned int REMOVED;
+   static const double BORDER_WEIGHT;
+   static const float MAX_SKIN_DISTANCE;
+   static const float MIN_NORMAL_DOT;
+
+private:
+   std::vector<glm::vec3> mPositions;
+   std::vector<glm::vec4> mBoneIndices;  ///< empty if mesh isn't skinned
+   std::vector<glm::vec4> mBoneWeights;
+
+   std::vector<unsigned int> mTriangles; ///< 3 indices per triangle, REMOVED for collapsed
+   size_t mLiveTriangles;
+
+   std::vector<std::vector<unsigned int> > mVertexTriangles; ///< triangles around vertex
+   std::vector<Quadric> mQuadrics;
+   std::vector<unsigned int> mVersions; ///< changes of vertex, older collapses are stale
+   std::vector<bool> mRemoved;
+
+   tCollapses mCollapses;
+   bool mInitialized;
+};
+
+} /* namespace NApp */
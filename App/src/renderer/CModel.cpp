@@ -1,28 +1,403 @@
 #include <iostream>
 #include <glm/gtx/transform.hpp>
-#include <SDL.h>
-#include <cv.h>
-#include <highgui.h>
 #include "renderer/CAnimator.hpp"
 #include "renderer/CCamera.hpp"
+#include "renderer/CDrawQueue.hpp"
 #include "renderer/CLight.hpp"
 #include "renderer/CModel.hpp"
+#include "renderer/CModelCache.hpp"
+#include "renderer/CModelCooker.hpp"
 #include "renderer/CShader.hpp"
-#include "renderer/CUtils.hpp"
-#include "loader/TGALoader.hpp"
+#include "renderer/CShaderLibrary.hpp"
+#include "loader/CBinaryStream.hpp"
+#include "loader/CMappedFile.hpp"
 
 
 namespace NApp
 {
 
-static const unsigned int MAXBONESPERMESH = 60u;
+/**
+ * Screen sizes below which LODs are used: projected radius of model
+ * relative to half of screen height.
+ */
+static const float LOD_SCREEN_SIZES[] = { 0.25f, 0.1f };
 
-std::shared_ptr<CModel> CModel::load(const std::string & path)
+/** Smallest cooked node: empty name, transform and two counts. */
+static const size_t MIN_COOKED_NODE_SIZE = 4 + sizeof(aiMatrix4x4) + 4 + 4;
+
+/** Smallest cooked channel: empty name, states and three key counts. */
+static const size_t MIN_COOKED_CHANNEL_SIZE = 4 + 4 + 4 + 3 * 4;
+
+/** Smallest cooked bone: empty name and offset matrix. */
+static const size_t MIN_COOKED_BONE_SIZE = 4 + sizeof(aiMatrix4x4);
+
+/** Assimp matrices are row major, glm takes columns. Members are copied one by one, aiMatrix4x4 may be packed. */
+static glm::mat4 toMat4(const aiMatrix4x4 & m)
+{
+   return glm::mat4(
+      m.a1, m.b1, m.c1, m.d1,
+      m.a2, m.b2, m.c2, m.d2,
+      m.a3, m.b3, m.c3, m.d3,
+      m.a4, m.b4, m.c4, m.d4);
+}
+
+/** Check that indices of cooked mesh address its vertices. */
+template <typename T>
+static bool checkIndices(const unsigned char * data, size_t count, int vertexCount)
+{
+   const T * indices = (const T *)data;
+   for (size_t i = 0; i < count; ++i)
+   {
+      if ((size_t)vertexCount <= (size_t)indices[i])
+      {
+         return false;
+      }
+   }
+   return true;
+}
+
+/** Check that bone indices of cooked skinned vertices address bones of mesh. */
+static bool checkBoneIndices(const unsigned char * data, int vertexCount, int boneCount)
+{
+   const tSkinnedVertexLayout::tVertex * vertices = (const tSkinnedVertexLayout::tVertex *)data;
+   for (int i = 0; i < vertexCount; ++i)
+   {
+      // bone indices are the 4th attribute of the layout
+      const GLubyte * bones = vertices[i].tail.tail.tail.head.v;
+      for (int k = 0; k < 4; ++k)
+      {
+         if (boneCount <= (int)bones[k])
+         {
+            return false;
+         }
+      }
+   }
+   return true;
+}
+
+/** Read count of elements, each of them takes at least minSize bytes. */
+static bool readCount(CBinaryReader & reader, unsigned int & count, size_t minSize)
+{
+   return (true == reader.read(count) && count <= reader.getRemaining() / minSize);
+}
+
+/** Read array written as count and elements, elements are appended to data. */
+template <typename T>
+static bool readArray(CBinaryReader & reader, std::vector<T> & data)
+{
+   unsigned int count = 0;
+   if (false == readCount(reader, count, sizeof(T)))
+   {
+      return false;
+   }
+
+   const unsigned char * source = reader.skip(count * sizeof(T));
+   const size_t first = data.size();
+   data.resize(first + count);
+   if (0 != count)
+   {
+      std::copy(source, source + count * sizeof(T), (unsigned char *)&data[first]);
+   }
+   return true;
+}
+
+/** @return index of the first node of name in depth first order, Skeleton::NONE if there's none. */
+static unsigned int findNode(const std::vector<std::string> & nodeNames, const std::string & name)
+{
+   for (size_t i = 0; i < nodeNames.size(); ++i)
+   {
+      if (nodeNames[i] == name)
+      {
+         return (unsigned int)i;
+      }
+   }
+   return Skeleton::NONE;
+}
+
+/** Read node and its children into skeleton, names of nodes go to nodeNames. */
+static bool readNode(
+   CBinaryReader & reader,
+   Skeleton & skeleton,
+   std::vector<std::string> & nodeNames,
+   unsigned int parent,
+   unsigned int meshCount)
+{
+   const unsigned int index = (unsigned int)skeleton.mNodes.size();
+   skeleton.mNodes.push_back(SkeletonNode());
+   nodeNames.push_back(std::string());
+
+   SkeletonNode & node = skeleton.mNodes.back();
+   node.mParent = parent;
+   node.mFirstMesh = (unsigned int)skeleton.mNodeMeshes.size();
+   if ( false == reader.readString(nodeNames.back())
+     || false == reader.read(node.mTransform)
+     || false == readArray(reader, skeleton.mNodeMeshes))
+   {
+      return false;
+   }
+   node.mMeshCount = (unsigned int)skeleton.mNodeMeshes.size() - node.mFirstMesh;
+
+   for (size_t i = node.mFirstMesh; i < skeleton.mNodeMeshes.size(); ++i)
+   {
+      if (skeleton.mNodeMeshes[i] >= meshCount)
+      {
+         return false;
+      }
+   }
+
+   // children are appended after node, its reference isn't used below
+   unsigned int childCount = 0;
+   if (false == readCount(reader, childCount, MIN_COOKED_NODE_SIZE))
+   {
+      return false;
+   }
+   for (unsigned int i = 0; i < childCount; ++i)
+   {
+      if (false == readNode(reader, skeleton, nodeNames, index, meshCount))
+      {
+         return false;
+      }
+   }
+   return true;
+}
+
+static bool readAnimation(CBinaryReader & reader, const std::vector<std::string> & nodeNames, Animation & animation)
+{
+   std::string name;
+   unsigned int channelCount = 0;
+   if ( false == reader.readString(name)
+     || false == reader.read(animation.mDuration)
+     || false == reader.read(animation.mTicksPerSecond)
+     || false == readCount(reader, channelCount, MIN_COOKED_CHANNEL_SIZE))
+   {
+      return false;
+   }
+
+   animation.mChannels.resize(channelCount);
+   animation.mNodeChannels.assign(nodeNames.size(), Skeleton::NONE);
+   for (unsigned int i = 0; i < channelCount; ++i)
+   {
+      AnimationChannel & channel = animation.mChannels[i];
+
+      // behaviours outside of keys aren't used by the animator
+      std::string nodeName;
+      unsigned int preState = 0;
+      unsigned int postState = 0;
+      if ( false == reader.readString(nodeName)
+        || false == reader.read(preState)
+        || false == reader.read(postState)
+        || false == readArray(reader, channel.mPositionKeys)
+        || false == readArray(reader, channel.mRotationKeys)
+        || false == readArray(reader, channel.mScalingKeys))
+      {
+         return false;
+      }
+
+      // nodes take the first channel of their name
+      for (size_t j = 0; j < nodeNames.size(); ++j)
+      {
+         if (Skeleton::NONE == animation.mNodeChannels[j] && nodeNames[j] == nodeName)
+         {
+            animation.mNodeChannels[j] = i;
+         }
+      }
+   }
+   return true;
+}
+
+/** Read mesh of model with materialCount materials, its bones go to skeleton and names of them to boneNames. */
+static bool readMesh(
+   CBinaryReader & reader,
+   unsigned int materialCount,
+   Mesh & mesh,
+   CookedMesh & cooked,
+   Skeleton & skeleton,
+   std::vector<std::string> & boneNames)
+{
+   glm::vec3 boundsMin;
+   glm::vec3 boundsMax;
+   unsigned char skinned = 0;
+   unsigned char hasTexCoords = 0;
+   unsigned int indexType = 0;
+   unsigned int lodCount = 0;
+
+   reader.read(mesh.mMaterialIndex);
+   reader.read(mesh.mNumFaces);
+   reader.read(mesh.mNumVertices);
+   reader.read(mesh.mNumBones);
+   reader.read(mesh.mColor);
+   reader.read(boundsMin);
+   reader.read(boundsMax);
+   reader.read(skinned);
+   reader.read(hasTexCoords);
+   reader.read(mesh.mVariant);
+   reader.read(indexType);
+   if (false == readCount(reader, lodCount, sizeof(MeshLod)))
+   {
+      return false;
+   }
+
+   mesh.mBounds = BoundingVolume(boundsMin, boundsMax);
+   mesh.mSkinned = (0 != skinned);
+
+   // material indexes textures, variant indexes programs, TEXTURED is added by model when texture is loaded
+   if ( 0 > mesh.mMaterialIndex
+     || materialCount <= (unsigned int)mesh.mMaterialIndex
+     || (unsigned int)ShaderVariant::COUNT <= mesh.mVariant
+     || 0 != (mesh.mVariant & ShaderVariant::TEXTURED)
+     || mesh.mSkinned != (0 != (mesh.mVariant & ShaderVariant::SKINNED)))
+   {
+      return false;
+   }
+
+   mesh.mIndexType = (GLenum)indexType;
+   cooked.mHasTexCoords = (0 != hasTexCoords);
+
+   for (unsigned int i = 0; i < lodCount; ++i)
+   {
+      MeshLod lod(0, 0);
+      reader.read(lod.mFirstIndex);
+      reader.read(lod.mIndexCount);
+      mesh.mLods.push_back(lod);
+   }
+
+   unsigned int vertexSize = 0;
+   reader.read(vertexSize);
+   reader.align(4);
+   cooked.mVertices = reader.skip(vertexSize);
+   cooked.mVertexSize = vertexSize;
+
+   unsigned int indexSize = 0;
+   reader.read(indexSize);
+   reader.align(4);
+   cooked.mIndices = reader.skip(indexSize);
+   cooked.mIndexSize = indexSize;
+
+   unsigned int boneCount = 0;
+   if ( false == readCount(reader, boneCount, MIN_COOKED_BONE_SIZE)
+     || boneCount != (unsigned int)mesh.mNumBones)
+   {
+      return false;
+   }
+
+   mesh.mFirstBone = (unsigned int)skeleton.mBones.size();
+   for (unsigned int i = 0; i < boneCount; ++i)
+   {
+      SkeletonBone bone;
+      boneNames.push_back(std::string());
+      if ( false == reader.readString(boneNames.back())
+        || false == reader.read(bone.mOffset))
+      {
+         return false;
+      }
+      skeleton.mBones.push_back(bone);
+   }
+
+   if (0 == vertexSize || 0 == indexSize)
+   {
+      return (true == reader.isValid());
+   }
+
+   // LODs and indices must stay inside of buffers, data of other layout are rejected
+   const size_t stride = (true == mesh.mSkinned) ? tSkinnedVertexLayout::STRIDE : tStaticVertexLayout::STRIDE;
+   const size_t indexCount = indexSize / ((GL_UNSIGNED_SHORT == mesh.mIndexType) ? sizeof(GLushort) : sizeof(GLuint));
+   if ( (size_t)mesh.mNumVertices * stride != vertexSize
+     || (GL_UNSIGNED_SHORT != mesh.mIndexType && GL_UNSIGNED_INT != mesh.mIndexType)
+     || true == mesh.mLods.empty())
+   {
+      return false;
+   }
+   for (size_t i = 0; i < mesh.mLods.size(); ++i)
+   {
+      const MeshLod & lod = mesh.mLods[i];
+      if (lod.mFirstIndex < 0 || lod.mIndexCount < 0 || (size_t)(lod.mFirstIndex + lod.mIndexCount) > indexCount)
+      {
+         return false;
+      }
+   }
+
+   // damaged entry with valid header must not make GPU read outside of buffers
+   if (false == reader.isValid())
+   {
+      return false;
+   }
+   const bool indicesValid = (GL_UNSIGNED_SHORT == mesh.mIndexType)
+      ? checkIndices<GLushort>(cooked.mIndices, indexCount, mesh.mNumVertices)
+      : checkIndices<GLuint>(cooked.mIndices, indexCount, mesh.mNumVertices);
+   return ( true == indicesValid
+         && ( false == mesh.mSkinned
+           || true == checkBoneIndices(cooked.mVertices, mesh.mNumVertices, mesh.mNumBones)));
+}
+
+DrawItem::DrawItem()
+   : mMesh(0)
+   , mVariant(0)
+   , mTexture(0)
+   , mColor(1.f)
+   , mBoneSlot(0)
+   , mBoneCount(0)
+   , mNode(0)
+   , mTransform(1.f)
+{
+}
+
+MeshLod::MeshLod(GLsizei firstIndex, GLsizei indexCount)
+   : mFirstIndex(firstIndex)
+   , mIndexCount(indexCount)
+{
+}
+
+Mesh::Mesh()
+   : mMaterialIndex(0)
+   , mNumFaces(0)
+   , mNumVertices(0)
+   , mNumBones(0)
+   , mFirstBone(0)
+   , mTexture(0)
+   , mColor(1.f)
+   , mSkinned(false)
+   , mVariant(ShaderVariant::LIT)
+   , mVertexArray(0)
+   , mVertexBuffer(0)
+   , mIndexBuffer(0)
+   , mIndexType(GL_UNSIGNED_INT)
+   , mIndexCount(0)
+{
+}
+
+CookedMesh::CookedMesh()
+   : mVertices(0)
+   , mVertexSize(0)
+   , mIndices(0)
+   , mIndexSize(0)
+   , mHasTexCoords(false)
+{
+}
+
+std::shared_ptr<CModel> CModel::load(
+   const std::string & path,
+   bool keepMeshData,
+   const CModelCache * cache,
+   CTextureCache * textures)
+{
+   std::shared_ptr<CModel> model = prepare(path, keepMeshData, cache, textures);
+   if (0 != model && false == model->upload())
+   {
+      model.reset();
+   }
+   return model;
+}
+
+std::shared_ptr<CModel> CModel::prepare(
+   const std::string & path,
+   bool keepMeshData,
+   const CModelCache * cache,
+   CTextureCache * textures)
 {
    std::shared_ptr<CModel> model;
    try
    {
-      std::shared_ptr<CModel> tmp(new CModel(path));
+      std::shared_ptr<CModel> tmp(new CModel(path, keepMeshData, cache, textures));
       model = tmp;
    }
    catch (std::exception & e)
@@ -33,8 +408,11 @@ std::shared_ptr<CModel> CModel::load(const std::string & path)
    return model;
 }
 
-CModel::CModel(const std::string & path)
-   : mModelMatrix(1.f)
+CModel::CModel(const std::string & path, bool keepMeshData, const CModelCache * cache, CTextureCache * textures)
+   : mKeepMeshData(keepMeshData)
+   , mTextureCache(textures)
+   , mUploaded(false)
+   , mModelMatrix(1.f)
    , mSceneMin(1e10f, 1e10f, 1e10f)
    , mSceneMax(-1e10f, -1e10f, -1e10f)
    , mSceneCenter(0.f, 0.f, 0.f)
@@ -44,330 +422,306 @@ CModel::CModel(const std::string & path)
    , mUserTranslate(0.f, 0.f, 0.f)
 
 {
-   if (false == loadScene(path))
+   if (false == loadScene(path, cache))
    {
+      releaseScene();
+      releaseCooked();
       throw std::runtime_error("Can't load file '" + path + "'.");
    }
 }
 
 CModel::~CModel()
 {
-   for (unsigned int i = 0; i < mTextures.size(); ++i)
+   for (size_t i = 0; i < mMeshes.size(); ++i)
    {
-      if (mTextures[i] != -1)
+      const Mesh & mesh = mMeshes[i];
+      if (0 != mesh.mVertexArray)
+      {
+         glDeleteVertexArrays(1, &mesh.mVertexArray);
+      }
+      if (0 != mesh.mVertexBuffer)
+      {
+         glDeleteBuffers(1, &mesh.mVertexBuffer);
+      }
+      if (0 != mesh.mIndexBuffer)
       {
-         glDeleteTextures(1, &mTextures[i]);
+         glDeleteBuffers(1, &mesh.mIndexBuffer);
       }
    }
+
+   // the animator references the scene
+   mAnimator.reset();
+   releaseScene();
 }
 
-bool CModel::loadScene(const std::string & path)
+bool CModel::loadScene(const std::string & path, const CModelCache * cache)
 {
-   //import the model via Assimp
-   mStore = aiCreatePropertyStore();
-   aiSetImportPropertyInteger(mStore, AI_CONFIG_IMPORT_TER_MAKE_UVS, 1);
-   aiSetImportPropertyFloat  (mStore, AI_CONFIG_PP_GSN_MAX_SMOOTHING_ANGLE, 80.0f);
-   aiSetImportPropertyInteger(mStore, AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_LINE |
-                                                               aiPrimitiveType_POINT);
+   std::string key;
+   if (0 != cache && true == cache->isEnabled())
+   {
+      key = cache->getKey(path, CModelCooker::getSettings());
+   }
 
-   mScene = aiImportFileExWithProperties(
-      path.c_str(),
-      aiProcessPreset_TargetRealtime_Quality |
-      aiProcess_FindInstances |
-      aiProcess_ValidateDataStructure |
-      aiProcess_OptimizeMeshes,
-      0,
-      mStore);
+   std::vector<std::string> texturePaths;
+   bool parsed = false;
 
-   if (0 == mScene)
+   if (false == key.empty())
    {
-      std::cerr << "Loading model failed." << std::endl;
-      return false;
+      // buffers are uploaded straight from the mapping
+      mMappedFile = std::make_shared<CMappedFile>();
+      const unsigned char * data = 0;
+      size_t size = 0;
+      if (true == cache->load(key, *mMappedFile, data, size))
+      {
+         parsed = parseCooked(data, size, texturePaths);
+         if (false == parsed)
+         {
+            std::cerr << "Cooked model of '" << path << "' is invalid, importing model." << std::endl;
+            releaseScene();
+         }
+      }
+      if (false == parsed)
+      {
+         mMappedFile.reset();
+      }
    }
-    
-   calculateBBox(*mScene->mRootNode, mSceneMin, mSceneMax);
-   calculateCenter(mSceneMin, mSceneMax, mSceneCenter);
 
-   //load the textures into the vram
-   mTextures.resize(mScene->mNumMaterials, 0);
-   for (unsigned int i = 0; i < mScene->mNumMaterials; ++i)
+   if (false == parsed)
    {
-      const aiMaterial & currentMaterial = *mScene->mMaterials[i];
-      unsigned int & texture = mTextures[i];
-
-      aiString texturePath;
-      aiGetMaterialTexture(
-         &currentMaterial,
-         aiTextureType_DIFFUSE,
-         0,
-         &texturePath,
-         0, 0, 0, 0, 0, 0);
-
-      cv::Mat image;
-      image = cv::imread(
-         CUtils::getFullPath(path, std::string(texturePath.data)).c_str(),
-         CV_LOAD_IMAGE_COLOR);
-
-      if (false == image.empty())  // Check for invalid input
+      CModelCooker cooker;
+      if (false == cooker.cook(path, mCooked))
       {
+         return false;
+      }
 
-         IplImage opencvimg2 = (IplImage)image;
-         IplImage* opencvimg = &opencvimg2;
+      if (false == key.empty())
+      {
+         cache->store(key, mCooked);
+      }
 
-         //Convert to SDL_Surface
-         SDL_Surface * tex = SDL_CreateRGBSurfaceFrom(
-            (void*)opencvimg->imageData,
-            opencvimg->width, opencvimg->height,
-            opencvimg->depth * opencvimg->nChannels,
-            opencvimg->widthStep,
-            0x0000ff, 0x00ff00, 0xff0000, 0);
+      if (false == parseCooked(mCooked.data(), mCooked.size(), texturePaths))
+      {
+         return false;
+      }
+   }
 
-         if (0 != tex)
-         {
-            glGenTextures(1, &texture);
-            glBindTexture(GL_TEXTURE_2D, texture);
-
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-            gluBuild2DMipmaps(
-               GL_TEXTURE_2D,
-               3,
-               tex->w, tex->h,
-               GL_BGR, GL_UNSIGNED_BYTE,
-               tex->pixels);
-         }
-         SDL_FreeSurface(tex);
+   // textures shared with resident models aren't decoded again
+   mTexturePaths.swap(texturePaths);
+   mTextureImages.resize(mTexturePaths.size());
+   for (size_t i = 0; i < mTexturePaths.size(); ++i)
+   {
+      if (0 != mTextureCache)
+      {
+         mTextureImages[i] = mTextureCache->decode(mTexturePaths[i]);
       }
       else
       {
-         Texture TGAtextur;
-         TGALoader loader;
-         std::string str = CUtils::getFullPath(path, std::string(texturePath.data));
-
-         if (loader.LoadTGA(&TGAtextur, str.c_str()))
-         {
-            glGenTextures(1, &texture);
-            glBindTexture(GL_TEXTURE_2D, texture);
-
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-            gluBuild2DMipmaps(
-               GL_TEXTURE_2D,
-               3,
-               TGAtextur.width, TGAtextur.height,
-               TGAtextur.type,
-               GL_UNSIGNED_BYTE,
-               TGAtextur.imageData);
-          }
-          else
-          {
-             SDL_Surface * tex = SDL_LoadBMP("data/mash.bmp");
-			
-             if (0 != tex)
-             {
-                glGenTextures(1, &texture);
-                glBindTexture(GL_TEXTURE_2D, texture);
-
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-                gluBuild2DMipmaps(
-                   GL_TEXTURE_2D,
-                   3,
-                   tex->w, tex->h,
-                   GL_BGR, GL_UNSIGNED_BYTE,
-                   tex->pixels);
-             }
-             SDL_FreeSurface(tex);
-          }
-       }
-    }
+         std::shared_ptr<TextureImage> image = std::make_shared<TextureImage>();
+         CTextureLoader::decode(mTexturePaths[i], *image);
+         mTextureImages[i] = image;
+      }
+   }
 
-   //load the meshes into the vram
-   mMeshes.resize(mScene->mNumMeshes);
-   for (unsigned int i = 0; i < mScene->mNumMeshes; ++i)
+   if (false == mSkeleton.mAnimations.empty())
    {
-      const aiMesh & currentMesh = *mScene->mMeshes[i];
-      Mesh & mesh = mMeshes[i];
+      mAnimator = std::make_shared<CAnimator>(mSkeleton, 0);
+   }
 
-       mesh.mNumFaces = currentMesh.mNumFaces;
-       mesh.mNumVertices = currentMesh.mNumVertices;
-       mesh.mNumBones = currentMesh.mNumBones;
-       mesh.mMaterialIndex = currentMesh.mMaterialIndex;
-
-       if (mesh.mNumFaces == 0 || mesh.mNumVertices == 0)
-       {
-          continue;
-       }
-       if (!currentMesh.HasPositions())
-       {
-          std::cerr << "A mesh of the model has no vertices and is not loaded." << std::endl;
-          continue;
-       }
-       if (!currentMesh.HasNormals())
-       {
-          std::cerr << "A mesh of the model has no normals and is not loaded." << std::endl;
-          continue;
-       }
-       if (!currentMesh.HasFaces())
-       {
-          std::cerr << "A mesh of the model has no polygon faces and is not loaded." << std::endl;
-          continue;
-       }
-
-       mesh.mVertices.resize(mesh.mNumVertices);
-       mesh.mNormals.resize(mesh.mNumVertices);
-       mesh.mColors.resize(mesh.mNumVertices);
-       mesh.mTexCoords.resize(mesh.mNumVertices);
-       mesh.mIndices.resize(mesh.mNumFaces * 3);
-       mesh.mBoneIndices.resize(mesh.mNumVertices);
-       mesh.mWeights.resize(mesh.mNumVertices);
-
-       for (int j = 0; j < mesh.mNumVertices; ++j)
-       {
-         mesh.mVertices[j].x = currentMesh.mVertices[j].x;
-         mesh.mVertices[j].y = currentMesh.mVertices[j].y;
-         mesh.mVertices[j].z = currentMesh.mVertices[j].z;
-         mesh.mVertices[j].w = 1.0f;
-
-         mesh.mNormals[j].x = currentMesh.mNormals[j].x;
-         mesh.mNormals[j].y = currentMesh.mNormals[j].y;
-         mesh.mNormals[j].z = currentMesh.mNormals[j].z;
-
-         if ( false == currentMesh.HasVertexColors(0)
-           || 0 == currentMesh.mColors[j])
-         {
-            if ( currentMesh.mMaterialIndex < mScene->mNumMaterials
-              && 0 != mScene->mMaterials[currentMesh.mMaterialIndex])
-            {
-               const aiMaterial & currentMaterial = *mScene->mMaterials[currentMesh.mMaterialIndex];
-
-               aiColor4D color;
-               aiGetMaterialColor(&currentMaterial, AI_MATKEY_COLOR_DIFFUSE, &color);
-
-               mesh.mColors[j].r = color.r;
-               mesh.mColors[j].g = color.g;
-               mesh.mColors[j].b = color.b;
-               mesh.mColors[j].a = 1.0f;
-            }
-            else
-            {
-               mesh.mColors[j] = glm::vec4(1.f, 0.f, 0.f, 1.0f);
-            }
-         }
-         else
-         {
-            mesh.mColors[j].r = currentMesh.mColors[j]->r;
-            mesh.mColors[j].g = currentMesh.mColors[j]->g;
-            mesh.mColors[j].b = currentMesh.mColors[j]->b;
-            mesh.mColors[j].a = currentMesh.mColors[j]->a;
-         }
+   calculateCenter(mSceneMin, mSceneMax, mSceneCenter);
 
-         if ( 0 != currentMesh.mTextureCoords
-           && 0 != currentMesh.mTextureCoords[0])
-         {
-            mesh.mTexCoords[j].x = currentMesh.mTextureCoords[0][j].x;
-            mesh.mTexCoords[j].y = 1.0f - currentMesh.mTextureCoords[0][j].y;
-         }
-         else
-         {
-            mesh.mTexCoords[j] = glm::vec2(0.f, 0.f);
-         }
-      }
+   // skinned draws are culled by bounds of the whole model in bind pose
+   mBounds = BoundingVolume(
+      glm::vec3(mSceneMin.x, mSceneMin.y, mSceneMin.z),
+      glm::vec3(mSceneMax.x, mSceneMax.y, mSceneMax.z));
 
-      for (int j = 0; j < mesh.mNumFaces; ++j)
-      {
-         mesh.mIndices[j * 3] = currentMesh.mFaces[j].mIndices[0];
-         mesh.mIndices[j * 3 + 1] = currentMesh.mFaces[j].mIndices[1];
-         mesh.mIndices[j * 3 + 2] = currentMesh.mFaces[j].mIndices[2];
-      }
+   mScale = calculateScale();
+   return true;
+}
 
-      //read bone indices and weights for bone animation
-      std::vector<std::vector<aiVertexWeight> > vTempWeightsPerVertex;
-      vTempWeightsPerVertex.resize(currentMesh.mNumVertices);
+bool CModel::parseCooked(const unsigned char * data, size_t size, std::vector<std::string> & texturePaths)
+{
+   CBinaryReader reader(data, size);
+   reader.read(mStats);
+   reader.read(mSceneMin);
+   reader.read(mSceneMax);
 
-      for (unsigned int j = 0; j < currentMesh.mNumBones; ++j)
+   unsigned int materialCount = 0;
+   if (false == readCount(reader, materialCount, 4))
+   {
+      return false;
+   }
+   texturePaths.resize(materialCount);
+   for (unsigned int i = 0; i < materialCount; ++i)
+   {
+      reader.readString(texturePaths[i]);
+   }
+
+   unsigned int meshCount = 0;
+   reader.align(8);
+   if (false == readCount(reader, meshCount, 4))
+   {
+      return false;
+   }
+   // names are needed only to link bones and channels to nodes
+   std::vector<std::string> boneNames;
+   std::vector<std::string> nodeNames;
+
+   mMeshes.resize(meshCount);
+   mCookedMeshes.resize(meshCount);
+   for (unsigned int i = 0; i < meshCount; ++i)
+   {
+      if (false == readMesh(reader, materialCount, mMeshes[i], mCookedMeshes[i], mSkeleton, boneNames))
       {
-         const aiBone & bone = *currentMesh.mBones[j];
-         for (unsigned int b = 0; b < bone.mNumWeights; ++b)
-         {
-            std::vector<aiVertexWeight> & weight = vTempWeightsPerVertex[bone.mWeights[b].mVertexId];
-            weight.push_back(aiVertexWeight(j, bone.mWeights[b].mWeight));
-         }
+         return false;
       }
+   }
 
-      for (int j = 0; j < mesh.mNumVertices; ++j)
-      {
-         mesh.mBoneIndices[j] = glm::uvec4(0, 0, 0, 0);
-         mesh.mWeights[j] = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+   if (false == readNode(reader, mSkeleton, nodeNames, Skeleton::NONE, meshCount))
+   {
+      return false;
+   }
 
-         if (true == currentMesh.HasBones())
-         {
-            if (4 < vTempWeightsPerVertex[j].size())
-            {
-               std::cerr << "The model has invalid bone weights and is not loaded." << std::endl;
-               return false;
-            }
-
-            for (unsigned int k = 0; k < vTempWeightsPerVertex[j].size(); ++k)
-            {
-               mesh.mBoneIndices[j][k] = (GLfloat) vTempWeightsPerVertex[j][k].mVertexId;
-               mesh.mWeights[j][k] = (GLfloat) vTempWeightsPerVertex[j][k].mWeight;
-            }
-         }
+   for (size_t i = 0; i < mSkeleton.mBones.size(); ++i)
+   {
+      mSkeleton.mBones[i].mNode = findNode(nodeNames, boneNames[i]);
+   }
+
+   unsigned int animationCount = 0;
+   if (false == readCount(reader, animationCount, 4))
+   {
+      return false;
+   }
+   mSkeleton.mAnimations.resize(animationCount);
+   for (unsigned int i = 0; i < animationCount; ++i)
+   {
+      if (false == readAnimation(reader, nodeNames, mSkeleton.mAnimations[i]))
+      {
+         return false;
       }
+   }
 
-      if (true == mScene->HasAnimations())
+   // skinned meshes are drawn by animator, it's created only for animated models
+   for (size_t i = 0; i < mMeshes.size() && 0 == animationCount; ++i)
+   {
+      if (true == mMeshes[i].mSkinned)
       {
-         mAnimator = std::make_shared<CAnimator>(mScene, 0);
+         return false;
       }
    }
 
-   mScale = calculateScale();
-   return true;
+   return (true == reader.isValid());
 }
 
-float CModel::calculateScale()
+bool CModel::upload()
 {
-   float xDistance = sqrt(mSceneMax.x * mSceneMax.x + mSceneMin.x * mSceneMin.x);
-   float yDistance = sqrt(mSceneMax.y * mSceneMax.y + mSceneMin.y * mSceneMin.y);
-   float zDistance = sqrt(mSceneMax.z * mSceneMax.z + mSceneMin.z * mSceneMin.z);
-   float scale = sqrt(xDistance * xDistance + yDistance * yDistance + zDistance * zDistance);
+   if (true == mUploaded)
+   {
+      return true;
+   }
 
-   return 1.5 / scale;
-}
+   // compact vertex layouts store texture coordinates as half floats
+   if (!GLEW_VERSION_3_0 && !GLEW_ARB_half_float_vertex)
+   {
+      std::cerr << "GL_ARB_half_float_vertex isn't supported." << std::endl;
+      return false;
+   }
+   mUploaded = true;
 
-void CModel::calculateBBox(
-   const aiNode & node,
-   aiVector3D & min,
-   aiVector3D & max)
-{
-   for (unsigned int i = 0; i < node.mNumMeshes; ++i)
+   //load the textures into the vram
+   mTextures.resize(mTextureImages.size());
+   std::set<const void *> counted;
+   for (size_t i = 0; i < mTextureImages.size(); ++i)
    {
-      const aiMesh & mesh = *mScene->mMeshes[node.mMeshes[i]];
+      const CTextureCache::tImage & image = mTextureImages[i];
+      mTextures[i] = (0 != mTextureCache)
+         ? mTextureCache->upload(mTexturePaths[i], image)
+         : CTextureCache::create(*image);
 
-      for (unsigned int j = 0; j < mesh.mNumVertices; ++j)
+      // materials may share texture, it's counted once per model
+      if (0 != mTextures[i] && true == counted.insert(mTextures[i].get()).second)
       {
-         const aiVector3D & tmp = mesh.mVertices[j];
+         mMemory.TextureBytes += mTextures[i]->mMemory;
+      }
+      if (0 != image && true == counted.insert(image.get()).second)
+      {
+         mMemory.ReleasedBytes += image->mPixels.capacity();
+      }
+   }
 
-         if (min.x > tmp.x) min.x = tmp.x;
-         if (min.y > tmp.y) min.y = tmp.y;
-         if (min.z > tmp.z) min.z = tmp.z;
+   //load the meshes into the vram
+   for (size_t i = 0; i < mMeshes.size(); ++i)
+   {
+      Mesh & mesh = mMeshes[i];
+      const CookedMesh & cooked = mCookedMeshes[i];
+      if (0 == cooked.mVertexSize || 0 == cooked.mIndexSize)
+      {
+         continue;
+      }
 
-         if (max.x < tmp.x) max.x = tmp.x;
-         if (max.y < tmp.y) max.y = tmp.y;
-         if (max.z < tmp.z) max.z = tmp.z;
+      if ( true == cooked.mHasTexCoords
+        && mesh.mMaterialIndex < (int)mTextures.size()
+        && 0 != mTextures[mesh.mMaterialIndex])
+      {
+         mesh.mVariant |= ShaderVariant::TEXTURED;
       }
+
+      uploadMesh(mesh, cooked);
+      mMemory.BufferBytes += cooked.mVertexSize + cooked.mIndexSize;
    }
 
-   for (unsigned int i = 0; i < node.mNumChildren; ++i)
+   buildDrawList();
+
+   mMemory.ReleasedBytes += (0 != mMappedFile) ? mMappedFile->getSize() : mCooked.capacity();
+   releaseCooked();
+   calculateCpuMemory();
+   return true;
+}
+
+void CModel::releaseScene()
+{
+   mSkeleton = Skeleton();
+   mMeshes.clear();
+   mCookedMeshes.clear();
+}
+
+void CModel::releaseCooked()
+{
+   mMappedFile.reset();
+   std::vector<unsigned char>().swap(mCooked);
+   std::vector<CookedMesh>().swap(mCookedMeshes);
+   std::vector<std::string>().swap(mTexturePaths);
+   std::vector<CTextureCache::tImage>().swap(mTextureImages);
+}
+
+void CModel::calculateCpuMemory()
+{
+   mMemory.SkeletonBytes = mSkeleton.getMemory();
+   mMemory.DrawBytes = sizeof(CModel)
+      + mMeshes.capacity() * sizeof(Mesh)
+      + mTextures.capacity() * sizeof(CTextureCache::tTexture)
+      + mDrawList.capacity() * sizeof(DrawItem)
+      + mBonePalette.capacity() * sizeof(glm::mat4);
+   mMemory.MeshDataBytes = 0;
+
+   for (size_t i = 0; i < mMeshes.size(); ++i)
    {
-      calculateBBox(*node.mChildren[i], min, max);
+      const Mesh & mesh = mMeshes[i];
+      mMemory.DrawBytes += mesh.mLods.capacity() * sizeof(MeshLod);
+      mMemory.MeshDataBytes += mesh.mVertexData.capacity()
+         + mesh.mIndices.capacity() * sizeof(unsigned int);
    }
 }
 
+float CModel::calculateScale()
+{
+   float xDistance = sqrt(mSceneMax.x * mSceneMax.x + mSceneMin.x * mSceneMin.x);
+   float yDistance = sqrt(mSceneMax.y * mSceneMax.y + mSceneMin.y * mSceneMin.y);
+   float zDistance = sqrt(mSceneMax.z * mSceneMax.z + mSceneMin.z * mSceneMin.z);
+   float scale = sqrt(xDistance * xDistance + yDistance * yDistance + zDistance * zDistance);
+
+   return 1.5 / scale;
+}
+
 void CModel::calculateCenter(
    const aiVector3D & min,
    const aiVector3D & max,
@@ -379,14 +733,73 @@ void CModel::calculateCenter(
    center.z = (min.z + max.z) / 2.f;
 }
 
-void CModel::render(CShader & shader, unsigned int ellapsedTime)
+void CModel::enqueue(
+   CDrawQueue & queue,
+   CShaderLibrary & shaders,
+   const glm::mat4 & projection,
+   const std::vector<glm::mat4> & views,
+   unsigned int ellapsedTime)
 {
+   updateModelMatrix();
+
+   mFrustums.clear();
+   mVisibleViews.clear();
+   for (size_t i = 0; i < views.size(); ++i)
+   {
+      const CFrustum frustum(projection * views[i] * mModelMatrix);
+      if (true == frustum.isVisible(mBounds))
+      {
+         mFrustums.push_back(frustum);
+         mVisibleViews.push_back(views[i]);
+      }
+   }
+
+   if (true == mVisibleViews.empty())
+   {
+      return;
+   }
+
    //set the bone animation to the specified timestamp
    if (0 != mAnimator)
    {
       mAnimator->updateAnimation(ellapsedTime, 20.);
    }
 
+   const unsigned int firstInstance = shaders.addInstances(mVisibleViews);
+   const unsigned int lod = selectLod(projection);
+
+   for (size_t i = 0; i < mDrawList.size(); ++i)
+   {
+      const DrawItem & item = mDrawList[i];
+      if (false == isVisible(item))
+      {
+         continue;
+      }
+
+      DrawCommand command;
+      command.mVariant = item.mVariant;
+      command.mTexture = item.mTexture;
+      command.mMesh = &mMeshes[item.mMesh];
+      command.mLod = std::min(lod, (unsigned int)command.mMesh->mLods.size() - 1);
+      command.mModelMatrix = mModelMatrix * item.mTransform;
+      command.mColor = item.mColor;
+      command.mFirstInstance = firstInstance;
+      command.mInstanceCount = (unsigned int)mVisibleViews.size();
+
+      //update bone matrices
+      if (0 != item.mBoneCount)
+      {
+         updateBones(item);
+         command.mBones = &mBonePalette[item.mBoneSlot];
+         command.mBoneCount = item.mBoneCount;
+      }
+
+      queue.add(command);
+   }
+}
+
+void CModel::updateModelMatrix()
+{
    mModelMatrix = glm::mat4(1.0f);
    mModelMatrix = glm::rotate(mModelMatrix,
                                     90.0f + mUserRotate.x, glm::vec3(1.0f, 0.0f, 0.0f));
@@ -395,116 +808,185 @@ void CModel::render(CShader & shader, unsigned int ellapsedTime)
 
    mModelMatrix = glm::scale(mModelMatrix, glm::vec3(mScale * mUserScale));
 
- 
-   
-
    mModelMatrix = glm::translate(mModelMatrix, glm::vec3(mUserTranslate.x,
                                                          mUserTranslate.y - mSceneCenter.y,
                                                          mUserTranslate.z));
-  
-   shader.setUniform("modelMatrix", mModelMatrix);
+}
 
-   if (mScene->mRootNode != 0)
+bool CModel::isVisible(const DrawItem & item) const
+{
+   // mesh is drawn on all instances, so it is culled only if no one sees it
+   for (size_t i = 0; i < mFrustums.size(); ++i)
    {
-     renderNode(shader, *mScene->mRootNode);
+      if (true == mFrustums[i].isVisible(item.mBounds))
+      {
+         return true;
+      }
    }
+   return false;
 }
 
-void CModel::renderNode(CShader & shader, const aiNode & node)
+void CModel::updateBones(const DrawItem & item)
 {
-   for (unsigned int i = 0; i < node.mNumMeshes; ++i)
+   const Mesh & mesh = mMeshes[item.mMesh];
+   const std::vector<aiMatrix4x4> & boneMatrices =
+      mAnimator->getBoneMatrices(item.mNode, mesh.mFirstBone, (unsigned int)mesh.mNumBones);
+
+   glm::mat4 * palette = &mBonePalette[item.mBoneSlot];
+   for (unsigned int j = 0; j < item.mBoneCount; ++j)
    {
-      const aiMesh & currentMesh = *mScene->mMeshes[node.mMeshes[i]];
-      std::vector<glm::mat4> matrices;
-      matrices.resize(MAXBONESPERMESH);
+      palette[j] = toMat4(boneMatrices[j]);
+   }
+}
 
-      //upload bone matrices
-      if ((currentMesh.HasBones()) && (0 != mAnimator))
-      {
-         const std::vector<aiMatrix4x4> & boneMatrices = mAnimator->getBoneMatrices(node, i);
+void CModel::buildDrawList()
+{
+   // parents precede children, so transform of parent is ready
+   std::vector<aiMatrix4x4> transforms(mSkeleton.mNodes.size());
+   for (size_t n = 0; n < mSkeleton.mNodes.size(); ++n)
+   {
+      const SkeletonNode & node = mSkeleton.mNodes[n];
+      transforms[n] = (Skeleton::NONE != node.mParent)
+         ? transforms[node.mParent] * node.mTransform
+         : node.mTransform;
 
-         if (boneMatrices.size() != currentMesh.mNumBones)
+      for (unsigned int i = 0; i < node.mMeshCount; ++i)
+      {
+         const unsigned int meshIndex = mSkeleton.mNodeMeshes[node.mFirstMesh + i];
+         const Mesh & mesh = mMeshes[meshIndex];
+         if (0 == mesh.mIndexCount)
          {
             continue;
          }
 
-         for (unsigned int j = 0; j < currentMesh.mNumBones; ++j)
+         DrawItem item;
+         item.mMesh = meshIndex;
+         item.mVariant = mesh.mVariant;
+         item.mTexture = (0 != (mesh.mVariant & ShaderVariant::TEXTURED)) ? mTextures[mesh.mMaterialIndex]->mTexture : 0;
+         item.mColor = mesh.mColor;
+         item.mNode = (unsigned int)n;
+
+         if (0 != (mesh.mVariant & ShaderVariant::SKINNED))
          {
-            if (j < MAXBONESPERMESH)
-            {
-               matrices[j][0][0] = boneMatrices[j].a1;
-               matrices[j][0][1] = boneMatrices[j].b1;
-               matrices[j][0][2] = boneMatrices[j].c1;
-               matrices[j][0][3] = boneMatrices[j].d1;
-               matrices[j][1][0] = boneMatrices[j].a2;
-               matrices[j][1][1] = boneMatrices[j].b2;
-               matrices[j][1][2] = boneMatrices[j].c2;
-               matrices[j][1][3] = boneMatrices[j].d2;
-               matrices[j][2][0] = boneMatrices[j].a3;
-               matrices[j][2][1] = boneMatrices[j].b3;
-               matrices[j][2][2] = boneMatrices[j].c3;
-               matrices[j][2][3] = boneMatrices[j].d3;
-               matrices[j][3][0] = boneMatrices[j].a4;
-               matrices[j][3][1] = boneMatrices[j].b4;
-               matrices[j][3][2] = boneMatrices[j].c4;
-               matrices[j][3][3] = boneMatrices[j].d4;
-            }
+            // bones already bring vertices to space of mesh node
+            item.mBoneSlot = (unsigned int)mBonePalette.size();
+            item.mBoneCount = (mesh.mNumBones < (int)CShaderLibrary::MAX_BONES)
+               ? (unsigned int)mesh.mNumBones
+               : (unsigned int)CShaderLibrary::MAX_BONES;
+            mBonePalette.resize(mBonePalette.size() + item.mBoneCount);
+            item.mBounds = mBounds;
          }
+         else
+         {
+            item.mTransform = toMat4(transforms[n]);
+            item.mBounds = mesh.mBounds.transform(item.mTransform);
+         }
+
+         mDrawList.push_back(item);
       }
+   }
+}
 
-      //upload the complete bone matrices to the shaders
-      shader.setUniform("boneMatrices", matrices);
+void CModel::getVariants(std::set<unsigned int> & variants) const
+{
+   for (size_t i = 0; i < mDrawList.size(); ++i)
+   {
+      variants.insert(mDrawList[i].mVariant);
+   }
+}
 
-      drawMesh(shader, node.mMeshes[i]);
+unsigned int CModel::selectLod(const glm::mat4 & projection) const
+{
+   // the nearest marker decides, instances share draws
+   const float radius = mBounds.mRadius * std::max(
+      glm::length(glm::vec3(mModelMatrix[0])),
+      std::max(glm::length(glm::vec3(mModelMatrix[1])), glm::length(glm::vec3(mModelMatrix[2]))));
+
+   float screenSize = 0.f;
+   for (size_t i = 0; i < mVisibleViews.size(); ++i)
+   {
+      const glm::vec4 center = mVisibleViews[i] * mModelMatrix * glm::vec4(mBounds.mCenter, 1.f);
+      const float distance = std::max(-center.z, radius);
+      screenSize = std::max(screenSize, radius * projection[1][1] / distance);
    }
 
-   //render all child nodes
-   for (unsigned int i = 0; i < node.mNumChildren; ++i)
+   unsigned int lod = 0;
+   while ( lod < sizeof(LOD_SCREEN_SIZES) / sizeof(LOD_SCREEN_SIZES[0])
+        && screenSize < LOD_SCREEN_SIZES[lod])
    {
-      renderNode(shader, *node.mChildren[i]);
+      ++lod;
    }
+   return lod;
 }
 
-void CModel::drawMesh(CShader & shader, unsigned int index)
+void CModel::uploadMesh(Mesh & mesh, const CookedMesh & cooked)
 {
-   const Mesh & mesh = mMeshes[index];
+   glGenBuffers(1, &mesh.mVertexBuffer);
+   glBindBuffer(GL_ARRAY_BUFFER, mesh.mVertexBuffer);
+   glBufferData(GL_ARRAY_BUFFER, cooked.mVertexSize, cooked.mVertices, GL_STATIC_DRAW);
+
+   // indices are cooked in the type of the buffer
+   glGenBuffers(1, &mesh.mIndexBuffer);
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.mIndexBuffer);
+   glBufferData(GL_ELEMENT_ARRAY_BUFFER, cooked.mIndexSize, cooked.mIndices, GL_STATIC_DRAW);
+
+   glBindBuffer(GL_ARRAY_BUFFER, 0);
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
-   shader.enableAttributeArray("inPosition");
-   shader.setAttributeArray("inPosition", (const float *)mesh.mVertices.data(), 4);
+   mesh.mIndexCount = (GLsizei)(cooked.mIndexSize / ((GL_UNSIGNED_SHORT == mesh.mIndexType) ? sizeof(GLushort) : sizeof(GLuint)));
 
-   shader.enableAttributeArray("inNormal");
-   shader.setAttributeArray("inNormal", (const float *)mesh.mNormals.data(), 3);
+   // record attribute bindings once, drawing is then just a bind
+   if (GLEW_VERSION_3_0 || GLEW_ARB_vertex_array_object)
+   {
+      glGenVertexArrays(1, &mesh.mVertexArray);
+      glBindVertexArray(mesh.mVertexArray);
+      bindMeshBuffers(mesh);
+      glBindVertexArray(0);
 
-   shader.enableAttributeArray("inBoneWeights");
-   shader.setAttributeArray("inBoneWeights", (const float *)mesh.mWeights.data(), 4);
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+   }
 
-   shader.enableAttributeArray("inBoneIndices");
-   shader.setAttributeArray("inBoneIndices", (const float *)mesh.mBoneIndices.data(), 4);
+   if (true == mKeepMeshData)
+   {
+      mesh.mVertexData.assign(cooked.mVertices, cooked.mVertices + cooked.mVertexSize);
+      if (GL_UNSIGNED_SHORT == mesh.mIndexType)
+      {
+         const GLushort * indices = (const GLushort *)cooked.mIndices;
+         mesh.mIndices.assign(indices, indices + mesh.mIndexCount);
+      }
+      else
+      {
+         const GLuint * indices = (const GLuint *)cooked.mIndices;
+         mesh.mIndices.assign(indices, indices + mesh.mIndexCount);
+      }
+   }
+}
 
-   shader.enableAttributeArray("inTexCoord");
-   shader.setAttributeArray("inTexCoord", (const float *)mesh.mTexCoords.data(), 2);
+void CModel::bindMeshBuffers(const Mesh & mesh)
+{
+   glBindBuffer(GL_ARRAY_BUFFER, mesh.mVertexBuffer);
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.mIndexBuffer);
 
-   if (mTextures[mesh.mMaterialIndex] != -1)
+   if (true == mesh.mSkinned)
    {
-      glActiveTexture(GL_TEXTURE0);
-      glBindTexture(GL_TEXTURE_2D, mTextures[mesh.mMaterialIndex]);
-      shader.setUniform("texture", 0);
-      shader.setUniform("useTexture", 1);
+      tSkinnedVertexLayout::setup(0);
    }
    else
    {
-      shader.enableAttributeArray("inColor");
-      shader.setAttributeArray("inColor", (const float *)mesh.mColors.data(), 4);
-      shader.setUniform("useTexture", 0);
+      tStaticVertexLayout::setup(0);
    }
+}
 
-   glDrawElements(GL_TRIANGLES, mesh.mNumFaces * 3, GL_UNSIGNED_INT, mesh.mIndices.data());
+void CModel::unbindMeshBuffers()
+{
+   for (int i = 0; i < VertexAttribute::COUNT; ++i)
+   {
+      glDisableVertexAttribArray(i);
+   }
 
-   shader.disableAttributeArray("inPosition");
-   shader.disableAttributeArray("inNormal");
-   shader.disableAttributeArray("inBoneWeights");
-   shader.disableAttributeArray("inBoneIndices");
-   shader.disableAttributeArray("inTexCoord");
+   glBindBuffer(GL_ARRAY_BUFFER, 0);
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
 } /* namespace NApp */
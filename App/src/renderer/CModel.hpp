@@ -1,68 +1,269 @@
 #pragma once
 
-#include <assimp/cimport.h>
-#include <assimp/config.h>
 #include <assimp/scene.h>
-#include <assimp/postprocess.h>
 #include <assimp/vector3.h>
+#include <GL/glew.h>
 #include <glm/glm.hpp>
 #include <memory>
+#include <set>
 #include <vector> 
+#include "renderer/CAnimator.hpp"
+#include "renderer/CFrustum.hpp"
+#include "renderer/CTextureCache.hpp"
+#include "renderer/CTextureLoader.hpp"
+#include "renderer/VertexLayout.hpp"
 
 
 namespace NApp
 {
 
 class CShader;
-class CAnimator;
-class TGALoader;
+class CShaderLibrary;
+class CDrawQueue;
+class CModelCache;
+class CMappedFile;
+
+/** Layout of meshes without bones, 20 bytes per vertex. */
+typedef VertexLayout<
+   Attribute<VertexAttribute::POSITION,     Float3Format>,
+   Attribute<VertexAttribute::NORMAL,       Snorm8x3Format>,
+   Attribute<VertexAttribute::TEX_COORD,    Half2Format> > tStaticVertexLayout;
+
+/** Layout of skinned meshes, 32 bytes per vertex. */
+typedef VertexLayout<
+   Attribute<VertexAttribute::POSITION,     Float3Format>,
+   Attribute<VertexAttribute::NORMAL,       Snorm8x3Format>,
+   Attribute<VertexAttribute::TEX_COORD,    Half2Format>,
+   Attribute<VertexAttribute::BONE_INDICES, Ubyte4Format>,
+   Attribute<VertexAttribute::BONE_WEIGHTS, Unorm16x4Format> > tSkinnedVertexLayout;
+
+/** Level of detail of mesh: range of its index buffer. */
+struct MeshLod
+{
+   MeshLod(GLsizei firstIndex, GLsizei indexCount);
+
+   GLsizei mFirstIndex;
+   GLsizei mIndexCount;
+};
 
 struct Mesh
 {
-   std::vector<glm::vec4> mVertices;
-   std::vector<glm::vec3> mNormals;
-   std::vector<glm::vec4> mColors;
-   std::vector<glm::vec2> mTexCoords;
-   std::vector<glm::vec4> mWeights;
-   std::vector<glm::vec4> mBoneIndices;
-   std::vector<int> mIndices;
+   Mesh();
+
+   /** @{ CPU copies of mesh data, empty after upload unless they are kept. */
+   std::vector<GLubyte> mVertexData;  ///< packed vertices, see mSkinned
+   std::vector<unsigned int> mIndices; ///< triangle lists of all LODs one after another, see mIndexType
+   /** @} */
+
+   std::vector<MeshLod> mLods; ///< the full mesh first, then simplified ones
+
    int mMaterialIndex;
    int mNumFaces;
    int mNumVertices;
    int mNumBones;
+   unsigned int mFirstBone; ///< first bone of mesh in skeleton
    unsigned int mTexture;
+   glm::vec4 mColor;      ///< diffuse color of material
+   BoundingVolume mBounds; ///< bounds of vertices in space of mesh
+   bool mSkinned;         ///< tSkinnedVertexLayout if true, tStaticVertexLayout otherwise
+   unsigned int mVariant; ///< shader variant, combination of ShaderVariant::EFlags
+
+   GLuint mVertexArray;   ///< 0 if vertex array objects aren't supported
+   GLuint mVertexBuffer;  ///< interleaved vertices, layout is selected by mSkinned
+   GLuint mIndexBuffer;
+   GLenum mIndexType;     ///< GL_UNSIGNED_SHORT if vertices fit, GL_UNSIGNED_INT otherwise
+   GLsizei mIndexCount;   ///< indices of all LODs, 0 if mesh isn't uploaded
+};
+
+/**
+ * Draw of mesh of one node, draw list of model is built at load time so
+ * rendering doesn't walk node tree.
+ */
+struct DrawItem
+{
+   DrawItem();
+
+   unsigned int mMesh;      ///< index of mesh
+   unsigned int mVariant;   ///< shader variant of mesh
+   GLuint mTexture;         ///< 0 if mesh isn't textured
+   glm::vec4 mColor;        ///< material color of untextured mesh
+   unsigned int mBoneSlot;  ///< first matrix of mesh in bone palette of model
+   unsigned int mBoneCount; ///< 0 if mesh isn't skinned
+   unsigned int mNode;      ///< node of mesh in skeleton
+   glm::mat4 mTransform;    ///< global transform of node of static mesh
+   BoundingVolume mBounds;  ///< bounds in space of model
+};
+
+/** Import statistics of model, they are cooked with it. */
+struct ModelStats
+{
+   ModelStats()
+      : Triangles(0)
+      , CacheMissesBefore(0)
+      , CacheMissesAfter(0)
+   {
+   }
+
+   unsigned int Triangles;         ///< triangles of full meshes
+   unsigned int CacheMissesBefore; ///< vertex cache misses in imported order
+   unsigned int CacheMissesAfter;  ///< vertex cache misses after optimisation
+};
+
+/** Memory held by uploaded model, known after upload(). */
+struct ModelMemory
+{
+   ModelMemory()
+      : SkeletonBytes(0)
+      , DrawBytes(0)
+      , MeshDataBytes(0)
+      , BufferBytes(0)
+      , TextureBytes(0)
+      , ReleasedBytes(0)
+   {
+   }
+
+   size_t getCpuBytes() const
+   {
+      return SkeletonBytes + DrawBytes + MeshDataBytes;
+   }
+
+   size_t getGpuBytes() const
+   {
+      return BufferBytes + TextureBytes;
+   }
+
+   size_t SkeletonBytes; ///< node tree, bones and animations
+   size_t DrawBytes;     ///< model, meshes, draw list and bone palette
+   size_t MeshDataBytes; ///< CPU copies of vertices and indices, only if they are kept
+   size_t BufferBytes;   ///< vertex and index buffers
+   size_t TextureBytes;  ///< textures with mipmaps, shared ones count in every model using them
+   size_t ReleasedBytes; ///< cooked model and decoded images released by upload()
+};
+
+/**
+ * Buffers of mesh in cooked model, they point into cooked data which model
+ * keeps from prepare() until upload().
+ */
+struct CookedMesh
+{
+   CookedMesh();
+
+   const unsigned char * mVertices;
+   GLsizeiptr mVertexSize;
+   const unsigned char * mIndices;
+   GLsizeiptr mIndexSize;
+   bool mHasTexCoords;
 };
 
 class CModel
 {
 public:
-   static std::shared_ptr<CModel> load(const std::string & path);
+   /**
+    * Load model and upload its meshes to GPU, prepare() and upload() in one.
+    * @param path path to model file
+    * @param keepMeshData keep CPU copies of vertex data after upload
+    * @param cache cache of cooked models, may be 0
+    * @param textures textures shared with other models, may be 0
+    */
+   static std::shared_ptr<CModel> load(
+      const std::string & path,
+      bool keepMeshData = false,
+      const CModelCache * cache = 0,
+      CTextureCache * textures = 0);
+
+   /**
+    * CPU part of loading: read cooked model (file is imported and cooked
+    * by CModelCooker only if cache has no cooked model for it) and decode
+    * textures which aren't resident in texture cache. Doesn't touch GL, so
+    * models are prepared on worker threads.
+    * @return model which can't be drawn until upload(), 0 on failure
+    */
+   static std::shared_ptr<CModel> prepare(
+      const std::string & path,
+      bool keepMeshData = false,
+      const CModelCache * cache = 0,
+      CTextureCache * textures = 0);
 
 public:
    ~CModel();
 
-   void render(CShader & shader, unsigned int ellapsedTime);
+   /**
+    * GL part of loading: create buffers and textures of prepared model and
+    * release cooked data. Called on thread with GL context.
+    * @return false if model can't be drawn
+    */
+   bool upload();
+
+   /**
+    * Cull model against frustums of views, add views on which it is visible
+    * as instances and queue draws of visible meshes. Invisible model isn't
+    * animated and invisible skinned meshes don't update bones.
+    * Model is drawn once per frame, queued commands reference its bone
+    * palette until they are executed.
+    * @param queue draw queue of frame
+    * @param shaders library which keeps instances of frame
+    * @param projection projection matrix of camera
+    * @param views view matrices of markers of model
+    * @param ellapsedTime time of animation
+    */
+   void enqueue(
+      CDrawQueue & queue,
+      CShaderLibrary & shaders,
+      const glm::mat4 & projection,
+      const std::vector<glm::mat4> & views,
+      unsigned int ellapsedTime);
+
+   /** Get import statistics, misses divided by triangles give ACMR. */
+   const ModelStats & getStats() const;
+
+   /** Get memory held by model, zero until upload(). */
+   const ModelMemory & getMemory() const;
+
+   /** Add shader variants used by meshes of model. */
+   void getVariants(std::set<unsigned int> & variants) const;
 
    void rotate(const glm::vec3 & value);
    void scale(const glm::vec3 & value);
    void translate(const glm::vec3 & value);
 
+   /** @{ Set attributes of mesh which has no vertex array object. */
+   static void bindMeshBuffers(const Mesh & mesh);
+   static void unbindMeshBuffers();
+   /** @} */
+
 private:
-   explicit CModel(const std::string & path);
+   CModel(const std::string & path, bool keepMeshData, const CModelCache * cache, CTextureCache * textures);
 
-   bool loadScene(const std::string & path);
+   bool loadScene(const std::string & path, const CModelCache * cache);
+   bool parseCooked(const unsigned char * data, size_t size, std::vector<std::string> & texturePaths);
+   void releaseScene();
+   void releaseCooked();
+   void calculateCpuMemory();
 
-   void drawMesh(CShader & shader, unsigned int index);
-   void renderNode(CShader & shader, const aiNode & node);
+   void uploadMesh(Mesh & mesh, const CookedMesh & cooked);
+   unsigned int selectLod(const glm::mat4 & projection) const;
+   void buildDrawList();
+   void updateBones(const DrawItem & item);
+   void updateModelMatrix();
+   bool isVisible(const DrawItem & item) const;
 
    float calculateScale();
-   void calculateBBox(const aiNode & node, aiVector3D & min, aiVector3D & max);
    void calculateCenter(const aiVector3D & min, const aiVector3D & max, aiVector3D & center);
 
 private:
+   bool mKeepMeshData;
+   CTextureCache * mTextureCache; ///< may be 0
+
+   Skeleton mSkeleton; ///< node tree and animations, read from cooked model
 
-   const aiScene * mScene;
-   aiPropertyStore * mStore;
+   /** @{ Data of prepared model, released by upload(). */
+   std::shared_ptr<CMappedFile> mMappedFile; ///< cached cooked model
+   std::vector<unsigned char> mCooked;       ///< model cooked by this load
+   std::vector<CookedMesh> mCookedMeshes;
+   std::vector<std::string> mTexturePaths;            ///< by material
+   std::vector<CTextureCache::tImage> mTextureImages; ///< 0 if texture is resident in cache
+   bool mUploaded;
+   /** @} */
 
    aiVector3D mSceneMin;
    aiVector3D mSceneMax;
@@ -74,13 +275,33 @@ private:
    glm::vec3 mUserTranslate;
 
    std::vector<Mesh> mMeshes;
-   std::vector<unsigned int> mTextures;
+   std::vector<CTextureCache::tTexture> mTextures; ///< by material, 0 if material has none
   
    std::shared_ptr<CAnimator> mAnimator;
+   std::vector<DrawItem> mDrawList;
+   std::vector<glm::mat4> mBonePalette; ///< bones of all skinned draws
+   BoundingVolume mBounds;              ///< bounds of all draws in space of model
+
+   std::vector<CFrustum> mFrustums;     ///< of visible instances of frame
+   std::vector<glm::mat4> mVisibleViews;
 
    glm::mat4 mModelMatrix;
+   ModelStats mStats;
+   ModelMemory mMemory;
 };
 
+inline
+const ModelStats & CModel::getStats() const
+{
+   return mStats;
+}
+
+inline
+const ModelMemory & CModel::getMemory() const
+{
+   return mMemory;
+}
+
 inline
 void CModel::rotate(const glm::vec3 & value)
 {  
@@ -0,0 +1,126 @@
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include "renderer/CModelCache.hpp"
+#include "renderer/CUtils.hpp"
+#include "loader/CMappedFile.hpp"
+
+namespace NApp
+{
+
+/** "MDLC", file of other format isn't loaded. */
+const unsigned int CModelCache::MAGIC = 0x434c444du;
+/** Incremented when layout of header changes. */
+const unsigned int CModelCache::VERSION = 1u;
+/** Magic, version and size, cooked data after it stay 8 byte aligned. */
+const size_t CModelCache::HEADER_SIZE = 16u;
+
+CModelCache::CModelCache(const std::string & directory)
+   : mDirectory(directory)
+   , mEnabled(CUtils::createDirectory(directory))
+{
+}
+
+bool CModelCache::isEnabled() const
+{
+   return mEnabled;
+}
+
+std::string CModelCache::getKey(const std::string & path, unsigned long long settings) const
+{
+   long long time = 0;
+   if (false == CUtils::getModificationTime(path, time))
+   {
+      return std::string();
+   }
+
+   std::ostringstream source;
+   source << time << "\n" << settings;
+
+   unsigned long long hash = CUtils::HASH_SEED;
+   CUtils::hashString(CUtils::replaceString(path, "\\", "/"), hash);
+   CUtils::hashString(source.str(), hash);
+
+   std::ostringstream key;
+   key << std::hex << std::setw(16) << std::setfill('0') << hash;
+   return key.str();
+}
+
+bool CModelCache::load(const std::string & key, CMappedFile & file, const unsigned char *& data, size_t & size) const
+{
+   if (false == mEnabled || false == file.open(getPath(key)))
+   {
+      return false;
+   }
+
+   if (file.getSize() < HEADER_SIZE)
+   {
+      file.close();
+      return false;
+   }
+
+   const unsigned int * header = (const unsigned int *)file.getData();
+   const unsigned long long stored = *(const unsigned long long *)(file.getData() + 8);
+   if ( MAGIC != header[0]
+     || VERSION != header[1]
+     || stored != file.getSize() - HEADER_SIZE)
+   {
+      // partly written entry is stored again
+      file.close();
+      return false;
+   }
+
+   data = file.getData() + HEADER_SIZE;
+   size = (size_t)stored;
+   return true;
+}
+
+void CModelCache::store(const std::string & key, const std::vector<unsigned char> & data) const
+{
+   if (false == mEnabled || true == data.empty())
+   {
+      return;
+   }
+
+   // models are cooked on several threads, entry appears complete or not at all
+   std::ostringstream tmpPath;
+   tmpPath << getPath(key) << "." << std::this_thread::get_id() << ".tmp";
+   {
+      std::ofstream file(tmpPath.str().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+      if (false == file.is_open())
+      {
+         std::cerr << "Can't write model cache '" << tmpPath.str() << "'." << std::endl;
+         return;
+      }
+
+      const unsigned int header[2] = { MAGIC, VERSION };
+      const unsigned long long size = data.size();
+      file.write((const char *)header, sizeof(header));
+      file.write((const char *)&size, sizeof(size));
+      file.write((const char *)data.data(), data.size());
+   }
+
+   // existing entry is replaced, fails if other thread stored the same entry first and it's mapped
+#ifdef _WIN32
+   // rename() of MSVC runtime doesn't replace existing file
+   if (0 == MoveFileExA(tmpPath.str().c_str(), getPath(key).c_str(), MOVEFILE_REPLACE_EXISTING))
+#else
+   if (0 != std::rename(tmpPath.str().c_str(), getPath(key).c_str()))
+#endif
+   {
+      std::remove(tmpPath.str().c_str());
+   }
+}
+
+std::string CModelCache::getPath(const std::string & key) const
+{
+   return mDirectory + "/" + key + ".model";
+}
+
+} /* namespace NApp */
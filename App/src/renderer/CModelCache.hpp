@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace NApp
+{
+
+class CMappedFile;
+
+/**
+ * Disk cache of cooked models, see CModelCooker, and of their compressed
+ * textures, see CTextureCache.
+ *
+ * Entry is stored under key made of path and modification time of model
+ * file and of import settings, so edited model or changed import makes
+ * new entry instead of loading stale one. Entries are mapped to memory,
+ * vertex and index data are uploaded straight from the mapping.
+ * Models are loaded on worker threads, methods are thread safe.
+ */
+class CModelCache
+{
+public:
+   /**
+    * Constructor.
+    * @param directory directory of cache files, it's created if it's needed
+    */
+   explicit CModelCache(const std::string & directory);
+
+   /** @return true if directory of cache exists. */
+   bool isEnabled() const;
+
+   /**
+    * Get key of model file.
+    * @param path path to model file
+    * @param settings hash of import settings
+    * @return empty string if file doesn't exist
+    */
+   std::string getKey(const std::string & path, unsigned long long settings) const;
+
+   /**
+    * Map entry.
+    * @param[out] file mapping, keeps data valid
+    * @param[out] data cooked model in mapping
+    * @param[out] size size of cooked model
+    * @return true if entry exists and has valid header
+    */
+   bool load(const std::string & key, CMappedFile & file, const unsigned char *& data, size_t & size) const;
+
+   /** Store cooked model. */
+   void store(const std::string & key, const std::vector<unsigned char> & data) const;
+
+private:
+   std::string getPath(const std::string & key) const;
+
+private:
+   static const unsigned int MAGIC;
+   static const unsigned int VERSION;
+   static const size_t HEADER_SIZE;
+
+private:
+   std::string mDirectory;
+   bool mEnabled;
+};
+
+} /* namespace NApp */
@@ -0,0 +1,520 @@
+#include <iostream>
+#include <sstream>
+#include <assimp/config.h>
+#include <assimp/postprocess.h>
+#include "renderer/CMeshSimplifier.hpp"
+#include "renderer/CModelCooker.hpp"
+#include "renderer/CShaderLibrary.hpp"
+#include "renderer/CUtils.hpp"
+#include "renderer/CVertexCache.hpp"
+#include "loader/CBinaryStream.hpp"
+
+namespace NApp
+{
+
+/** Number of indices of each LOD relative to the full mesh. */
+static const float LOD_RATIOS[] = { 0.5f, 0.25f };
+
+/** Meshes with less triangles aren't simplified. */
+static const int MIN_LOD_FACES = 128;
+
+/** LOD is dropped if simplification stops above this part of previous LOD. */
+static const float MIN_LOD_REDUCTION = 0.8f;
+
+const unsigned int CModelCooker::IMPORT_FLAGS =
+   aiProcessPreset_TargetRealtime_Quality |
+   aiProcess_FindInstances |
+   aiProcess_ValidateDataStructure |
+   aiProcess_OptimizeMeshes;
+
+/** Incremented when cooked layout or processing of meshes changes. */
+const unsigned int CModelCooker::FORMAT_VERSION = 2u;
+
+template <typename LAYOUT>
+static void packVertices(const std::vector<VertexSource> & sources, std::vector<GLubyte> & data)
+{
+   data.resize(sources.size() * LAYOUT::STRIDE);
+
+   typename LAYOUT::tVertex * vertices = reinterpret_cast<typename LAYOUT::tVertex *>(data.data());
+   for (size_t i = 0; i < sources.size(); ++i)
+   {
+      LAYOUT::pack(sources[i], vertices[i]);
+   }
+}
+
+template <typename T>
+static void writeArray(const T * data, unsigned int count, CBinaryWriter & writer)
+{
+   writer.write(count);
+   writer.write(data, count * sizeof(T));
+}
+
+unsigned long long CModelCooker::getSettings()
+{
+   std::ostringstream settings;
+   settings << IMPORT_FLAGS << "\n" << FORMAT_VERSION << "\n"
+            << sizeof(tStaticVertexLayout::tVertex) << "\n"
+            << sizeof(tSkinnedVertexLayout::tVertex);
+
+   unsigned long long hash = CUtils::HASH_SEED;
+   CUtils::hashString(settings.str(), hash);
+   return hash;
+}
+
+CModelCooker::CModelCooker()
+   : mScene(0)
+   , mStore(0)
+{
+}
+
+CModelCooker::~CModelCooker()
+{
+   release();
+}
+
+void CModelCooker::release()
+{
+   if (0 != mScene)
+   {
+      aiReleaseImport(mScene);
+      mScene = 0;
+   }
+   if (0 != mStore)
+   {
+      aiReleasePropertyStore(mStore);
+      mStore = 0;
+   }
+}
+
+bool CModelCooker::cook(const std::string & path, std::vector<unsigned char> & cooked)
+{
+   release();
+   mStats = ModelStats();
+   cooked.clear();
+
+   //import the model via Assimp
+   mStore = aiCreatePropertyStore();
+   aiSetImportPropertyInteger(mStore, AI_CONFIG_IMPORT_TER_MAKE_UVS, 1);
+   aiSetImportPropertyFloat  (mStore, AI_CONFIG_PP_GSN_MAX_SMOOTHING_ANGLE, 80.0f);
+   aiSetImportPropertyInteger(mStore, AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_LINE |
+                                                               aiPrimitiveType_POINT);
+
+   mScene = aiImportFileExWithProperties(path.c_str(), IMPORT_FLAGS, 0, mStore);
+
+   if (0 == mScene)
+   {
+      std::cerr << "Loading model failed." << std::endl;
+      release();
+      return false;
+   }
+
+   aiVector3D sceneMin(1e10f, 1e10f, 1e10f);
+   aiVector3D sceneMax(-1e10f, -1e10f, -1e10f);
+   calculateBBox(*mScene->mRootNode, aiMatrix4x4(), sceneMin, sceneMax);
+
+   // meshes are cooked first, statistics of all of them go to the front
+   std::vector<unsigned char> meshes;
+   CBinaryWriter meshWriter(meshes);
+   meshWriter.write(mScene->mNumMeshes);
+   for (unsigned int i = 0; i < mScene->mNumMeshes; ++i)
+   {
+      if (false == cookMesh(*mScene->mMeshes[i], meshWriter))
+      {
+         release();
+         return false;
+      }
+   }
+
+   CBinaryWriter writer(cooked);
+   writer.write(mStats);
+   writer.write(sceneMin);
+   writer.write(sceneMax);
+
+   writer.write(mScene->mNumMaterials);
+   for (unsigned int i = 0; i < mScene->mNumMaterials; ++i)
+   {
+      aiString texturePath;
+      aiGetMaterialTexture(
+         mScene->mMaterials[i],
+         aiTextureType_DIFFUSE,
+         0,
+         &texturePath,
+         0, 0, 0, 0, 0, 0);
+
+      writer.writeString(CUtils::getFullPath(path, std::string(texturePath.data)));
+   }
+
+   // mesh data are aligned relative to the start of cooked model
+   writer.align(8);
+   writer.write(meshes.data(), meshes.size());
+
+   writeNode(*mScene->mRootNode, writer);
+
+   writer.write(mScene->mNumAnimations);
+   for (unsigned int i = 0; i < mScene->mNumAnimations; ++i)
+   {
+      writeAnimation(*mScene->mAnimations[i], writer);
+   }
+
+   // the scene isn't needed once it's cooked
+   release();
+   return true;
+}
+
+bool CModelCooker::cookMesh(const aiMesh & source, CBinaryWriter & writer)
+{
+   Mesh mesh;
+   if (false == processMesh(source, mesh))
+   {
+      return false;
+   }
+
+   const unsigned char hasTexCoords = (true == source.HasTextureCoords(0)) ? 1 : 0;
+
+   writer.write(mesh.mMaterialIndex);
+   writer.write(mesh.mNumFaces);
+   writer.write(mesh.mNumVertices);
+   writer.write(mesh.mNumBones);
+   writer.write(mesh.mColor);
+   writer.write(mesh.mBounds.mMin);
+   writer.write(mesh.mBounds.mMax);
+   writer.write((unsigned char)((true == mesh.mSkinned) ? 1 : 0));
+   writer.write(hasTexCoords);
+   writer.write(mesh.mVariant);
+   writer.write((unsigned int)mesh.mIndexType);
+
+   writer.write((unsigned int)mesh.mLods.size());
+   for (size_t i = 0; i < mesh.mLods.size(); ++i)
+   {
+      writer.write(mesh.mLods[i].mFirstIndex);
+      writer.write(mesh.mLods[i].mIndexCount);
+   }
+
+   writer.write((unsigned int)mesh.mVertexData.size());
+   writer.align(4);
+   writer.write(mesh.mVertexData.data(), mesh.mVertexData.size());
+
+   // indices are stored in the type of the index buffer
+   if (GL_UNSIGNED_SHORT == mesh.mIndexType)
+   {
+      const std::vector<GLushort> indices(mesh.mIndices.begin(), mesh.mIndices.end());
+      writer.write((unsigned int)(indices.size() * sizeof(GLushort)));
+      writer.align(4);
+      writer.write(indices.data(), indices.size() * sizeof(GLushort));
+   }
+   else
+   {
+      writer.write((unsigned int)(mesh.mIndices.size() * sizeof(unsigned int)));
+      writer.align(4);
+      writer.write(mesh.mIndices.data(), mesh.mIndices.size() * sizeof(unsigned int));
+   }
+
+   // bones of skipped meshes are kept for the animator
+   writer.write(source.mNumBones);
+   for (unsigned int i = 0; i < source.mNumBones; ++i)
+   {
+      const aiBone & bone = *source.mBones[i];
+      writer.writeString(std::string(bone.mName.data, bone.mName.length));
+      writer.write(bone.mOffsetMatrix);
+   }
+   return true;
+}
+
+bool CModelCooker::processMesh(const aiMesh & currentMesh, Mesh & mesh)
+{
+   mesh.mNumFaces = currentMesh.mNumFaces;
+   mesh.mNumVertices = currentMesh.mNumVertices;
+   mesh.mNumBones = currentMesh.mNumBones;
+   mesh.mMaterialIndex = currentMesh.mMaterialIndex;
+
+   if (mesh.mNumFaces == 0 || mesh.mNumVertices == 0)
+   {
+      return true;
+   }
+   if (!currentMesh.HasPositions())
+   {
+      std::cerr << "A mesh of the model has no vertices and is not loaded." << std::endl;
+      return true;
+   }
+   if (!currentMesh.HasNormals())
+   {
+      std::cerr << "A mesh of the model has no normals and is not loaded." << std::endl;
+      return true;
+   }
+   if (!currentMesh.HasFaces())
+   {
+      std::cerr << "A mesh of the model has no polygon faces and is not loaded." << std::endl;
+      return true;
+   }
+
+   // one color per mesh, vertex colors of the old format only duplicated it
+   if ( currentMesh.mMaterialIndex < mScene->mNumMaterials
+     && 0 != mScene->mMaterials[currentMesh.mMaterialIndex])
+   {
+      const aiMaterial & currentMaterial = *mScene->mMaterials[currentMesh.mMaterialIndex];
+
+      aiColor4D color;
+      aiGetMaterialColor(&currentMaterial, AI_MATKEY_COLOR_DIFFUSE, &color);
+      mesh.mColor = glm::vec4(color.r, color.g, color.b, 1.0f);
+   }
+   else
+   {
+      mesh.mColor = glm::vec4(1.f, 0.f, 0.f, 1.0f);
+   }
+
+   std::vector<VertexSource> sources(mesh.mNumVertices);
+   for (int j = 0; j < mesh.mNumVertices; ++j)
+   {
+      VertexSource & source = sources[j];
+
+      source.values[VertexAttribute::POSITION] = glm::vec4(
+         currentMesh.mVertices[j].x,
+         currentMesh.mVertices[j].y,
+         currentMesh.mVertices[j].z,
+         1.0f);
+      mesh.mBounds.add(glm::vec3(source.values[VertexAttribute::POSITION]));
+
+      source.values[VertexAttribute::NORMAL] = glm::vec4(
+         currentMesh.mNormals[j].x,
+         currentMesh.mNormals[j].y,
+         currentMesh.mNormals[j].z,
+         0.0f);
+
+      if (true == currentMesh.HasTextureCoords(0))
+      {
+         source.values[VertexAttribute::TEX_COORD] = glm::vec4(
+            currentMesh.mTextureCoords[0][j].x,
+            1.0f - currentMesh.mTextureCoords[0][j].y,
+            0.0f, 0.0f);
+      }
+   }
+
+   mesh.mIndices.resize(mesh.mNumFaces * 3);
+   for (int j = 0; j < mesh.mNumFaces; ++j)
+   {
+      mesh.mIndices[j * 3] = currentMesh.mFaces[j].mIndices[0];
+      mesh.mIndices[j * 3 + 1] = currentMesh.mFaces[j].mIndices[1];
+      mesh.mIndices[j * 3 + 2] = currentMesh.mFaces[j].mIndices[2];
+   }
+
+   //read bone indices and weights for bone animation
+   std::vector<std::vector<aiVertexWeight> > vTempWeightsPerVertex;
+   vTempWeightsPerVertex.resize(currentMesh.mNumVertices);
+
+   for (unsigned int j = 0; j < currentMesh.mNumBones; ++j)
+   {
+      const aiBone & bone = *currentMesh.mBones[j];
+      for (unsigned int b = 0; b < bone.mNumWeights; ++b)
+      {
+         std::vector<aiVertexWeight> & weight = vTempWeightsPerVertex[bone.mWeights[b].mVertexId];
+         weight.push_back(aiVertexWeight(j, bone.mWeights[b].mWeight));
+      }
+   }
+
+   mesh.mSkinned = isSkinned(currentMesh);
+   if (true == mesh.mSkinned)
+   {
+      for (int j = 0; j < mesh.mNumVertices; ++j)
+      {
+         if (4 < vTempWeightsPerVertex[j].size())
+         {
+            std::cerr << "The model has invalid bone weights and is not loaded." << std::endl;
+            return false;
+         }
+
+         for (unsigned int k = 0; k < vTempWeightsPerVertex[j].size(); ++k)
+         {
+            sources[j].values[VertexAttribute::BONE_INDICES][k] = (GLfloat) vTempWeightsPerVertex[j][k].mVertexId;
+            sources[j].values[VertexAttribute::BONE_WEIGHTS][k] = (GLfloat) vTempWeightsPerVertex[j][k].mWeight;
+         }
+      }
+   }
+
+   mesh.mBounds.updateSphere();
+   buildLods(mesh, sources);
+   optimizeIndices(mesh, sources);
+
+   if (true == mesh.mSkinned)
+   {
+      packVertices<tSkinnedVertexLayout>(sources, mesh.mVertexData);
+   }
+   else
+   {
+      packVertices<tStaticVertexLayout>(sources, mesh.mVertexData);
+   }
+   mesh.mVariant = selectVariant(currentMesh);
+   return true;
+}
+
+void CModelCooker::writeNode(const aiNode & node, CBinaryWriter & writer)
+{
+   writer.writeString(std::string(node.mName.data, node.mName.length));
+   writer.write(node.mTransformation);
+   writeArray(node.mMeshes, node.mNumMeshes, writer);
+
+   writer.write(node.mNumChildren);
+   for (unsigned int i = 0; i < node.mNumChildren; ++i)
+   {
+      writeNode(*node.mChildren[i], writer);
+   }
+}
+
+void CModelCooker::writeAnimation(const aiAnimation & animation, CBinaryWriter & writer)
+{
+   writer.writeString(std::string(animation.mName.data, animation.mName.length));
+   writer.write(animation.mDuration);
+   writer.write(animation.mTicksPerSecond);
+
+   writer.write(animation.mNumChannels);
+   for (unsigned int i = 0; i < animation.mNumChannels; ++i)
+   {
+      const aiNodeAnim & channel = *animation.mChannels[i];
+      writer.writeString(std::string(channel.mNodeName.data, channel.mNodeName.length));
+      writer.write((unsigned int)channel.mPreState);
+      writer.write((unsigned int)channel.mPostState);
+      writeArray(channel.mPositionKeys, channel.mNumPositionKeys, writer);
+      writeArray(channel.mRotationKeys, channel.mNumRotationKeys, writer);
+      writeArray(channel.mScalingKeys, channel.mNumScalingKeys, writer);
+   }
+}
+
+bool CModelCooker::isSkinned(const aiMesh & mesh) const
+{
+   // skinned layout without animation would blend only identity matrices
+   return (true == mesh.HasBones() && true == mScene->HasAnimations());
+}
+
+unsigned int CModelCooker::selectVariant(const aiMesh & mesh) const
+{
+   // TEXTURED is added by CModel, only it knows if texture was loaded
+   unsigned int variant = ShaderVariant::NONE;
+
+   if (true == isSkinned(mesh))
+   {
+      variant |= ShaderVariant::SKINNED;
+   }
+
+   int shading = aiShadingMode_Gouraud;
+   if ( mesh.mMaterialIndex < mScene->mNumMaterials
+     && 0 != mScene->mMaterials[mesh.mMaterialIndex])
+   {
+      aiGetMaterialInteger(mScene->mMaterials[mesh.mMaterialIndex], AI_MATKEY_SHADING_MODEL, &shading);
+   }
+   if (aiShadingMode_NoShading != shading)
+   {
+      variant |= ShaderVariant::LIT;
+   }
+
+   return variant;
+}
+
+void CModelCooker::buildLods(Mesh & mesh, const std::vector<VertexSource> & sources)
+{
+   const GLsizei fullCount = (GLsizei)mesh.mIndices.size();
+   mesh.mLods.assign(1, MeshLod(0, fullCount));
+
+   if (mesh.mNumFaces < MIN_LOD_FACES)
+   {
+      return;
+   }
+
+   std::vector<glm::vec3> positions(sources.size());
+   for (size_t i = 0; i < sources.size(); ++i)
+   {
+      positions[i] = glm::vec3(sources[i].values[VertexAttribute::POSITION]);
+   }
+
+   CMeshSimplifier simplifier(positions, mesh.mIndices);
+   if (true == mesh.mSkinned)
+   {
+      std::vector<glm::vec4> boneIndices(sources.size());
+      std::vector<glm::vec4> boneWeights(sources.size());
+      for (size_t i = 0; i < sources.size(); ++i)
+      {
+         boneIndices[i] = sources[i].values[VertexAttribute::BONE_INDICES];
+         boneWeights[i] = sources[i].values[VertexAttribute::BONE_WEIGHTS];
+      }
+      simplifier.setSkin(boneIndices, boneWeights);
+   }
+
+   // LODs share vertices of the full mesh, they are appended to its indices
+   std::vector<unsigned int> indices;
+   for (size_t i = 0; i < sizeof(LOD_RATIOS) / sizeof(LOD_RATIOS[0]); ++i)
+   {
+      simplifier.simplify((size_t)(fullCount * LOD_RATIOS[i]), indices);
+
+      const MeshLod & previous = mesh.mLods.back();
+      if (true == indices.empty() || indices.size() > previous.mIndexCount * MIN_LOD_REDUCTION)
+      {
+         break;
+      }
+
+      mesh.mLods.push_back(MeshLod((GLsizei)mesh.mIndices.size(), (GLsizei)indices.size()));
+      mesh.mIndices.insert(mesh.mIndices.end(), indices.begin(), indices.end());
+   }
+}
+
+void CModelCooker::optimizeIndices(Mesh & mesh, std::vector<VertexSource> & sources)
+{
+   const MeshLod & full = mesh.mLods[0];
+   mStats.Triangles += full.mIndexCount / 3;
+   mStats.CacheMissesBefore += CVertexCache::countCacheMisses(&mesh.mIndices[full.mFirstIndex], full.mIndexCount);
+
+   for (size_t i = 0; i < mesh.mLods.size(); ++i)
+   {
+      const MeshLod & lod = mesh.mLods[i];
+      CVertexCache::optimizeTriangles(&mesh.mIndices[lod.mFirstIndex], lod.mIndexCount, sources.size());
+   }
+
+   mStats.CacheMissesAfter += CVertexCache::countCacheMisses(&mesh.mIndices[full.mFirstIndex], full.mIndexCount);
+
+   // vertices in order of use by the full mesh, then by LODs
+   std::vector<unsigned int> order;
+   CVertexCache::optimizeFetch(mesh.mIndices, sources.size(), order);
+
+   std::vector<VertexSource> reordered(sources.size());
+   for (size_t i = 0; i < order.size(); ++i)
+   {
+      reordered[i] = sources[order[i]];
+   }
+   sources.swap(reordered);
+
+   mesh.mIndexType = (sources.size() <= 0x10000) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+void CModelCooker::calculateBBox(
+   const aiNode & node,
+   const aiMatrix4x4 & parentTransform,
+   aiVector3D & min,
+   aiVector3D & max)
+{
+   const aiMatrix4x4 transform = parentTransform * node.mTransformation;
+
+   for (unsigned int i = 0; i < node.mNumMeshes; ++i)
+   {
+      const aiMesh & mesh = *mScene->mMeshes[node.mMeshes[i]];
+
+      // the same transform as the mesh is drawn with, see CModel::buildDrawList()
+      const bool skinned = isSkinned(mesh);
+
+      for (unsigned int j = 0; j < mesh.mNumVertices; ++j)
+      {
+         const aiVector3D tmp = (true == skinned) ? mesh.mVertices[j] : transform * mesh.mVertices[j];
+
+         if (min.x > tmp.x) min.x = tmp.x;
+         if (min.y > tmp.y) min.y = tmp.y;
+         if (min.z > tmp.z) min.z = tmp.z;
+
+         if (max.x < tmp.x) max.x = tmp.x;
+         if (max.y < tmp.y) max.y = tmp.y;
+         if (max.z < tmp.z) max.z = tmp.z;
+      }
+   }
+
+   for (unsigned int i = 0; i < node.mNumChildren; ++i)
+   {
+      calculateBBox(*node.mChildren[i], transform, min, max);
+   }
+}
+
+} /* namespace NApp */
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <assimp/cimport.h>
+#include <assimp/scene.h>
+#include <string>
+#include <vector>
+#include "renderer/CModel.hpp"
+
+namespace NApp
+{
+
+class CBinaryWriter;
+
+/**
+ * Import of model file by Assimp into cooked model, which CModel loads
+ * without Assimp. Cooked model contains, in order:
+ *  - ModelStats and bounding box of scene;
+ *  - full paths of diffuse textures of materials;
+ *  - meshes: parameters, LOD ranges, packed vertices and indices in
+ *    the format of GPU buffers, names and offset matrices of bones;
+ *  - node tree with transforms and mesh indices;
+ *  - animations with channels of keys.
+ * Values are in memory layout of this platform, FORMAT_VERSION is part of
+ * settings, so cache key changes with the format.
+ */
+class CModelCooker
+{
+public:
+   /** Hash of import flags and format version for CModelCache::getKey(). */
+   static unsigned long long getSettings();
+
+public:
+   CModelCooker();
+   ~CModelCooker();
+
+   /**
+    * Import model and cook it.
+    * @param path path to model file
+    * @param[out] cooked cooked model
+    * @return false if model can't be imported
+    */
+   bool cook(const std::string & path, std::vector<unsigned char> & cooked);
+
+private:
+   bool cookMesh(const aiMesh & source, CBinaryWriter & writer);
+   bool processMesh(const aiMesh & source, Mesh & mesh);
+   void writeNode(const aiNode & node, CBinaryWriter & writer);
+   void writeAnimation(const aiAnimation & animation, CBinaryWriter & writer);
+
+   bool isSkinned(const aiMesh & mesh) const;
+   unsigned int selectVariant(const aiMesh & mesh) const;
+   void buildLods(Mesh & mesh, const std::vector<VertexSource> & sources);
+   void optimizeIndices(Mesh & mesh, std::vector<VertexSource> & sources);
+   void calculateBBox(const aiNode & node, const aiMatrix4x4 & parentTransform, aiVector3D & min, aiVector3D & max);
+
+   void release();
+
+private:
+   static const unsigned int IMPORT_FLAGS;
+   static const unsigned int FORMAT_VERSION;
+
+private:
+   const aiScene * mScene;
+   aiPropertyStore * mStore;
+   ModelStats mStats;
+};
+
+} /* namespace NApp */
@@ -0,0 +1,315 @@
+#include <chrono>
+#include <climits>
+#include <iostream>
+#include "renderer/CModelRegistry.hpp"
+#include "renderer/CModel.hpp"
+#include "renderer/CTextureCache.hpp"
+#include "loader/CThreadPool.hpp"
+
+namespace NApp
+{
+
+const int CModelRegistry::NO_PRELOAD = INT_MIN;
+const int CModelRegistry::SIGHTED_PRIORITY = INT_MAX;
+const unsigned int CModelRegistry::EMPTY = UINT_MAX;
+
+/** Initial number of hash table buckets, power of two. */
+static const size_t MIN_BUCKETS = 16;
+
+CModelRegistry::Slot::Slot()
+   : mMarkerId(0)
+   , mPriority(NO_PRELOAD)
+   , mRequested(false)
+   , mLastSeen(0)
+{
+}
+
+CModelRegistry::Bucket::Bucket()
+   : mMarkerId(0)
+   , mSlot(EMPTY)
+{
+}
+
+CModelRegistry::CModelRegistry(
+      CThreadPool & loader,
+      const CModelCache * cache,
+      CTextureCache * textures,
+      size_t budget)
+   : mLoader(loader)
+   , mCache(cache)
+   , mTextures(textures)
+   , mBudget(budget)
+   , mBuckets(MIN_BUCKETS)
+   , mFrame(1)
+{
+}
+
+bool CModelRegistry::add(unsigned int markerId, const std::string & path, int priority)
+{
+   if (EMPTY != find(markerId))
+   {
+      return false;
+   }
+
+   // keep load factor at most 1/2, probe chains stay short
+   if (2 * (mSlots.size() + 1) > mBuckets.size())
+   {
+      rehash(2 * mBuckets.size());
+   }
+   insert(markerId, (unsigned int)mSlots.size());
+
+   Slot slot;
+   slot.mMarkerId = markerId;
+   slot.mPath = path;
+   slot.mPriority = priority;
+   mSlots.push_back(slot);
+
+   ++mStats.Models;
+   return true;
+}
+
+void CModelRegistry::preload(bool all)
+{
+   for (size_t i = 0; i < mSlots.size(); ++i)
+   {
+      if (true == all || NO_PRELOAD != mSlots[i].mPriority)
+      {
+         request(mSlots[i], mSlots[i].mPriority);
+      }
+   }
+}
+
+void CModelRegistry::uploadAll()
+{
+   for (size_t i = 0; i < mSlots.size(); ++i)
+   {
+      if (true == mSlots[i].mPending.valid())
+      {
+         uploadSlot(mSlots[i]);
+      }
+   }
+   evict();
+}
+
+CModel * CModelRegistry::get(unsigned int markerId)
+{
+   const unsigned int index = find(markerId);
+   if (EMPTY == index)
+   {
+      return 0;
+   }
+
+   Slot & slot = mSlots[index];
+   slot.mLastSeen = mFrame;
+   if (0 == slot.mModel)
+   {
+      // evicted model is requested again, failed one stays so
+      request(slot, SIGHTED_PRIORITY);
+   }
+   return slot.mModel.get();
+}
+
+void CModelRegistry::update(unsigned int maxUploads)
+{
+   ++mFrame;
+
+   unsigned int uploads = 0;
+   for (size_t i = 0; i < mSlots.size() && uploads < maxUploads; ++i)
+   {
+      const std::shared_future<tModel> & pending = mSlots[i].mPending;
+      if ( true == pending.valid()
+        && std::future_status::ready == pending.wait_for(std::chrono::seconds(0)))
+      {
+         uploadSlot(mSlots[i]);
+         ++uploads;
+      }
+   }
+
+   evict();
+}
+
+void CModelRegistry::getVariants(std::set<unsigned int> & variants) const
+{
+   for (size_t i = 0; i < mSlots.size(); ++i)
+   {
+      if (0 != mSlots[i].mModel)
+      {
+         mSlots[i].mModel->getVariants(variants);
+      }
+   }
+}
+
+RegistryStats CModelRegistry::getStats() const
+{
+   RegistryStats stats = mStats;
+   stats.GpuBytes = getResidentBytes() - stats.CpuBytes;
+   return stats;
+}
+
+std::shared_future<CModelRegistry::tModel> CModelRegistry::prepare(const std::string & path, int priority)
+{
+   return mLoader.submit(
+      std::function<tModel()>(std::bind(&CModel::prepare, path, false, mCache, mTextures)),
+      priority).share();
+}
+
+CModelRegistry::tModel CModelRegistry::upload(const std::shared_future<tModel> & prepared)
+{
+   tModel model = prepared.get();
+   if (0 != model && false == model->upload())
+   {
+      model.reset();
+   }
+   return model;
+}
+
+void CModelRegistry::printStats(const CModel & model)
+{
+   const ModelStats & stats = model.getStats();
+   if (0 != stats.Triangles)
+   {
+      const float triangles = (float)stats.Triangles;
+      std::cout << "   " << stats.Triangles << " triangles, ACMR "
+                << stats.CacheMissesBefore / triangles << " -> "
+                << stats.CacheMissesAfter / triangles
+                << std::endl;
+   }
+
+   const ModelMemory & memory = model.getMemory();
+   std::cout << "   CPU " << memory.getCpuBytes() / 1024 << " KB (skeleton "
+             << memory.SkeletonBytes / 1024 << ", draws "
+             << memory.DrawBytes / 1024 << ", mesh data "
+             << memory.MeshDataBytes / 1024 << "), GPU "
+             << memory.getGpuBytes() / 1024 << " KB (buffers "
+             << memory.BufferBytes / 1024 << ", textures "
+             << memory.TextureBytes / 1024 << "), released after upload "
+             << memory.ReleasedBytes / 1024 << " KB"
+             << std::endl;
+}
+
+unsigned int CModelRegistry::find(unsigned int markerId) const
+{
+   const size_t mask = mBuckets.size() - 1;
+   for (size_t i = getBucket(markerId); ; i = (i + 1) & mask)
+   {
+      const Bucket & bucket = mBuckets[i];
+      if (EMPTY == bucket.mSlot || markerId == bucket.mMarkerId)
+      {
+         return bucket.mSlot;
+      }
+   }
+}
+
+void CModelRegistry::insert(unsigned int markerId, unsigned int slot)
+{
+   const size_t mask = mBuckets.size() - 1;
+   size_t i = getBucket(markerId);
+   while (EMPTY != mBuckets[i].mSlot)
+   {
+      i = (i + 1) & mask;
+   }
+   mBuckets[i].mMarkerId = markerId;
+   mBuckets[i].mSlot = slot;
+}
+
+void CModelRegistry::rehash(size_t bucketCount)
+{
+   mBuckets.assign(bucketCount, Bucket());
+   for (size_t i = 0; i < mSlots.size(); ++i)
+   {
+      insert(mSlots[i].mMarkerId, (unsigned int)i);
+   }
+}
+
+size_t CModelRegistry::getBucket(unsigned int markerId) const
+{
+   // ids are often multiples of a step, mix all bits into the low ones
+   unsigned int hash = markerId;
+   hash ^= hash >> 16;
+   hash *= 0x85ebca6bu;
+   hash ^= hash >> 13;
+   hash *= 0xc2b2ae35u;
+   hash ^= hash >> 16;
+   return hash & (mBuckets.size() - 1);
+}
+
+void CModelRegistry::request(Slot & slot, int priority)
+{
+   if (false == slot.mRequested)
+   {
+      slot.mRequested = true;
+      slot.mPending = prepare(slot.mPath, priority);
+   }
+}
+
+void CModelRegistry::uploadSlot(Slot & slot)
+{
+   slot.mModel = upload(slot.mPending);
+   slot.mPending = std::shared_future<tModel>();
+   slot.mLastSeen = mFrame;
+
+   if (0 != slot.mModel)
+   {
+      const ModelMemory & memory = slot.mModel->getMemory();
+      mStats.CpuBytes += memory.getCpuBytes();
+      mStats.GpuBytes += getOwnGpuBytes(*slot.mModel);
+      ++mStats.Resident;
+   }
+
+   std::cout << slot.mMarkerId << "] " << ((0 != slot.mModel) ? "Success" : "Failure")
+             << " '" << slot.mPath << "' "
+             << mStats.Resident << " of " << mStats.Models << " resident, "
+             << getResidentBytes() / (1024 * 1024) << " MB"
+             << std::endl;
+   if (0 != slot.mModel)
+   {
+      printStats(*slot.mModel);
+   }
+}
+
+void CModelRegistry::evict()
+{
+   while (0 != mBudget && getResidentBytes() > mBudget)
+   {
+      // least recently seen model which wasn't seen in the last frame
+      Slot * oldest = 0;
+      for (size_t i = 0; i < mSlots.size(); ++i)
+      {
+         Slot & slot = mSlots[i];
+         if ( 0 != slot.mModel
+           && slot.mLastSeen + 1 < mFrame
+           && (0 == oldest || slot.mLastSeen < oldest->mLastSeen))
+         {
+            oldest = &slot;
+         }
+      }
+      if (0 == oldest)
+      {
+         return;
+      }
+
+      const ModelMemory & memory = oldest->mModel->getMemory();
+      mStats.CpuBytes -= memory.getCpuBytes();
+      mStats.GpuBytes -= getOwnGpuBytes(*oldest->mModel);
+      --mStats.Resident;
+      ++mStats.Evictions;
+
+      oldest->mModel.reset();
+      oldest->mRequested = false;
+   }
+}
+
+size_t CModelRegistry::getOwnGpuBytes(const CModel & model) const
+{
+   // shared textures are counted by the cache, once
+   const ModelMemory & memory = model.getMemory();
+   return (0 != mTextures) ? memory.BufferBytes : memory.getGpuBytes();
+}
+
+size_t CModelRegistry::getResidentBytes() const
+{
+   const size_t textureBytes = (0 != mTextures) ? mTextures->getStats().ResidentBytes : 0;
+   return mStats.CpuBytes + mStats.GpuBytes + textureBytes;
+}
+
+} /* namespace NApp */
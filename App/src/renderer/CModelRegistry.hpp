@@ -0,0 +1,163 @@
+#pragma once
+
+#include <future>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace NApp
+{
+
+class CModel;
+class CModelCache;
+class CTextureCache;
+class CThreadPool;
+
+/** Memory of models resident in registry. */
+struct RegistryStats
+{
+   RegistryStats()
+      : Models(0)
+      , Resident(0)
+      , CpuBytes(0)
+      , GpuBytes(0)
+      , Evictions(0)
+   {
+   }
+
+   unsigned int Models;    ///< registered marker ids
+   unsigned int Resident;  ///< uploaded models
+   size_t CpuBytes;        ///< of resident models
+   size_t GpuBytes;        ///< of resident models, shared textures are counted once
+   unsigned int Evictions; ///< since start
+};
+
+/**
+ * Models of markers by marker id. Ids may be sparse, they are mapped to
+ * slots by open addressing hash table. Models are prepared on loader
+ * workers and uploaded by update(). When memory of resident models
+ * exceeds budget, models which weren't seen for the longest time are
+ * released and loaded again on their next sighting. Models seen in the
+ * last frame are never released, so budget is exceeded if they don't fit.
+ * With texture cache, textures count in budget by resident bytes of cache,
+ * so texture of evicted model counts till its last user is released.
+ */
+class CModelRegistry
+{
+public:
+   typedef std::shared_ptr<CModel> tModel;
+
+   /** Preload priority of models which are loaded on sighting. */
+   static const int NO_PRELOAD;
+
+   /** Priority of sighted models, they are loaded before preloads. */
+   static const int SIGHTED_PRIORITY;
+
+public:
+   /**
+    * Constructor.
+    * @param loader workers preparing models
+    * @param cache cache of cooked models, may be 0
+    * @param textures textures shared by models, may be 0
+    * @param budget CPU and GPU bytes of resident models, 0 for no limit
+    */
+   CModelRegistry(
+      CThreadPool & loader,
+      const CModelCache * cache,
+      CTextureCache * textures,
+      size_t budget);
+
+   /**
+    * Register model of marker.
+    * @param priority preload priority, NO_PRELOAD for loading on sighting
+    * @return false if marker id is already registered
+    */
+   bool add(unsigned int markerId, const std::string & path, int priority);
+
+   /** Queue loading of models which have preload priority, or of all. */
+   void preload(bool all);
+
+   /** Upload all queued models, waits for their preparation. */
+   void uploadAll();
+
+   /**
+    * Get model of marker and mark it as seen in this frame. The first
+    * sighting queues loading of model.
+    * @return 0 if marker isn't registered, or model isn't uploaded or failed
+    */
+   CModel * get(unsigned int markerId);
+
+   /**
+    * Start frame: upload models prepared since the last frame and release
+    * models over budget.
+    * @param maxUploads limit of uploads, upload of model takes milliseconds
+    */
+   void update(unsigned int maxUploads);
+
+   /** Add shader variants of resident models. */
+   void getVariants(std::set<unsigned int> & variants) const;
+
+   RegistryStats getStats() const;
+
+   /** Queue CPU part of loading of model on workers. */
+   std::shared_future<tModel> prepare(const std::string & path, int priority);
+
+   /** Wait for prepared model and upload it, 0 on failure. */
+   static tModel upload(const std::shared_future<tModel> & prepared);
+
+   /** Print import statistics and memory of model. */
+   static void printStats(const CModel & model);
+
+private:
+   CModelRegistry(const CModelRegistry &);
+   CModelRegistry & operator=(const CModelRegistry &);
+
+   /** Model of marker id. */
+   struct Slot
+   {
+      Slot();
+
+      unsigned int mMarkerId;
+      std::string mPath;
+      int mPriority;                       ///< preload priority
+      bool mRequested;                     ///< loading was queued, model may have failed
+      unsigned int mLastSeen;              ///< frame of the last sighting or upload
+      tModel mModel;                       ///< 0 until uploaded and after eviction
+      std::shared_future<tModel> mPending; ///< valid while model is prepared
+   };
+
+   /** Entry of hash table, EMPTY slot if it's free. */
+   struct Bucket
+   {
+      Bucket();
+
+      unsigned int mMarkerId;
+      unsigned int mSlot;
+   };
+
+   static const unsigned int EMPTY;
+
+   unsigned int find(unsigned int markerId) const;
+   void insert(unsigned int markerId, unsigned int slot);
+   void rehash(size_t bucketCount);
+   size_t getBucket(unsigned int markerId) const;
+
+   void request(Slot & slot, int priority);
+   void uploadSlot(Slot & slot);
+   void evict();
+   size_t getOwnGpuBytes(const CModel & model) const;
+   size_t getResidentBytes() const;
+
+private:
+   CThreadPool & mLoader;
+   const CModelCache * mCache;
+   CTextureCache * mTextures;
+   size_t mBudget;
+   std::vector<Slot> mSlots;
+   std::vector<Bucket> mBuckets; ///< power of two, at most half used
+   unsigned int mFrame;          ///< counted by update()
+   RegistryStats mStats;
+};
+
+} /* namespace NApp */
@@ -0,0 +1,109 @@
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include "renderer/CProgramCache.hpp"
+#include "renderer/CUtils.hpp"
+
+namespace NApp
+{
+
+/** "GLPB", file of other format isn't loaded. */
+const unsigned int CProgramCache::MAGIC = 0x42504c47u;
+/** Incremented when layout of file changes. */
+const unsigned int CProgramCache::VERSION = 1u;
+
+static std::string getGLString(GLenum name)
+{
+   const GLubyte * str = glGetString(name);
+   return (0 != str) ? std::string((const char *)str) : std::string();
+}
+
+CProgramCache::CProgramCache(const std::string & directory)
+   : mDirectory(directory)
+   , mEnabled(false)
+{
+   if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)
+   {
+      GLint formats = 0;
+      glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+      mEnabled = (0 < formats) && (true == CUtils::createDirectory(mDirectory));
+   }
+
+   mDriver = getGLString(GL_VENDOR) + "\n"
+           + getGLString(GL_RENDERER) + "\n"
+           + getGLString(GL_VERSION);
+}
+
+bool CProgramCache::isEnabled() const
+{
+   return mEnabled;
+}
+
+std::string CProgramCache::getKey(const std::string & vertex, const std::string & fragment) const
+{
+   unsigned long long hash = CUtils::HASH_SEED;
+   CUtils::hashString(mDriver, hash);
+   CUtils::hashString(vertex, hash);
+   CUtils::hashString(fragment, hash);
+
+   std::ostringstream key;
+   key << std::hex << std::setw(16) << std::setfill('0') << hash;
+   return key.str();
+}
+
+bool CProgramCache::load(const std::string & key, GLenum & format, std::vector<GLubyte> & binary) const
+{
+   if (false == mEnabled)
+   {
+      return false;
+   }
+
+   std::ifstream file(getPath(key).c_str(), std::ios::in | std::ios::binary);
+   if (false == file.is_open())
+   {
+      return false;
+   }
+
+   unsigned int header[4] = { 0u, 0u, 0u, 0u }; // magic, version, format, size
+   file.read((char *)header, sizeof(header));
+   if ( false == file.good()
+     || MAGIC != header[0]
+     || VERSION != header[1]
+     || 0u == header[3])
+   {
+      return false;
+   }
+
+   format = (GLenum)header[2];
+   binary.resize(header[3]);
+   file.read((char *)binary.data(), binary.size());
+
+   return ((std::streamsize)binary.size() == file.gcount());
+}
+
+void CProgramCache::store(const std::string & key, GLenum format, const std::vector<GLubyte> & binary) const
+{
+   if (false == mEnabled || true == binary.empty())
+   {
+      return;
+   }
+
+   std::ofstream file(getPath(key).c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+   if (false == file.is_open())
+   {
+      std::cerr << "Can't write shader cache '" << getPath(key) << "'." << std::endl;
+      return;
+   }
+
+   const unsigned int header[4] = { MAGIC, VERSION, (unsigned int)format, (unsigned int)binary.size() };
+   file.write((const char *)header, sizeof(header));
+   file.write((const char *)binary.data(), binary.size());
+}
+
+std::string CProgramCache::getPath(const std::string & key) const
+{
+   return mDirectory + "/" + key + ".bin";
+}
+
+} /* namespace NApp */
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+
+namespace NApp
+{
+
+/**
+ * Disk cache of linked program binaries (GL_ARB_get_program_binary).
+ *
+ * Binary is stored under key made of hash of shader sources and of driver
+ * strings, so update of driver or shader makes new entry instead of
+ * loading stale one. Driver may still reject a binary, CShader then links
+ * program from sources and overwrites entry.
+ */
+class CProgramCache
+{
+public:
+   /**
+    * Constructor. Must be called with current GL context.
+    * @param directory directory of cache files, it's created if it's needed
+    */
+   explicit CProgramCache(const std::string & directory);
+
+   /** @return true if driver can save and load program binaries. */
+   bool isEnabled() const;
+
+   /** Get key of program linked from sources. */
+   std::string getKey(const std::string & vertex, const std::string & fragment) const;
+
+   /**
+    * Load binary of program.
+    * @return true if entry exists and is valid
+    */
+   bool load(const std::string & key, GLenum & format, std::vector<GLubyte> & binary) const;
+
+   /** Store binary of program. */
+   void store(const std::string & key, GLenum format, const std::vector<GLubyte> & binary) const;
+
+private:
+   std::string getPath(const std::string & key) const;
+
+private:
+   static const unsigned int MAGIC;
+   static const unsigned int VERSION;
+
+private:
+   std::string mDirectory;
+   std::string mDriver; ///< vendor, renderer and version of GL
+   bool mEnabled;
+};
+
+} /* namespace NApp */
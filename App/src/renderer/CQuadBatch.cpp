@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <cstddef>
+#include "renderer/CQuadBatch.hpp"
+#include "renderer/CShader.hpp"
+#include "renderer/ShaderData.hpp"
+
+namespace NApp
+{
+
+const size_t CQuadBatch::INITIAL_QUADS = 64u;
+
+static const UniformHandle<glm::vec4> UNIFORM_TRANSFORM("transform");
+static const UniformHandle<int> UNIFORM_TEXTURE("texture");
+
+CQuadBatch::CQuadBatch()
+   : mBuffer(0)
+   , mCapacity(0)
+{
+   setBackground(glm::vec2(1.f), glm::vec2(1.f));
+}
+
+CQuadBatch::~CQuadBatch()
+{
+   if (0 != mBuffer)
+   {
+      glDeleteBuffers(1, &mBuffer);
+   }
+}
+
+bool CQuadBatch::initialize()
+{
+   mShader = std::make_shared<CShader>(
+      QUAD_VERTEX_SOURCE,
+      QUAD_FRAGMENT_SOURCE);
+
+   glGenBuffers(1, &mBuffer);
+   reserve(QUAD_VERTICES * (1 + INITIAL_QUADS));
+
+   return (0 != mBuffer);
+}
+
+void CQuadBatch::setQuad(
+   Vertex * vertices,
+   const glm::vec2 & min,
+   const glm::vec2 & max,
+   const glm::vec2 & texMin,
+   const glm::vec2 & texMax,
+   const glm::vec4 & color) const
+{
+   // two triangles: (min, max.x/min.y, max) and (min, max, min.x/max.y)
+   const glm::vec2 positions[QUAD_VERTICES] = {
+      min, glm::vec2(max.x, min.y), max,
+      min, max, glm::vec2(min.x, max.y)
+   };
+   const glm::vec2 texCoords[QUAD_VERTICES] = {
+      texMin, glm::vec2(texMax.x, texMin.y), texMax,
+      texMin, texMax, glm::vec2(texMin.x, texMax.y)
+   };
+   const glm::vec4 bytes = glm::clamp(color, 0.f, 1.f) * 255.f + 0.5f;
+
+   for (GLsizei i = 0; i < QUAD_VERTICES; ++i)
+   {
+      vertices[i].position = positions[i];
+      vertices[i].texCoord = texCoords[i];
+      for (int k = 0; k < 4; ++k)
+      {
+         vertices[i].color[k] = (GLubyte)bytes[k];
+      }
+   }
+}
+
+void CQuadBatch::setBackground(const glm::vec2 & halfSize, const glm::vec2 & texScale)
+{
+   // clip space is y up, first image row is at the top
+   Vertex vertices[QUAD_VERTICES];
+   setQuad(vertices,
+      glm::vec2(-halfSize.x, halfSize.y), glm::vec2(halfSize.x, -halfSize.y),
+      glm::vec2(0.f), texScale,
+      glm::vec4(1.f));
+
+   bool changed = false;
+   for (GLsizei i = 0; i < QUAD_VERTICES; ++i)
+   {
+      changed = changed
+         || vertices[i].position != mBackground[i].position
+         || vertices[i].texCoord != mBackground[i].texCoord;
+      mBackground[i] = vertices[i];
+   }
+
+   if (true == changed && 0 != mBuffer)
+   {
+      glBindBuffer(GL_ARRAY_BUFFER, mBuffer);
+      glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(mBackground), mBackground);
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+   }
+}
+
+void CQuadBatch::reserve(size_t vertexCount)
+{
+   if (vertexCount <= mCapacity)
+   {
+      return;
+   }
+
+   mCapacity = std::max(vertexCount, 2 * mCapacity);
+
+   glBindBuffer(GL_ARRAY_BUFFER, mBuffer);
+   glBufferData(GL_ARRAY_BUFFER, mCapacity * sizeof(Vertex), 0, GL_DYNAMIC_DRAW);
+   glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(mBackground), mBackground);
+   glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void CQuadBatch::drawBackground(GLuint texture)
+{
+   mShader->bind();
+   mShader->setUniform(UNIFORM_TRANSFORM, glm::vec4(1.f, 1.f, 0.f, 0.f));
+   mShader->setUniform(UNIFORM_TEXTURE, 0);
+
+   bindAttributes();
+   draw(0, QUAD_VERTICES, texture);
+   unbindAttributes();
+
+   mShader->unbind();
+}
+
+void CQuadBatch::addQuad(
+   GLuint texture,
+   const glm::vec2 & position,
+   const glm::vec2 & size,
+   const glm::vec2 & texMin,
+   const glm::vec2 & texMax,
+   const glm::vec4 & color)
+{
+   const GLsizei first = (GLsizei)mVertices.size();
+   mVertices.resize(mVertices.size() + QUAD_VERTICES);
+   setQuad(&mVertices[first], position, position + size, texMin, texMax, color);
+
+   if (true == mBatches.empty() || texture != mBatches.back().texture)
+   {
+      Batch batch = { texture, first, 0 };
+      mBatches.push_back(batch);
+   }
+   mBatches.back().count += QUAD_VERTICES;
+}
+
+void CQuadBatch::flush(int width, int height)
+{
+   if (true == mVertices.empty())
+   {
+      return;
+   }
+
+   reserve(QUAD_VERTICES + mVertices.size());
+
+   // the only buffer update of the frame for overlays
+   glBindBuffer(GL_ARRAY_BUFFER, mBuffer);
+   glBufferSubData(GL_ARRAY_BUFFER,
+      sizeof(mBackground),
+      mVertices.size() * sizeof(Vertex),
+      &mVertices[0]);
+   glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+   glDisable(GL_DEPTH_TEST);
+   glDisable(GL_CULL_FACE);
+
+   // window pixels, y down
+   mShader->bind();
+   mShader->setUniform(UNIFORM_TRANSFORM, glm::vec4(2.f / width, -2.f / height, -1.f, 1.f));
+   mShader->setUniform(UNIFORM_TEXTURE, 0);
+
+   bindAttributes();
+   for (size_t i = 0; i < mBatches.size(); ++i)
+   {
+      draw(QUAD_VERTICES + mBatches[i].first, mBatches[i].count, mBatches[i].texture);
+   }
+   unbindAttributes();
+
+   mShader->unbind();
+
+   mVertices.clear();
+   mBatches.clear();
+}
+
+void CQuadBatch::draw(GLint first, GLsizei count, GLuint texture)
+{
+   glActiveTexture(GL_TEXTURE0);
+   glBindTexture(GL_TEXTURE_2D, texture);
+   glDrawArrays(GL_TRIANGLES, first, count);
+}
+
+void CQuadBatch::bindAttributes()
+{
+   glBindBuffer(GL_ARRAY_BUFFER, mBuffer);
+
+   glEnableVertexAttribArray(VertexAttribute::POSITION);
+   glEnableVertexAttribArray(VertexAttribute::TEX_COORD);
+   glEnableVertexAttribArray(VertexAttribute::COLOR);
+
+   glVertexAttribPointer(VertexAttribute::POSITION, 2, GL_FLOAT, GL_FALSE,
+      sizeof(Vertex), (const GLvoid *)offsetof(Vertex, position));
+   glVertexAttribPointer(VertexAttribute::TEX_COORD, 2, GL_FLOAT, GL_FALSE,
+      sizeof(Vertex), (const GLvoid *)offsetof(Vertex, texCoord));
+   glVertexAttribPointer(VertexAttribute::COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE,
+      sizeof(Vertex), (const GLvoid *)offsetof(Vertex, color));
+}
+
+void CQuadBatch::unbindAttributes()
+{
+   glDisableVertexAttribArray(VertexAttribute::POSITION);
+   glDisableVertexAttribArray(VertexAttribute::TEX_COORD);
+   glDisableVertexAttribArray(VertexAttribute::COLOR);
+
+   glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+} /* namespace NApp */
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+namespace NApp
+{
+
+class CShader;
+
+/**
+ * Renders textured 2D quads without immediate mode and matrix stack.
+ *
+ * All quads live in one persistent vertex buffer. The first quad is the
+ * fullscreen background, it's rewritten only when its geometry changes.
+ * Overlay quads (icons, text) are collected during the frame by addQuad()
+ * and flush() uploads all of them with one buffer update and draws them,
+ * one draw call per run of quads with the same texture.
+ */
+class CQuadBatch
+{
+public:
+   /** Constructor. */
+   CQuadBatch();
+
+   /** Destructor. */
+   ~CQuadBatch();
+
+   /**
+    * Create shader and vertex buffer.
+    * @return true if success, false - otherwise.
+    */
+   bool initialize();
+
+   /**
+    * Set geometry of background quad.
+    * @param halfSize half size of quad in clip space, quad is centered
+    * @param texScale texture coordinates of bottom right corner of image
+    */
+   void setBackground(const glm::vec2 & halfSize, const glm::vec2 & texScale);
+
+   /** Draw background quad with texture immediately. */
+   void drawBackground(GLuint texture);
+
+   /**
+    * Queue overlay quad.
+    * @param texture texture of quad
+    * @param position top left corner in window pixels
+    * @param size size in window pixels
+    * @param texMin texture coordinates of top left corner
+    * @param texMax texture coordinates of bottom right corner
+    * @param color multiplier of texture color
+    */
+   void addQuad(
+      GLuint texture,
+      const glm::vec2 & position,
+      const glm::vec2 & size,
+      const glm::vec2 & texMin = glm::vec2(0.f),
+      const glm::vec2 & texMax = glm::vec2(1.f),
+      const glm::vec4 & color = glm::vec4(1.f));
+
+   /**
+    * Draw all queued overlay quads over window of given size and clear queue.
+    */
+   void flush(int width, int height);
+
+private:
+   struct Vertex
+   {
+      glm::vec2 position;
+      glm::vec2 texCoord;
+      GLubyte color[4];
+   };
+
+   struct Batch
+   {
+      GLuint texture;
+      GLsizei first;
+      GLsizei count;
+   };
+
+   void setQuad(Vertex * vertices, const glm::vec2 & min, const glm::vec2 & max,
+      const glm::vec2 & texMin, const glm::vec2 & texMax, const glm::vec4 & color) const;
+   void reserve(size_t vertexCount);
+   void draw(GLint first, GLsizei count, GLuint texture);
+   void bindAttributes();
+   void unbindAttributes();
+
+private:
+   static const GLsizei QUAD_VERTICES = 6;
+   static const size_t INITIAL_QUADS;
+
+private:
+   std::shared_ptr<CShader> mShader;
+   GLuint mBuffer;
+   size_t mCapacity; ///< in vertices, including background
+
+   Vertex mBackground[QUAD_VERTICES];
+   std::vector<Vertex> mVertices;
+   std::vector<Batch> mBatches;
+};
+
+} /* namespace NApp */
@@ -1,17 +1,53 @@
+#include <sstream>
 #include "renderer/CRenderer.hpp"
 #include "renderer/CUtils.hpp"
 #include "renderer/CFpsCounter.hpp"
 #include "renderer/CShader.hpp"
+#include "renderer/CShaderLibrary.hpp"
+#include "renderer/CGLState.hpp"
+#include "renderer/CDrawQueue.hpp"
+#include "renderer/CModelCache.hpp"
+#include "renderer/CModelRegistry.hpp"
+#include "renderer/CTextureCache.hpp"
+#include "renderer/CProgramCache.hpp"
 #include "renderer/CCamera.hpp"
 #include "renderer/CLight.hpp"
 #include "renderer/CModel.hpp"
+#include "renderer/CGpuPreprocessor.hpp"
+#include "renderer/CStreamingTexture.hpp"
+#include "renderer/CQuadBatch.hpp"
+#include "renderer/CTextureAtlas.hpp"
+#include "renderer/CGlyphFont.hpp"
+#include "renderer/CImageCache.hpp"
 #include "renderer/ShaderData.hpp"
+#include "loader/CThreadPool.hpp"
 
 namespace NApp
 {
 
+/** GL_KHR_parallel_shader_compile, GLEW doesn't know it. */
+typedef void (GLAPIENTRY * tMaxShaderCompilerThreadsProc)(GLuint count);
+
 const std::string CRenderer::STANDART_MODEL_PATH = "data/model/dwarf.x"; 
 const std::string CRenderer::FONT_PATH = "data/ARIAL.TTF";
+const std::string CRenderer::SHADER_CACHE_PATH = "data/cache/shaders";
+const std::string CRenderer::MODEL_CACHE_PATH = "data/cache/models";
+/** Models are loaded on the first sighting of their marker, not at startup. */
+const bool CRenderer::LAZY_MODEL_LOADING = true;
+/** Separates marker id and path in line of models configuration. */
+const char CRenderer::MODEL_ID_SEPARATOR = '=';
+/** Separates path and preload priority in line of models configuration. */
+const char CRenderer::MODEL_PRIORITY_SEPARATOR = '|';
+/** Models which weren't seen for the longest time are released above it. */
+const size_t CRenderer::MODEL_MEMORY_BUDGET = 256u * 1024u * 1024u;
+/** Upload of model takes milliseconds, more of them per frame drop frames. */
+const unsigned int CRenderer::MAX_MODEL_UPLOADS = 1u;
+/** Detector needs only half resolution binary image for candidates search. */
+const unsigned int CRenderer::PREPROCESS_DOWNSCALE = 2u;
+/** Frame N + 1 is written while GL may still read frame N from the other buffer. */
+const unsigned int CRenderer::BACKGROUND_BUFFERS = 2u;
+/** Enough for printable ASCII of all font sizes. */
+const int CRenderer::ATLAS_SIZE = 1024;
 
 const std::string CRenderer::EXTENSIONS[] = {
    "GL_EXT_framebuffer_object",
@@ -25,10 +61,12 @@ const std::string CRenderer::EXTENSIONS[] = {
 CRenderer::CRenderer(
       int width, int height,
       const std::vector<std::string> & modelPaths)
-   : mModelPaths(modelPaths)
-   , mWidth(width)
+   : mWidth(width)
    , mHeight(height)
-   , mBGTexture(0)
+   , mBackground(new CStreamingTexture(BACKGROUND_BUFFERS))
+   , mUploadedFrame(0)
+   , mPreprocessing(false)
+   , mModelConfig(modelPaths)
    , mScale(1.f)
    , mRotation(0.f)
    , mTransition(0.f)
@@ -92,22 +130,9 @@ bool CRenderer::initialize()
 
 CModel & CRenderer::getModel(unsigned int markerId)
 {
-
-		if (markerId >= mModels.size())
-			return *mDefaultModel;
-		else
-			return *mModels[markerId];
-	/*
-   if ( markerId < mModels.size()    || 0 != mModels[markerId]	 )
-   {
-      return *mModels[markerId];
-	   
-   }
-     
-    assert(0 != mDefaultModel);
-    return *mDefaultModel;*/
-
-
+   // placeholder until registry uploads model, failed model stays so
+   CModel * model = mModels->get(markerId);
+   return (0 != model) ? *model : *mDefaultModel;
 }
 
 bool CRenderer::initGl()
@@ -129,6 +154,24 @@ bool CRenderer::initGl()
    glFrontFace(GL_CCW);
    glCullFace(GL_BACK);
 
+   // let driver compile shaders on all threads it has, it then works in
+   // background until status of program is queried
+   if ( true == CUtils::isExtensionSupported("GL_KHR_parallel_shader_compile")
+     || true == CUtils::isExtensionSupported("GL_ARB_parallel_shader_compile"))
+   {
+      tMaxShaderCompilerThreadsProc maxShaderCompilerThreads =
+         (tMaxShaderCompilerThreadsProc)SDL_GL_GetProcAddress("glMaxShaderCompilerThreadsKHR");
+      if (0 == maxShaderCompilerThreads)
+      {
+         maxShaderCompilerThreads =
+            (tMaxShaderCompilerThreadsProc)SDL_GL_GetProcAddress("glMaxShaderCompilerThreadsARB");
+      }
+      if (0 != maxShaderCompilerThreads)
+      {
+         maxShaderCompilerThreads(0xffffffffu);
+      }
+   }
+
    return CUtils::checkGLErrors();
 }
 
@@ -139,21 +182,47 @@ bool CRenderer::initFont()
       return false;
    }
 
-   mFonts[FontSize::SMALL]  = TTF_OpenFont(FONT_PATH.c_str(), (int)FontSize::SMALL);
-   mFonts[FontSize::MIDDLE] = TTF_OpenFont(FONT_PATH.c_str(), (int)FontSize::MIDDLE);
-   mFonts[FontSize::BIG]    = TTF_OpenFont(FONT_PATH.c_str(), (int)FontSize::BIG);
+   mAtlas = std::make_shared<CTextureAtlas>(ATLAS_SIZE, ATLAS_SIZE);
+   if (false == mAtlas->initialize())
+   {
+      return false;
+   }
+
+   mImages = std::make_shared<CImageCache>(*mAtlas);
+
+   const FontSize::ESize sizes[] = { FontSize::SMALL, FontSize::MIDDLE, FontSize::BIG };
+   for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+   {
+      std::shared_ptr<CGlyphFont> font = std::make_shared<CGlyphFont>();
+      if (false == font->create(FONT_PATH, (int)sizes[i], *mAtlas))
+      {
+         return false;
+      }
+      mFonts[sizes[i]] = font;
+   }
 
-   return
-        (0 != mFonts[FontSize::SMALL])
-     && (0 != mFonts[FontSize::MIDDLE])
-     && (0 != mFonts[FontSize::BIG]);
+   return true;
 }
 
 bool CRenderer::initScene()
 {
-   mShader = std::make_shared<CShader>(
-      SHADER_VERTEX_SOURCE,
-      SHADER_FRAGMENT_SOURCE);
+   mProgramCache = std::make_shared<CProgramCache>(SHADER_CACHE_PATH);
+   mModelCache = std::make_shared<CModelCache>(MODEL_CACHE_PATH);
+   mTextureCache = std::make_shared<CTextureCache>(mModelCache.get());
+   mLoader = std::make_shared<CThreadPool>();
+   mState = std::make_shared<CGLState>();
+   mQueue = std::make_shared<CDrawQueue>();
+   mShaders = std::make_shared<CShaderLibrary>(
+      *mState,
+      std::string(MODEL_UNIFORMS_SOURCE) + MODEL_VERTEX_SOURCE,
+      std::string(MODEL_UNIFORMS_SOURCE) + MODEL_FRAGMENT_SOURCE,
+      mProgramCache);
+
+   mQuads = std::make_shared<CQuadBatch>();
+   if (false == mQuads->initialize())
+   {
+      return false;
+   }
 
    mCamera = std::make_shared<CCamera>(
       0.01f,
@@ -181,50 +250,112 @@ void CRenderer::resize(int width, int height)
       (float)mWidth / mHeight);
 }
 
+void CRenderer::addModels()
+{
+   unsigned int markerId = 0;
+   for (size_t i = 0; i < mModelConfig.size(); ++i)
+   {
+      std::string path = mModelConfig[i];
+
+      // "id=path" sets marker id, line without it takes the next id,
+      // so positional configurations keep working and empty line skips id
+      const std::string::size_type idSeparator = path.find(MODEL_ID_SEPARATOR);
+      if (std::string::npos != idSeparator)
+      {
+         std::istringstream stream(path.substr(0, idSeparator));
+         if (!(stream >> markerId))
+         {
+            std::cerr << "Invalid marker id in '" << path << "'." << std::endl;
+            continue;
+         }
+         path.erase(0, idSeparator + 1);
+      }
+
+      // "path|priority" preloads model, higher priority is loaded sooner
+      int priority = CModelRegistry::NO_PRELOAD;
+      const std::string::size_type prioritySeparator = path.rfind(MODEL_PRIORITY_SEPARATOR);
+      if (std::string::npos != prioritySeparator)
+      {
+         std::istringstream stream(path.substr(prioritySeparator + 1));
+         if (!(stream >> priority))
+         {
+            priority = CModelRegistry::NO_PRELOAD;
+         }
+         path.erase(prioritySeparator);
+      }
+
+      if ( false == path.empty()
+        && false == mModels->add(markerId, path, priority))
+      {
+         std::cerr << "Marker " << markerId << " has more models, '" << path << "' is ignored." << std::endl;
+      }
+      ++markerId;
+   }
+}
+
 bool CRenderer::loadModels()
 {
-   float percent = 100.f / (mModelPaths.size()+1 );
+   const unsigned int loadTime = SDL_GetTicks();
 
-   for (size_t i = 0; i < mModelPaths.size(); ++i)
-   {
-      tModel model = CModel::load(mModelPaths[i]);
-      std::cout << i << "] " << ((0 != model) ? "Success" : "Failure")
-                << " '" << mModelPaths[i] << "' "
-                << percent * i << "%"
-                << std::endl;
+   mModels = std::make_shared<CModelRegistry>(
+      *mLoader,
+      mModelCache.get(),
+      mTextureCache.get(),
+      MODEL_MEMORY_BUDGET);
+   addModels();
+
+   // the default model is drawn in place of others, so it goes first
+   std::shared_future<tModel> preparedDefault = mModels->prepare(STANDART_MODEL_PATH, CModelRegistry::SIGHTED_PRIORITY);
 
-      mModels.push_back(model);
+   // models are read and decoded on workers, uploads here overlap with them
+   mModels->preload(false == LAZY_MODEL_LOADING);
+   if (false == LAZY_MODEL_LOADING)
+   {
+      mModels->uploadAll();
    }
 
-   mDefaultModel = CModel::load(STANDART_MODEL_PATH);
+   mDefaultModel = CModelRegistry::upload(preparedDefault);
    std::cout << "D] " << ((0 != mDefaultModel) ? "Success" : "Failure")
-             << " '" << STANDART_MODEL_PATH << "' "
-             << "100%"
+             << " '" << STANDART_MODEL_PATH << "'"
              << std::endl;
+   if (0 != mDefaultModel)
+   {
+      CModelRegistry::printStats(*mDefaultModel);
+   }
 
-   return (0 != mDefaultModel);
-}
+   const RegistryStats models = mModels->getStats();
+   std::cout << "Models: " << (models.Resident + 1) << " of " << (models.Models + 1) << " in "
+             << (SDL_GetTicks() - loadTime) << " ms, "
+             << mLoader->getThreadCount() << " threads"
+             << std::endl;
 
-void CRenderer::createBackground(
-   unsigned int width,
-   unsigned int height)
-{
-   // Create Texture
-   glGenTextures(1, &mBGTexture);
-   glBindTexture(GL_TEXTURE_2D, mBGTexture);
-
-   glTexImage2D(GL_TEXTURE_2D,
-      0,
-      GL_RGB,
-      width, height,
-      0,
-      GL_RGB, GL_UNSIGNED_BYTE,
-      0);
-
-   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-   glBindTexture(GL_TEXTURE_2D, 0);
+   const TextureCacheStats textures = mTextureCache->getStats();
+   std::cout << "Textures: " << textures.Uploads << " uploaded, "
+             << textures.Decodes << " decoded ("
+             << textures.Cooked << " cooked), "
+             << textures.Hits << " shared, "
+             << textures.ResidentBytes / 1024 << " KB"
+             << std::endl;
+
+   if (0 == mDefaultModel)
+   {
+      return false;
+   }
+
+   // build all used variants now instead of stalling the first frames,
+   // models loaded later build their variants on first use
+   std::set<unsigned int> variants;
+   mDefaultModel->getVariants(variants);
+   mModels->getVariants(variants);
+
+   const unsigned int startTime = SDL_GetTicks();
+   const unsigned int cached = mShaders->prepare(variants);
+   std::cout << "Shaders: " << variants.size() << " variants, "
+             << cached << " from cache, "
+             << (SDL_GetTicks() - startTime) << " ms"
+             << std::endl;
+
+   return true;
 }
 
 int CRenderer::getFps() const
@@ -236,6 +367,13 @@ int CRenderer::getFps() const
    return 0u;
 }
 
+void CRenderer::uploadFrame(const CFrame & frame)
+{
+   const cv::Mat & img = frame.getMat();
+   mBackground->update(img);
+   mUploadedFrame = img.data;
+}
+
 void CRenderer::render(
    unsigned int ellapsedTime,
    const CFrame & frame,
@@ -257,92 +395,85 @@ void CRenderer::render(
 void CRenderer::renderBackground(const CFrame & frame)
 {
    const cv::Mat & img = frame.getMat();
-   if (0 == mBGTexture)
+   if (img.data != mUploadedFrame)
    {
-      createBackground(img.cols, img.rows);
+      mBackground->update(img);
    }
+   mUploadedFrame = 0;
 
    glDisable(GL_DEPTH_TEST);
    glDisable(GL_CULL_FACE);
 
-   glMatrixMode(GL_MODELVIEW); glPushMatrix(); glLoadIdentity();
-
-   // change coordinate system according aspect ratio of window rect
-   // Update model-view matrix (inside glOrtho)
-   float wa = (float)mWidth / mHeight;
-   if (wa > 1.0) {
-     glOrtho(
-        -wa,    wa,
-        -1.0,  1.0,
-         1.0, -1.0);
-   } else {
-     glOrtho(
-        -1.0,  1.0,
-        -1.0 / wa, 1.0 / wa,
-         1.0, -1.0);
+   // keep aspect ratio of frame inside window rect,
+   // assume that aspect of frame always more then 1.0
+   const float wa = (float)mWidth / mHeight;
+   const float fa = (float)img.cols / img.rows;
+   const glm::vec2 halfSize = (wa > 1.f) ? glm::vec2(fa / wa, 1.f) : glm::vec2(fa, wa);
+   const glm::vec2 texScale = mBackground->getTexCoordScale();
+
+   mQuads->setBackground(halfSize, texScale);
+   mQuads->drawBackground(mBackground->getTexture());
+
+   if (true == mPreprocessing)
+   {
+      // frame is already in texture, so detector's preprocessing is almost free here
+      mPreprocessor->process(mBackground->getTexture(), img, texScale);
+      glViewport(0, 0, mWidth, mHeight);
    }
+}
 
-   glMatrixMode(GL_PROJECTION); glPushMatrix(); glLoadIdentity();
+bool CRenderer::enablePreprocessing(bool enable)
+{
+   if (true == enable && 0 == mPreprocessor)
+   {
+      std::shared_ptr<CGpuPreprocessor> preprocessor =
+         std::make_shared<CGpuPreprocessor>(PREPROCESS_DOWNSCALE);
+      if (false == preprocessor->initialize())
+      {
+         std::cerr << "GPU preprocessing isn't supported." << std::endl;
+         return false;
+      }
+      mPreprocessor = preprocessor;
+   }
 
-   glBindTexture(GL_TEXTURE_2D, mBGTexture);
-   glTexSubImage2D(
-      GL_TEXTURE_2D,
-      0,
-      0, 0, img.cols, img.rows,
-      GL_RGB, GL_UNSIGNED_BYTE,
-      img.data);
+   mPreprocessing = enable;
+   return true;
+}
 
-   float fa = (float)img.cols / img.rows;
-   // assume that aspect of frame always more then 1.0
-   glBegin(GL_QUADS);
-      glTexCoord2f(0.f, 1.f); glVertex3f(-fa, -1.f, 0.f);
-      glTexCoord2f(1.f, 1.f); glVertex3f( fa, -1.f, 0.f);
-      glTexCoord2f(1.f, 0.f); glVertex3f( fa, 1.f, 0.f);
-      glTexCoord2f(0.f, 0.f); glVertex3f(-fa, 1.f, 0.f);
-   glEnd();
-
-   glMatrixMode(GL_PROJECTION); glPopMatrix();
-   glMatrixMode(GL_MODELVIEW);  glPopMatrix();
+bool CRenderer::getPreprocessedFrame(cv::Mat & binary, cv::Mat & source)
+{
+   if (false == mPreprocessing)
+   {
+      return false;
+   }
+   return mPreprocessor->getResult(binary, source);
 }
 
-void CRenderer::renderSurface(
-   SDL_Surface * surface,
-   const glm::ivec2 & position)
+void CRenderer::finishFrame()
 {
-   GLuint texture;
-   glGenTextures(1, &texture);
-   glBindTexture(GL_TEXTURE_2D, texture);
-
-   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-   glTexImage2D(
-      GL_TEXTURE_2D,
-      0,
-      GL_RGBA,
-      surface->w, surface->h,
-      0,
-      GL_BGRA, GL_UNSIGNED_BYTE,
-      surface->pixels);
-
-   glMatrixMode(GL_MODELVIEW);  glPushMatrix(); glLoadIdentity();
-   gluOrtho2D(0, mWidth, mHeight, 0);
-
-   glMatrixMode(GL_PROJECTION); glPushMatrix(); glLoadIdentity();
+   mQuads->flush(mWidth, mHeight);
+   CUtils::checkGLErrors();
 
-   glDisable(GL_DEPTH_TEST);
-   glDisable(GL_CULL_FACE);
+   const ShaderStats shaderStats = CShader::getStats();
+   CShader::resetStats();
 
-   glBegin(GL_QUADS);
-      glTexCoord2f(0.f, 0.f); glVertex2f(position.x,              position.y);
-      glTexCoord2f(1.f, 0.f); glVertex2f(position.x + surface->w, position.y);
-      glTexCoord2f(1.f, 1.f); glVertex2f(position.x + surface->w, position.y + surface->h);
-      glTexCoord2f(0.f, 1.f); glVertex2f(position.x,              position.y + surface->h);
-   glEnd();
+   mStats.NameLookups = shaderStats.NameLookups;
+   mStats.LocationQueries = shaderStats.LocationQueries;
+   mStats.UniformBytes = mShaders->takeUploadedBytes();
 
-   glMatrixMode(GL_PROJECTION);   glPopMatrix();
-   glMatrixMode(GL_MODELVIEW);    glPopMatrix();
+   const GLStateStats stateStats = mState->takeStats();
+   mStats.DrawCalls = stateStats.DrawCalls;
+   mStats.StateChanges = stateStats.StateChanges;
+   mStats.SkippedStateChanges = stateStats.SkippedChanges;
 
-   glDeleteTextures(1, &texture);
+   const RegistryStats modelStats = mModels->getStats();
+   mStats.ResidentModels = modelStats.Resident;
+   mStats.ModelMemory = (unsigned int)((modelStats.CpuBytes + modelStats.GpuBytes) / 1024);
+}
+
+RenderStats CRenderer::getStats() const
+{
+   return mStats;
 }
 
 void CRenderer::renderText(
@@ -351,21 +482,25 @@ void CRenderer::renderText(
    const glm::ivec2 & position,
    const glm::ivec3 & color)
 {
-   TTF_Font * font = mFonts[size];
+   std::shared_ptr<CGlyphFont> font = mFonts[size];
    if (0 == font)
    {
       return;
    }
 
-   SDL_Color foreground = { color.r, color.g, color.b };
-   SDL_Surface * textSurface = TTF_RenderText_Blended(
-      font,
-      text.c_str(),
-      foreground);
-
-   renderSurface(textSurface, position);
-
-   SDL_FreeSurface(textSurface);
+   // all text shares atlas texture, so it's merged into one draw call
+   const glm::vec2 origin(position);
+   const glm::vec4 tint(glm::vec3(color) / 255.f, 1.f);
+   const CGlyphFont::tLayout & quads = font->layout(text);
+   for (size_t i = 0; i < quads.size(); ++i)
+   {
+      mQuads->addQuad(
+         mAtlas->getTexture(),
+         origin + quads[i].position,
+         quads[i].size,
+         quads[i].texMin, quads[i].texMax,
+         tint);
+   }
 }
 const std::string currentDateTime() {
 	time_t     now = time(0);
@@ -392,42 +527,59 @@ void CRenderer::screenshot()
 
 	delete[] pixels;
 }
+tImageHandle CRenderer::loadImage(const std::string & path)
+{
+   return mImages->load(path);
+}
+
 void CRenderer::renderIcon(
-   const IconData & icon,
+   tImageHandle image,
    const glm::ivec2 & position)
 {
-   SDL_Surface * textSurface = 0;
-
-   IplImage img = (IplImage)icon.img;
-   if (4 == img.nChannels)
-   {
-      textSurface = SDL_CreateRGBSurfaceFrom(
-         (void*)img.imageData,
-         img.width, img.height,
-         img.depth * img.nChannels,
-         img.widthStep,
-         0x0000ff00, 0x00ff0000, 0xff000000, 0x000000ff);
-   }
-   else
+   const CImageCache::Image * icon = mImages->get(image);
+   if (0 == icon)
    {
       return;
    }
 
-   renderSurface(textSurface, position);
+   mQuads->addQuad(
+      icon->texture,
+      glm::vec2(position),
+      icon->size,
+      icon->texMin, icon->texMax);
 }
 
 void CRenderer::renderModel(
    unsigned int ellapsedTime,
    const CMarkersData & markers)
 {
-   glEnable(GL_DEPTH_TEST);
-   glEnable(GL_CULL_FACE);
-
-   mShader->bind();
-
-   mShader->setUniform("lightPosition", mLight->getPosition());
-   mShader->setUniform("lightAmbientColor", mLight->getAmbient());
-   mShader->setUniform("lightDiffuseColor", mLight->getDiffuse());
+   mModels->update(MAX_MODEL_UPLOADS);
+
+   // background and preprocessing change state behind the tracker
+   mState->invalidate();
+   mState->setEnabled(GL_DEPTH_TEST, true);
+   mState->setEnabled(GL_CULL_FACE, true);
+
+   FrameConstants constants;
+   constants.Projection = mCamera->getProjectionMatrix();
+   constants.LightPosition = glm::vec4(mLight->getPosition(), 0.f);
+   constants.LightAmbient = mLight->getAmbient();
+   constants.LightDiffuse = mLight->getDiffuse();
+   mShaders->setFrameConstants(constants);
+
+   // models which weren't drawn may be released by registry
+   for (tInstances::iterator it = mInstances.begin(); it != mInstances.end(); )
+   {
+      if (true == it->second.empty())
+      {
+         mInstances.erase(it++);
+      }
+      else
+      {
+         it->second.clear();
+         ++it;
+      }
+   }
 
    for (size_t i = 0; i < markers.getMarkers().size(); ++i)
    {
@@ -436,21 +588,32 @@ void CRenderer::renderModel(
       //mCamera->setPosition(glm::vec3(0.f, 0.f, 2.f), glm::quat(0.f, 0.f, 0.f, 1.f));
       mCamera->setPosition(marker.T, marker.R);
 
-      //set shader uniforms
-      mShader->setUniform("projectionMatrix", mCamera->getProjectionMatrix());
-      //mShader->setUniform("viewMatrix", mCamera->getViewMatrix());
-      mShader->setUniform("viewMatrix", marker.View);
+      //mInstances[&getModel(marker.Id)].push_back(mCamera->getViewMatrix());
+      mInstances[&getModel(marker.Id)].push_back(marker.View);
+   }
 
-     CModel & model = getModel(marker.Id);
+   // markers of the same model are instances of one draw per mesh,
+   // draws of all models are sorted to share programs and textures
+   mShaders->clearInstances();
+   for (tInstances::iterator it = mInstances.begin(); it != mInstances.end(); ++it)
+   {
+      if (true == it->second.empty())
+      {
+         continue;
+      }
 
-     // transform model
-     model.scale(mScale);
-     model.rotate(mRotation);
-     model.translate(mTransition);
+      CModel & model = *it->first;
 
-     model.render(*mShader, ellapsedTime);
+      // transform model
+      model.scale(mScale);
+      model.rotate(mRotation);
+      model.translate(mTransition);
+
+      model.enqueue(*mQueue, *mShaders, mCamera->getProjectionMatrix(), it->second, ellapsedTime);
    }
-   mShader->unbind();
+
+   mShaders->uploadInstances();
+   mQueue->execute(*mShaders, *mState);
 }
 
 } /* namespace NApp */
@@ -11,11 +11,24 @@
 namespace NApp
 {
 
-class CShader;
+class CShaderLibrary;
+class CGLState;
+class CDrawQueue;
+class CModelCache;
+class CModelRegistry;
+class CTextureCache;
+class CThreadPool;
+class CProgramCache;
 class CModel;
 class CCamera;
 class CLight;
 class CFpsCounter;
+class CGpuPreprocessor;
+class CStreamingTexture;
+class CQuadBatch;
+class CTextureAtlas;
+class CGlyphFont;
+class CImageCache;
 
 /** Interface of renderer. */
 class CRenderer : public IRenderer
@@ -35,6 +48,9 @@ public:
    /** @copydoc IRenderer::getFps() */
    virtual int getFps() const;
 
+   /** @copydoc IRenderer::uploadFrame() */
+   virtual void uploadFrame(const CFrame & frame);
+
    /** @copydoc IRenderer::render() */
    virtual void render(
       unsigned int ellapsedTime,
@@ -48,11 +64,26 @@ public:
       const glm::ivec2 & position,
       const glm::ivec3 & color = glm::ivec3(255));
 
+   /** @copydoc IRenderer::loadImage() */
+   virtual tImageHandle loadImage(const std::string & path);
+
    /** @copydoc IRenderer::renderIcon() */
    virtual void renderIcon(
-      const IconData & icon,
+      tImageHandle image,
       const glm::ivec2 & position);
 
+   /** @copydoc IRenderer::getStats() */
+   virtual RenderStats getStats() const;
+
+   /** @copydoc IRenderer::enablePreprocessing() */
+   virtual bool enablePreprocessing(bool enable);
+
+   /** @copydoc IRenderer::getPreprocessedFrame() */
+   virtual bool getPreprocessedFrame(cv::Mat & binary, cv::Mat & source);
+
+   /** @copydoc IRenderer::finishFrame() */
+   virtual void finishFrame();
+
    /** @copydoc IRenderer::resize() */
    virtual void resize(int width, int height);
 
@@ -73,43 +104,72 @@ public:
 private:
    bool initScene();
    bool loadModels();
+   /** Register models of configuration lines "[id=]path[|priority]". */
+   void addModels();
    bool initGl();
    bool initFont();
 
-   void createBackground(
-      unsigned int width,
-      unsigned int height);
-
+   /**
+    * Get model of marker. In lazy mode the first sighting of marker queues
+    * loading of its model, default model is returned until it's uploaded
+    * and for markers which have no model.
+    */
    CModel & getModel(unsigned int markerId);
 
    void renderBackground(const CFrame & frame);
 
-   void renderSurface(SDL_Surface * surface, const glm::ivec2 & position);
-
    void renderModel(unsigned int ellapsedTime, const CMarkersData & markers);
 
 private:
    static const std::string EXTENSIONS[];
    static const std::string STANDART_MODEL_PATH;
    static const std::string FONT_PATH;
+   static const std::string SHADER_CACHE_PATH;
+   static const std::string MODEL_CACHE_PATH;
+   static const bool LAZY_MODEL_LOADING;
+   static const char MODEL_ID_SEPARATOR;
+   static const char MODEL_PRIORITY_SEPARATOR;
+   static const size_t MODEL_MEMORY_BUDGET;
+   static const unsigned int MAX_MODEL_UPLOADS;
+   static const unsigned int PREPROCESS_DOWNSCALE;
+   static const unsigned int BACKGROUND_BUFFERS;
+   static const int ATLAS_SIZE;
 
 private:
    typedef std::shared_ptr<CModel> tModel;
-   typedef std::vector<tModel> tModelList;
 
-   typedef std::map<FontSize::ESize, TTF_Font *> tFontsList;
+   typedef std::map<FontSize::ESize, std::shared_ptr<CGlyphFont> > tFontsList;
+   /**
+    * Views of markers grouped by model, vectors of models drawn in the
+    * last frame are kept to reuse memory.
+    */
+   typedef std::map<CModel *, std::vector<glm::mat4> > tInstances;
 private:
-   std::vector<std::string> mModelPaths;
    int mWidth;
    int mHeight;
-   unsigned int mBGTexture;
+   std::shared_ptr<CStreamingTexture> mBackground;
+   std::shared_ptr<CQuadBatch> mQuads;
+   std::shared_ptr<CTextureAtlas> mAtlas;
+   std::shared_ptr<CImageCache> mImages;
+   const void * mUploadedFrame; ///< data of frame which is already in mBackground
    std::shared_ptr<CFpsCounter> mFpsCounter;
-   std::shared_ptr<CShader> mShader;
+   std::shared_ptr<CProgramCache> mProgramCache;
+   std::shared_ptr<CModelCache> mModelCache;
+   std::shared_ptr<CTextureCache> mTextureCache; ///< textures shared by models
+   std::shared_ptr<CThreadPool> mLoader; ///< workers preparing models
+   std::shared_ptr<CGLState> mState;
+   std::shared_ptr<CDrawQueue> mQueue;
+   std::shared_ptr<CShaderLibrary> mShaders;
    std::shared_ptr<CCamera> mCamera;
    std::shared_ptr<CLight> mLight;
+   std::shared_ptr<CGpuPreprocessor> mPreprocessor;
+   bool mPreprocessing;
+   RenderStats mStats;
    tFontsList mFonts;
-   tModelList mModels;
+   std::vector<std::string> mModelConfig; ///< lines of models configuration
+   std::shared_ptr<CModelRegistry> mModels;
    tModel mDefaultModel;
+   tInstances mInstances;
 
    glm::vec3 mScale;
    glm::vec3 mRotation;
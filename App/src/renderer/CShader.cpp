@@ -1,77 +1,196 @@
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include "renderer/CShader.hpp"
+#include "renderer/CProgramCache.hpp"
 
 namespace NApp
 {
 
-CShader::CShader(const std::string & vertex, const std::string & fragment)
+/** Location table entry which isn't resolved yet. */
+static const GLint UNRESOLVED = -2;
+
+static ShaderStats gStats;
+
+static std::vector<std::string> & getRegisteredNames()
+{
+   // initialized on first use, handles may be static objects of other units
+   static std::vector<std::string> names;
+   return names;
+}
+
+ShaderName::ShaderName(const char * name)
+   : id(CShader::registerName(name))
+{
+}
+
+/** Names of attributes by location, 0 for locations of matrix columns. */
+static const char * ATTRIBUTE_NAMES[VertexAttribute::COUNT] = {
+   "inPosition",
+   "inNormal",
+   "inColor",
+   "inTexCoord",
+   "inBoneWeights",
+   "inBoneIndices",
+   "inViewMatrix", 0, 0, 0
+};
+
+CShader::CShader(const std::string & vertex, const std::string & fragment, const CProgramCache * cache)
+   : mVertexShader(0)
+   , mFragmentShader(0)
+   , mProgram(glCreateProgram())
+   , mCache(cache)
+   , mVertexSource(vertex)
+   , mFragmentSource(fragment)
+   , mCached(false)
+   , mFinished(false)
+{
+   if (0 != mCache && true == mCache->isEnabled())
+   {
+      mCacheKey = mCache->getKey(vertex, fragment);
+
+      GLenum format = 0;
+      std::vector<GLubyte> binary;
+      if (true == mCache->load(mCacheKey, format, binary))
+      {
+         glProgramBinary(mProgram, format, binary.data(), (GLsizei)binary.size());
+         mCached = true;
+         return;
+      }
+   }
+
+   compile();
+}
+
+CShader::~CShader()
+{
+   glDeleteProgram(mProgram);
+   glDeleteShader(mVertexShader);
+   glDeleteShader(mFragmentShader);
+}
+
+void CShader::compile()
 {
    mVertexShader = glCreateShader(GL_VERTEX_SHADER);
    mFragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
 
-   const char * vertexSrc = vertex.c_str();
-   const char * fragmentSrc = fragment.c_str();
+   const char * vertexSrc = mVertexSource.c_str();
+   const char * fragmentSrc = mFragmentSource.c_str();
    glShaderSource(mVertexShader, 1, (const GLchar **) &vertexSrc, 0);
    glShaderSource(mFragmentShader, 1, (const GLchar **) &fragmentSrc, 0);
    glCompileShader(mVertexShader);
    glCompileShader(mFragmentShader);
 
-   GLint compiled;
+   glAttachShader(mProgram, mVertexShader);
+   glAttachShader(mProgram, mFragmentShader);
 
-   glGetShaderiv(mVertexShader, GL_COMPILE_STATUS, &compiled);
-   if (GL_FALSE == compiled)
+   for (int i = 0; i < VertexAttribute::COUNT; ++i)
    {
-      GLint length = 0;
-      glGetShaderiv(mVertexShader, GL_INFO_LOG_LENGTH, &length);
-      if (length > 0)
+      if (0 != ATTRIBUTE_NAMES[i])
       {
-         std::unique_ptr<char[]> log(new char[length]);
-         glGetShaderInfoLog(mVertexShader, length, 0, log.get());
-         std::cerr << "Errors:\n" << log.get() << std::endl;
+         glBindAttribLocation(mProgram, i, ATTRIBUTE_NAMES[i]);
       }
-      std::cerr << "Vertex shader not compiled" << std::endl;
    }
 
-   glGetShaderiv(mFragmentShader, GL_COMPILE_STATUS, &compiled);
+   if (0 != mCache && true == mCache->isEnabled())
+   {
+      glProgramParameteri(mProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+   }
+
+   glLinkProgram(mProgram);
+}
+
+bool CShader::checkCompiled(GLuint shader, const char * type)
+{
+   GLint compiled;
+   glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
    if (GL_FALSE == compiled)
    {
       GLint length = 0;
-      glGetShaderiv(mFragmentShader, GL_INFO_LOG_LENGTH, &length);
-      if(length > 0)
+      glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+      if (length > 0)
       {
          std::unique_ptr<char[]> log(new char[length]);
-         glGetShaderInfoLog(mFragmentShader, length, 0, log.get());
+         glGetShaderInfoLog(shader, length, 0, log.get());
          std::cerr << "Errors:\n" << log.get() << std::endl;
       }
-      std::cerr << "Fragment shader not compiled" << std::endl;
+      std::cerr << type << " shader not compiled" << std::endl;
    }
+   return (GL_FALSE != compiled);
+}
 
-   mProgram = glCreateProgram();
-   glAttachShader(mProgram, mVertexShader);
-   glAttachShader(mProgram, mFragmentShader);
-
-   glLinkProgram(mProgram);
+void CShader::finish()
+{
+   if (true == mFinished)
+   {
+      return;
+   }
+   mFinished = true;
 
    GLint isLinked;
    glGetProgramiv(mProgram, GL_LINK_STATUS, &isLinked);
 
-   if (GL_FALSE == isLinked)
+   if (true == mCached && GL_FALSE == isLinked)
    {
-      std::cerr << "Shader not linked." << std::endl;
+      // driver rejects binaries of other driver versions or hardware
+      std::cerr << "Cached shader binary rejected, compiling shader." << std::endl;
+      mCached = false;
+      compile();
+      glGetProgramiv(mProgram, GL_LINK_STATUS, &isLinked);
+   }
+
+   if (false == mCached)
+   {
+      checkCompiled(mVertexShader, "Vertex");
+      checkCompiled(mFragmentShader, "Fragment");
+
+      if (GL_FALSE == isLinked)
+      {
+         std::cerr << "Shader not linked." << std::endl;
+      }
+      else
+      {
+         storeBinary();
+      }
    }
+
+   std::string().swap(mVertexSource);
+   std::string().swap(mFragmentSource);
+
+   introspect();
 }
 
-CShader::~CShader()
+bool CShader::isCached() const
 {
-   glDeleteProgram(mProgram);
-   glDeleteShader(mVertexShader);
-   glDeleteShader(mFragmentShader);
+   return mCached;
+}
+
+void CShader::storeBinary()
+{
+   if (0 == mCache || false == mCache->isEnabled())
+   {
+      return;
+   }
+
+   GLint length = 0;
+   glGetProgramiv(mProgram, GL_PROGRAM_BINARY_LENGTH, &length);
+   if (0 >= length)
+   {
+      return;
+   }
+
+   std::vector<GLubyte> binary(length);
+   GLenum format = 0;
+   glGetProgramBinary(mProgram, length, &length, &format, binary.data());
+   binary.resize(length);
+
+   mCache->store(mCacheKey, format, binary);
 }
 
 void CShader::bind()
 {
+   finish();
    glUseProgram(mProgram);
 }
 
@@ -80,14 +199,141 @@ void CShader::unbind()
    glUseProgram(0);
 }
 
+unsigned int CShader::registerName(const char * name)
+{
+   std::vector<std::string> & names = getRegisteredNames();
+   for (size_t i = 0; i < names.size(); ++i)
+   {
+      if (names[i] == name)
+      {
+         return (unsigned int)i;
+      }
+   }
+
+   names.push_back(name);
+   return (unsigned int)(names.size() - 1);
+}
+
+ShaderStats CShader::getStats()
+{
+   return gStats;
+}
+
+void CShader::resetStats()
+{
+   gStats = ShaderStats();
+}
+
+void CShader::introspect()
+{
+   GLint count = 0;
+   GLint maxLength = 0;
+   glGetProgramiv(mProgram, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+   glGetProgramiv(mProgram, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &count);
+   maxLength = std::max(maxLength, count) + 1;
+
+   std::vector<GLchar> buffer(maxLength);
+   GLint size = 0;
+   GLenum type = 0;
+
+   glGetProgramiv(mProgram, GL_ACTIVE_UNIFORMS, &count);
+   for (GLint i = 0; i < count; ++i)
+   {
+      glGetActiveUniform(mProgram, i, maxLength, 0, &size, &type, &buffer[0]);
+
+      // arrays are reported as "name[0]", they are set by plain name
+      std::string name(&buffer[0]);
+      const std::string::size_type bracket = name.find('[');
+      if (std::string::npos != bracket)
+      {
+         name.erase(bracket);
+      }
+
+      mUniforms[name] = glGetUniformLocation(mProgram, name.c_str());
+      ++gStats.LocationQueries;
+   }
+
+   glGetProgramiv(mProgram, GL_ACTIVE_ATTRIBUTES, &count);
+   for (GLint i = 0; i < count; ++i)
+   {
+      glGetActiveAttrib(mProgram, i, maxLength, 0, &size, &type, &buffer[0]);
+
+      mAttributes[&buffer[0]] = glGetAttribLocation(mProgram, &buffer[0]);
+      ++gStats.LocationQueries;
+   }
+}
+
+GLint CShader::findLocation(const std::string & name, const tLocations & locations) const
+{
+   ++gStats.NameLookups;
+
+   tLocations::const_iterator it = locations.find(name);
+   return (locations.end() != it) ? it->second : -1;
+}
+
+GLint CShader::resolve(const ShaderName & name, const tLocations & locations, std::vector<GLint> & table)
+{
+   if (name.id >= table.size())
+   {
+      table.resize(name.id + 1, UNRESOLVED);
+   }
+
+   GLint & location = table[name.id];
+   if (UNRESOLVED == location)
+   {
+      location = findLocation(getRegisteredNames()[name.id], locations);
+   }
+   return location;
+}
+
+GLint CShader::getLocation(const AttributeHandle & handle)
+{
+   return resolve(handle, mAttributes, mAttributeTable);
+}
+
+void CShader::setUniform(const UniformHandle<glm::mat4> & handle, const glm::mat4 & matrix)
+{
+   glUniformMatrix4fv(getLocation(handle), 1, GL_FALSE, glm::value_ptr(matrix));
+}
+
+void CShader::setUniform(const UniformHandle<glm::mat4> & handle, const std::vector<glm::mat4> & matrices)
+{
+   glUniformMatrix4fv(getLocation(handle), matrices.size(), GL_FALSE, (const GLfloat *)matrices.data());
+}
+
+void CShader::setUniform(const UniformHandle<glm::vec2> & handle, const glm::vec2 & vector)
+{
+   glUniform2fv(getLocation(handle), 1, glm::value_ptr(vector));
+}
+
+void CShader::setUniform(const UniformHandle<glm::vec3> & handle, const glm::vec3 & vector)
+{
+   glUniform3fv(getLocation(handle), 1, glm::value_ptr(vector));
+}
+
+void CShader::setUniform(const UniformHandle<glm::vec4> & handle, const glm::vec4 & vector)
+{
+   glUniform4fv(getLocation(handle), 1, glm::value_ptr(vector));
+}
+
+void CShader::setUniform(const UniformHandle<int> & handle, int value)
+{
+   glUniform1i(getLocation(handle), value);
+}
+
+void CShader::setUniform(const UniformHandle<float> & handle, float value)
+{
+   glUniform1f(getLocation(handle), value);
+}
+
 GLuint CShader::getAttribLocation(const std::string & name)
 {
-   return glGetAttribLocation(mProgram, name.c_str());
+   return findLocation(name, mAttributes);
 }
 
 GLuint CShader::getUniformLocation(const std::string & name)
 {
-   return glGetUniformLocation(mProgram, name.c_str());
+   return findLocation(name, mUniforms);
 }
 
 void CShader::setUniform(const std::string & name, const glm::mat4 & matrix)
@@ -100,6 +346,11 @@ void CShader::setUniform(const std::string & name, const std::vector<glm::mat4>
    glUniformMatrix4fv(getUniformLocation(name), matriсes.size(), GL_FALSE, (const GLfloat *)matriсes.data());
 }
 
+void CShader::setUniform(const std::string & name, const glm::vec2 & vector)
+{
+   glUniform2fv(getUniformLocation(name), 1, glm::value_ptr(vector));
+}
+
 void CShader::setUniform(const std::string & name, const glm::vec3 & vector)
 {
    glUniform3fv(getUniformLocation(name), 1, glm::value_ptr(vector));
@@ -115,6 +366,11 @@ void CShader::setUniform(const std::string & name, int value)
    glUniform1i(getUniformLocation(name), value);
 }
 
+void CShader::setUniform(const std::string & name, float value)
+{
+   glUniform1f(getUniformLocation(name), value);
+}
+
 void CShader::enableAttributeArray(const std::string & name)
 {
    glEnableVertexAttribArray(getAttribLocation(name));
@@ -2,39 +2,170 @@
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
+#include <map>
 #include <string>
 #include <vector>
 
 namespace NApp
 {
 
+class CProgramCache;
+
+/**
+ * Fixed locations of vertex attributes. They are bound before linking of
+ * every program, so vertex array objects recorded once fit all shaders.
+ */
+struct VertexAttribute
+{
+   enum ELocation
+   {
+      POSITION = 0,  ///< inPosition
+      NORMAL,        ///< inNormal
+      COLOR,         ///< inColor
+      TEX_COORD,     ///< inTexCoord
+      BONE_WEIGHTS,  ///< inBoneWeights
+      BONE_INDICES,  ///< inBoneIndices
+      VIEW_MATRIX,   ///< inViewMatrix, per instance, takes 4 locations (columns)
+      COUNT = VIEW_MATRIX + 4
+   };
+};
+
+/**
+ * Name of uniform or attribute registered once and shared by all programs.
+ * Each program resolves it to location on first use and keeps it in a table
+ * indexed by id, so setting by handle doesn't touch strings.
+ */
+struct ShaderName
+{
+   explicit ShaderName(const char * name);
+
+   unsigned int id;
+};
+
+/** Handle of uniform of type T (int is used for samplers). */
+template <typename T>
+struct UniformHandle : public ShaderName
+{
+   explicit UniformHandle(const char * name)
+      : ShaderName(name)
+   {
+   }
+};
+
+/** Handle of vertex attribute. */
+struct AttributeHandle : public ShaderName
+{
+   explicit AttributeHandle(const char * name)
+      : ShaderName(name)
+   {
+   }
+};
+
+/** Counters of location lookups of all programs since the last reset. */
+struct ShaderStats
+{
+   ShaderStats()
+      : NameLookups(0)
+      , LocationQueries(0)
+   {
+   }
+
+   unsigned int NameLookups;     ///< searches of location by name string
+   unsigned int LocationQueries; ///< glGetUniformLocation/glGetAttribLocation calls
+};
+
 class CShader
 {
 public:
-   CShader(const std::string & vertex, const std::string & fragment);
+   /**
+    * Start building of program: load it from cache or compile and link it.
+    * Status isn't queried here, so with KHR_parallel_shader_compile driver
+    * builds several programs concurrently until finish() of each.
+    * @param cache cache of program binaries, may be 0
+    */
+   CShader(const std::string & vertex, const std::string & fragment, const CProgramCache * cache = 0);
    ~CShader();
 
+   /** Wait for program, report errors and read its locations. Called by bind(). */
+   void finish();
+
+   /** @return true if program was loaded from cache. */
+   bool isCached() const;
+
    void bind();
    void unbind();
 
+   /** @{ Locations of handles, -1 if program has no such name. */
+   GLint getLocation(const AttributeHandle & handle);
+   template <typename T>
+   GLint getLocation(const UniformHandle<T> & handle);
+   /** @} */
+
+   void setUniform(const UniformHandle<glm::mat4> & handle, const glm::mat4 & matrix);
+   void setUniform(const UniformHandle<glm::mat4> & handle, const std::vector<glm::mat4> & matrices);
+   void setUniform(const UniformHandle<glm::vec2> & handle, const glm::vec2 & vector);
+   void setUniform(const UniformHandle<glm::vec3> & handle, const glm::vec3 & vector);
+   void setUniform(const UniformHandle<glm::vec4> & handle, const glm::vec4 & vector);
+   void setUniform(const UniformHandle<int> & handle, int value);
+   void setUniform(const UniformHandle<float> & handle, float value);
+
+   /** @{ String based API, locations come from table built at link time. */
    GLuint getAttribLocation(const std::string & name);
    GLuint getUniformLocation(const std::string & name);
 
    void setUniform(const std::string & name, const glm::mat4 & matrix);
    void setUniform(const std::string & name, const std::vector<glm::mat4> & matrices);
+   void setUniform(const std::string & name, const glm::vec2 & vector);
    void setUniform(const std::string & name, const glm::vec3 & vector);
    void setUniform(const std::string & name, const glm::vec4 & vector);
    void setUniform(const std::string & name, int value);
+   void setUniform(const std::string & name, float value);
 
    void enableAttributeArray(const std::string & name);
    void disableAttributeArray(const std::string & name);
 
    void setAttributeArray(const std::string & name, const float * values, unsigned int tupleSize);
+   /** @} */
+
+   static ShaderStats getStats();
+   static void resetStats();
+
+   static unsigned int registerName(const char * name);
 
 /*private:*/
    GLuint mVertexShader;
    GLuint mFragmentShader;
    GLuint mProgram;
+
+private:
+   typedef std::map<std::string, GLint> tLocations;
+
+   void compile();
+   bool checkCompiled(GLuint shader, const char * type);
+   void storeBinary();
+   void introspect();
+   GLint resolve(const ShaderName & name, const tLocations & locations, std::vector<GLint> & table);
+   GLint findLocation(const std::string & name, const tLocations & locations) const;
+
+private:
+   const CProgramCache * mCache;
+   std::string mCacheKey;
+   std::string mVertexSource;    ///< kept until finish() for fallback from binary
+   std::string mFragmentSource;
+   bool mCached;
+   bool mFinished;
+
+   tLocations mUniforms;   ///< active uniforms of program
+   tLocations mAttributes; ///< active attributes of program
+   std::vector<GLint> mUniformTable;    ///< by ShaderName::id
+   std::vector<GLint> mAttributeTable;  ///< by ShaderName::id
 };
 
+template <typename T>
+inline
+GLint CShader::getLocation(const UniformHandle<T> & handle)
+{
+   return resolve(handle, mUniforms, mUniformTable);
+}
+
 } /* namespace NApp */
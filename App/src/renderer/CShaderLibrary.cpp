@@ -0,0 +1,309 @@
+#include "renderer/CShaderLibrary.hpp"
+#include "renderer/CShader.hpp"
+#include "renderer/CProgramCache.hpp"
+#include "renderer/CUniformStream.hpp"
+#include "renderer/CGLState.hpp"
+
+namespace NApp
+{
+
+/** Bone palettes of all skinned meshes of a few frames. */
+const GLsizeiptr CShaderLibrary::STREAM_SIZE = 256 * 1024;
+
+/** Names of uniform blocks in order of UniformBlock::EBinding. */
+static const char * BLOCK_NAMES[UniformBlock::COUNT] = {
+   "FrameConstants",
+   "BonePalette"
+};
+
+static const UniformHandle<glm::mat4> UNIFORM_PROJECTION_MATRIX("projectionMatrix");
+static const UniformHandle<glm::mat4> UNIFORM_BONE_MATRICES("boneMatrices");
+static const UniformHandle<glm::vec3> UNIFORM_LIGHT_POSITION("lightPosition");
+static const UniformHandle<glm::vec4> UNIFORM_LIGHT_AMBIENT_COLOR("lightAmbientColor");
+static const UniformHandle<glm::vec4> UNIFORM_LIGHT_DIFFUSE_COLOR("lightDiffuseColor");
+static const UniformHandle<int> UNIFORM_TEXTURE("texture");
+
+CShaderLibrary::Program::Program()
+   : frameRevision(0)
+   , ready(false)
+{
+}
+
+CShaderLibrary::CShaderLibrary(
+      CGLState & state,
+      const std::string & vertex,
+      const std::string & fragment,
+      const std::shared_ptr<CProgramCache> & cache)
+   : mVertexSource(vertex)
+   , mFragmentSource(fragment)
+   , mCache(cache)
+   , mStream(new CUniformStream(STREAM_SIZE))
+   , mState(state)
+   , mFrameRevision(1)
+   , mInstancing(GLEW_VERSION_3_3 ? true : false)
+   , mInstanceBuffer(0)
+   , mInstanceCapacity(0)
+   , mUploadedBytes(0)
+{
+   if (false == mStream->initialize())
+   {
+      mStream.reset();
+   }
+
+   if (true == mInstancing)
+   {
+      glGenBuffers(1, &mInstanceBuffer);
+   }
+}
+
+CShaderLibrary::~CShaderLibrary()
+{
+   if (0 != mInstanceBuffer)
+   {
+      glDeleteBuffers(1, &mInstanceBuffer);
+   }
+}
+
+unsigned int CShaderLibrary::prepare(const std::set<unsigned int> & variants)
+{
+   for (std::set<unsigned int>::const_iterator it = variants.begin(); it != variants.end(); ++it)
+   {
+      start(*it);
+   }
+
+   unsigned int cached = 0;
+   for (std::set<unsigned int>::const_iterator it = variants.begin(); it != variants.end(); ++it)
+   {
+      Program & program = mPrograms[*it];
+      complete(program);
+      cached += (true == program.shader->isCached()) ? 1 : 0;
+   }
+
+   unbind();
+   return cached;
+}
+
+void CShaderLibrary::setFrameConstants(const FrameConstants & constants)
+{
+   if (0 != mStream)
+   {
+      mStream->beginFrame(UniformBlock::FRAME_CONSTANTS, &constants, sizeof(constants));
+      return;
+   }
+
+   // programs take them when they are bound
+   mFrameConstants = constants;
+   ++mFrameRevision;
+}
+
+unsigned int CShaderLibrary::addInstances(const std::vector<glm::mat4> & views)
+{
+   const unsigned int first = (unsigned int)mInstances.size();
+   mInstances.insert(mInstances.end(), views.begin(), views.end());
+   return first;
+}
+
+void CShaderLibrary::uploadInstances()
+{
+   if (false == mInstancing || true == mInstances.empty())
+   {
+      return;
+   }
+
+   const GLsizeiptr size = mInstances.size() * sizeof(glm::mat4);
+   glBindBuffer(GL_ARRAY_BUFFER, mInstanceBuffer);
+   if (size > mInstanceCapacity)
+   {
+      mInstanceCapacity = size;
+   }
+   // orphan storage which previous draws may still read
+   glBufferData(GL_ARRAY_BUFFER, mInstanceCapacity, 0, GL_STREAM_DRAW);
+   glBufferSubData(GL_ARRAY_BUFFER, 0, size, mInstances.data());
+   glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+   mUploadedBytes += (unsigned int)size;
+}
+
+void CShaderLibrary::clearInstances()
+{
+   mInstances.clear();
+}
+
+unsigned int CShaderLibrary::drawElements(
+   GLenum indexType,
+   GLsizei indexCount,
+   GLsizei firstIndex,
+   unsigned int firstInstance,
+   unsigned int instanceCount)
+{
+   const GLsizei indexSize = (GL_UNSIGNED_SHORT == indexType) ? sizeof(GLushort) : sizeof(GLuint);
+   const GLvoid * indices = (const GLvoid *)(GLintptr)(firstIndex * indexSize);
+
+   if (0 == instanceCount)
+   {
+      return 0;
+   }
+
+   if (true == mInstancing)
+   {
+      bindInstanceArrays(firstInstance);
+      glDrawElementsInstanced(GL_TRIANGLES, indexCount, indexType, indices, (GLsizei)instanceCount);
+      return 1;
+   }
+
+   // view is a constant attribute of each draw
+   for (int column = 0; column < 4; ++column)
+   {
+      glDisableVertexAttribArray(VertexAttribute::VIEW_MATRIX + column);
+   }
+   for (unsigned int i = firstInstance; i < firstInstance + instanceCount; ++i)
+   {
+      for (int column = 0; column < 4; ++column)
+      {
+         glVertexAttrib4fv(VertexAttribute::VIEW_MATRIX + column, &mInstances[i][column][0]);
+      }
+      glDrawElements(GL_TRIANGLES, indexCount, indexType, indices);
+   }
+   return instanceCount;
+}
+
+void CShaderLibrary::bindInstanceArrays(unsigned int firstInstance)
+{
+   const GLintptr offset = firstInstance * sizeof(glm::mat4);
+
+   glBindBuffer(GL_ARRAY_BUFFER, mInstanceBuffer);
+   for (int column = 0; column < 4; ++column)
+   {
+      const GLuint location = VertexAttribute::VIEW_MATRIX + column;
+      glEnableVertexAttribArray(location);
+      glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE,
+         sizeof(glm::mat4), (const GLvoid *)(offset + column * sizeof(glm::vec4)));
+      glVertexAttribDivisor(location, 1);
+   }
+   glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void CShaderLibrary::setBones(CShader & shader, const glm::mat4 * matrices, unsigned int count)
+{
+   const GLsizeiptr size = count * sizeof(glm::mat4);
+
+   if (0 != mStream)
+   {
+      mStream->write(UniformBlock::BONE_PALETTE, matrices, size, MAX_BONES * sizeof(glm::mat4));
+   }
+   else
+   {
+      glUniformMatrix4fv(shader.getLocation(UNIFORM_BONE_MATRICES), count, GL_FALSE, (const GLfloat *)matrices);
+      mUploadedBytes += (unsigned int)size;
+   }
+}
+
+CShader & CShaderLibrary::bind(unsigned int variant)
+{
+   Program & program = mPrograms[variant];
+
+   start(variant);
+   complete(program);
+
+   mState.useProgram(program.shader->mProgram);
+   uploadConstants(program);
+
+   return *program.shader;
+}
+
+void CShaderLibrary::unbind()
+{
+   mState.useProgram(0);
+}
+
+unsigned int CShaderLibrary::takeUploadedBytes()
+{
+   unsigned int bytes = mUploadedBytes;
+   mUploadedBytes = 0;
+
+   if (0 != mStream)
+   {
+      bytes += (unsigned int)mStream->takeWrittenBytes();
+   }
+   return bytes;
+}
+
+void CShaderLibrary::start(unsigned int variant)
+{
+   Program & program = mPrograms[variant];
+   if (0 == program.shader)
+   {
+      const std::string header = getHeader(variant);
+      program.shader = std::make_shared<CShader>(
+         header + mVertexSource,
+         header + mFragmentSource,
+         mCache.get());
+   }
+}
+
+void CShaderLibrary::complete(Program & program)
+{
+   if (true == program.ready)
+   {
+      return;
+   }
+
+   // sampler always reads unit 0
+   program.shader->finish();
+   mState.useProgram(program.shader->mProgram);
+   program.shader->setUniform(UNIFORM_TEXTURE, 0);
+   program.ready = true;
+
+   if (0 != mStream)
+   {
+      const GLuint id = program.shader->mProgram;
+      for (int i = 0; i < UniformBlock::COUNT; ++i)
+      {
+         const GLuint index = glGetUniformBlockIndex(id, BLOCK_NAMES[i]);
+         if (GL_INVALID_INDEX != index)
+         {
+            glUniformBlockBinding(id, index, i);
+         }
+      }
+   }
+}
+
+std::string CShaderLibrary::getHeader(unsigned int variant) const
+{
+   std::string header = "#version 120\n";
+   if (0 != mStream)
+   {
+      header += "#extension GL_ARB_uniform_buffer_object : require\n"
+                "#define UNIFORM_BUFFERS\n";
+   }
+   if (0 != (variant & ShaderVariant::TEXTURED))
+   {
+      header += "#define TEXTURED\n";
+   }
+   if (0 != (variant & ShaderVariant::SKINNED))
+   {
+      header += "#define SKINNED\n";
+   }
+   if (0 != (variant & ShaderVariant::LIT))
+   {
+      header += "#define LIT\n";
+   }
+   return header + "\n";
+}
+
+void CShaderLibrary::uploadConstants(Program & program)
+{
+   CShader & shader = *program.shader;
+
+   if (0 == mStream && mFrameRevision != program.frameRevision)
+   {
+      shader.setUniform(UNIFORM_PROJECTION_MATRIX, mFrameConstants.Projection);
+      shader.setUniform(UNIFORM_LIGHT_POSITION, glm::vec3(mFrameConstants.LightPosition));
+      shader.setUniform(UNIFORM_LIGHT_AMBIENT_COLOR, mFrameConstants.LightAmbient);
+      shader.setUniform(UNIFORM_LIGHT_DIFFUSE_COLOR, mFrameConstants.LightDiffuse);
+      program.frameRevision = mFrameRevision;
+      mUploadedBytes += sizeof(mFrameConstants);
+   }
+}
+
+} /* namespace NApp */
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace NApp
+{
+
+class CShader;
+class CProgramCache;
+class CUniformStream;
+class CGLState;
+
+/** Features of model shader variant, combined as bit flags. */
+struct ShaderVariant
+{
+   enum EFlags
+   {
+      NONE     = 0,
+      TEXTURED = 1 << 0, ///< color from diffuse texture instead of material color
+      SKINNED  = 1 << 1, ///< vertices are blended by bone matrices
+      LIT      = 1 << 2, ///< ambient and diffuse lighting
+      COUNT    = 1 << 3  ///< number of variants
+   };
+};
+
+/** Binding points of uniform blocks of model shader. */
+struct UniformBlock
+{
+   enum EBinding
+   {
+      FRAME_CONSTANTS = 0, ///< FrameConstants
+      BONE_PALETTE,        ///< BonePalette
+      COUNT
+   };
+};
+
+/** Constants of frame, layout is the std140 layout of block FrameConstants. */
+struct FrameConstants
+{
+   glm::mat4 Projection;
+   glm::vec4 LightPosition; ///< w isn't used
+   glm::vec4 LightAmbient;
+   glm::vec4 LightDiffuse;
+};
+
+/**
+ * Variants of model shader built from one source with preprocessor defines.
+ *
+ * Variants known in advance are built together by prepare(), others are
+ * built on first use. Programs are kept for the lifetime of library.
+ *
+ * Model is drawn on all its markers at once: view matrices are per instance
+ * attributes, with GL 3.3 they come from instance buffer and one instanced
+ * draw renders all instances. Otherwise each instance is a separate draw.
+ * Instances of all models of frame share the buffer.
+ *
+ * Programs are bound through CGLState, so binding of the bound one is free.
+ *
+ * Frame constants and bone palettes are written to uniform buffers once
+ * and shared by all variants (UNIFORM_BUFFERS is defined for shaders).
+ * Without uniform buffers they are uploaded as plain uniforms to program
+ * when it's bound, only if they were changed since the last upload to it.
+ */
+class CShaderLibrary
+{
+public:
+   /** Size of bone palette of shader. */
+   static const unsigned int MAX_BONES = 60u;
+
+public:
+   /**
+    * Constructor. Must be called with current GL context.
+    * @param state tracked GL state
+    * @param vertex source of vertex shader without #version line
+    * @param fragment source of fragment shader without #version line
+    * @param cache cache of program binaries, may be empty
+    */
+   CShaderLibrary(
+      CGLState & state,
+      const std::string & vertex,
+      const std::string & fragment,
+      const std::shared_ptr<CProgramCache> & cache = std::shared_ptr<CProgramCache>());
+
+   /** Destructor. */
+   ~CShaderLibrary();
+
+   /**
+    * Build programs of variants: all of them are started before waiting
+    * for any, so driver with parallel compilation builds them concurrently.
+    * @param variants combinations of ShaderVariant::EFlags
+    * @return number of programs loaded from cache
+    */
+   unsigned int prepare(const std::set<unsigned int> & variants);
+
+   /** Set constants of frame, called at start of frame before draws. */
+   void setFrameConstants(const FrameConstants & constants);
+
+   /**
+    * Add view matrices of instances of frame.
+    * @return index of the first added instance
+    */
+   unsigned int addInstances(const std::vector<glm::mat4> & views);
+
+   /** Upload instances added since clearInstances(), before the first draw. */
+   void uploadInstances();
+
+   /** Remove all instances. */
+   void clearInstances();
+
+   /**
+    * Set bone palette of following draw.
+    * @param shader bound program
+    * @param matrices used bones only
+    * @param count number of matrices, at most MAX_BONES
+    */
+   void setBones(CShader & shader, const glm::mat4 * matrices, unsigned int count);
+
+   /**
+    * Bind program of variant, compile it if it's needed.
+    * @param variant combination of ShaderVariant::EFlags
+    * @return bound program for per draw uniforms
+    */
+   CShader & bind(unsigned int variant);
+
+   /** Unbind current program. */
+   void unbind();
+
+   /**
+    * Draw bound mesh on instances.
+    * @param indexType GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    * @param indexCount number of indices of bound element buffer
+    * @param firstIndex index of the first of them
+    * @param firstInstance index of the first instance
+    * @param instanceCount number of instances
+    * @return number of draw calls
+    */
+   unsigned int drawElements(
+      GLenum indexType,
+      GLsizei indexCount,
+      GLsizei firstIndex,
+      unsigned int firstInstance,
+      unsigned int instanceCount);
+
+   /** Get number of bytes of constants, bones and instances uploaded since the last call. */
+   unsigned int takeUploadedBytes();
+
+private:
+   struct Program
+   {
+      Program();
+
+      std::shared_ptr<CShader> shader;
+      unsigned int frameRevision; ///< revision of frame constants uploaded to shader
+      bool ready;                 ///< shader is finished and its sampler is set
+   };
+
+   std::string getHeader(unsigned int variant) const;
+   void start(unsigned int variant);
+   void complete(Program & program);
+   void uploadConstants(Program & program);
+   void bindInstanceArrays(unsigned int firstInstance);
+
+private:
+   static const GLsizeiptr STREAM_SIZE;
+
+private:
+   std::string mVertexSource;
+   std::string mFragmentSource;
+   std::shared_ptr<CProgramCache> mCache;
+   std::shared_ptr<CUniformStream> mStream; ///< empty without uniform buffers
+
+   CGLState & mState;
+   Program mPrograms[ShaderVariant::COUNT];
+
+   FrameConstants mFrameConstants;
+   unsigned int mFrameRevision;
+
+   bool mInstancing;                   ///< instanced arrays and draws are supported
+   GLuint mInstanceBuffer;
+   GLsizeiptr mInstanceCapacity;       ///< in bytes
+   std::vector<glm::mat4> mInstances;  ///< views of instances
+
+   unsigned int mUploadedBytes;
+};
+
+} /* namespace NApp */
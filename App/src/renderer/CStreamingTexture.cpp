@@ -0,0 +1,166 @@
+#include <cstring>
+#include "renderer/CStreamingTexture.hpp"
+
+namespace NApp
+{
+
+/** Rows of RGB image in buffers are aligned as GL_UNPACK_ALIGNMENT requires by default. */
+static const int ROW_ALIGNMENT = 4;
+
+static int alignUp(int value, int alignment)
+{
+   return (value + alignment - 1) / alignment * alignment;
+}
+
+CStreamingTexture::CStreamingTexture(unsigned int buffers)
+   : mBufferCount((buffers < 1u) ? 1u : (buffers > MAX_BUFFERS) ? (unsigned int)MAX_BUFFERS : buffers)
+   , mWidth(0)
+   , mHeight(0)
+   , mTextureWidth(0)
+   , mStride(0)
+   , mTexture(0)
+   , mIndex(0)
+{
+   for (unsigned int i = 0; i < MAX_BUFFERS; ++i)
+   {
+      mBuffers[i] = 0;
+   }
+}
+
+CStreamingTexture::~CStreamingTexture()
+{
+   release();
+}
+
+void CStreamingTexture::create(int width, int height)
+{
+   release();
+
+   mWidth = width;
+   mHeight = height;
+   mTextureWidth = alignUp(width, ROW_ALIGNMENT);
+   mStride = alignUp(3 * width, ROW_ALIGNMENT);
+
+   glGenTextures(1, &mTexture);
+   glBindTexture(GL_TEXTURE_2D, mTexture);
+   glTexImage2D(GL_TEXTURE_2D,
+      0,
+      GL_RGB,
+      mTextureWidth, mHeight,
+      0,
+      GL_RGB, GL_UNSIGNED_BYTE,
+      0);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+   glBindTexture(GL_TEXTURE_2D, 0);
+
+   if (GLEW_VERSION_2_1 || GLEW_ARB_pixel_buffer_object)
+   {
+      glGenBuffers(mBufferCount, mBuffers);
+      for (unsigned int i = 0; i < mBufferCount; ++i)
+      {
+         glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mBuffers[i]);
+         glBufferData(GL_PIXEL_UNPACK_BUFFER, mStride * mHeight, 0, GL_STREAM_DRAW);
+      }
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+   }
+}
+
+void CStreamingTexture::release()
+{
+   if (0 != mBuffers[0])
+   {
+      glDeleteBuffers(mBufferCount, mBuffers);
+      for (unsigned int i = 0; i < MAX_BUFFERS; ++i)
+      {
+         mBuffers[i] = 0;
+      }
+   }
+   if (0 != mTexture)
+   {
+      glDeleteTextures(1, &mTexture);
+      mTexture = 0;
+   }
+}
+
+void CStreamingTexture::update(const cv::Mat & img)
+{
+   if (0 == mTexture || img.cols != mWidth || img.rows != mHeight)
+   {
+      create(img.cols, img.rows);
+   }
+
+   const size_t rowSize = 3 * mWidth;
+   glPixelStorei(GL_UNPACK_ALIGNMENT, ROW_ALIGNMENT);
+   glBindTexture(GL_TEXTURE_2D, mTexture);
+
+   if (0 == mBuffers[0])
+   {
+      if (img.step == (size_t)mStride)
+      {
+         glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, mWidth, mHeight, GL_RGB, GL_UNSIGNED_BYTE, img.data);
+      }
+      else
+      {
+         for (int y = 0; y < mHeight; ++y)
+         {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, mWidth, 1, GL_RGB, GL_UNSIGNED_BYTE, img.ptr(y));
+         }
+      }
+      glBindTexture(GL_TEXTURE_2D, 0);
+      return;
+   }
+
+   mIndex = (mIndex + 1) % mBufferCount;
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mBuffers[mIndex]);
+
+   // whole buffer is rewritten, so driver doesn't have to wait for its previous contents
+   const GLsizeiptr size = mStride * mHeight;
+   void * data = 0;
+   if (GLEW_VERSION_3_0 || GLEW_ARB_map_buffer_range)
+   {
+      data = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+   }
+   else
+   {
+      glBufferData(GL_PIXEL_UNPACK_BUFFER, size, 0, GL_STREAM_DRAW);
+      data = glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+   }
+
+   if (0 != data)
+   {
+      unsigned char * dst = static_cast<unsigned char *>(data);
+      if (img.step == (size_t)mStride)
+      {
+         memcpy(dst, img.data, size);
+      }
+      else
+      {
+         for (int y = 0; y < mHeight; ++y)
+         {
+            memcpy(dst + y * mStride, img.ptr(y), rowSize);
+         }
+      }
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+      // source is the buffer object, so this only schedules the transfer
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, mWidth, mHeight, GL_RGB, GL_UNSIGNED_BYTE, 0);
+   }
+
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+   glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+glm::vec2 CStreamingTexture::getTexCoordScale() const
+{
+   if (0 == mTextureWidth)
+   {
+      return glm::vec2(1.f);
+   }
+   return glm::vec2((float)mWidth / mTextureWidth, 1.f);
+}
+
+} /* namespace NApp */
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <opencv2/opencv.hpp>
+
+namespace NApp
+{
+
+/**
+ * RGB texture which is updated by a new image every frame.
+ *
+ * Images are written into a ring of pixel unpack buffers and the texture is
+ * updated from the buffer, so glTexSubImage2D() returns without copying and
+ * the transfer is done by driver while the application continues. The buffer
+ * written in the current frame is never the one GL still reads from previous
+ * frames. Without PBO support plain glTexSubImage2D() is used.
+ *
+ * Texture width is aligned to 4 pixels, so only part of it is used: see
+ * getTexCoordScale().
+ */
+class CStreamingTexture
+{
+public:
+   /**
+    * Constructor.
+    * @param buffers number of pixel buffers in rotation (2 or 3).
+    */
+   explicit CStreamingTexture(unsigned int buffers);
+
+   /** Destructor. */
+   ~CStreamingTexture();
+
+   /**
+    * Upload image, (re)creates texture and buffers if size is changed.
+    * @param img 8UC3 RGB image
+    */
+   void update(const cv::Mat & img);
+
+   /** Get GL name of texture, 0 before the first update(). */
+   GLuint getTexture() const;
+
+   /** Get texture coordinates of bottom right corner of the image. */
+   glm::vec2 getTexCoordScale() const;
+
+private:
+   void create(int width, int height);
+   void release();
+
+private:
+   static const unsigned int MAX_BUFFERS = 3u;
+
+private:
+   unsigned int mBufferCount;
+   int mWidth;
+   int mHeight;
+   int mTextureWidth;
+   int mStride;
+
+   GLuint mTexture;
+   GLuint mBuffers[MAX_BUFFERS];
+   unsigned int mIndex;
+};
+
+inline
+GLuint CStreamingTexture::getTexture() const
+{
+   return mTexture;
+}
+
+} /* namespace NApp */
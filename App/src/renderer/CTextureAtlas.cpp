@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <vector>
+#include "renderer/CTextureAtlas.hpp"
+
+namespace NApp
+{
+
+const int CTextureAtlas::PADDING = 1;
+
+CTextureAtlas::CTextureAtlas(int width, int height)
+   : mWidth(width)
+   , mHeight(height)
+   , mShelfX(PADDING)
+   , mShelfY(PADDING)
+   , mShelfHeight(0)
+   , mTexture(0)
+{
+}
+
+CTextureAtlas::~CTextureAtlas()
+{
+   if (0 != mTexture)
+   {
+      glDeleteTextures(1, &mTexture);
+   }
+}
+
+bool CTextureAtlas::initialize()
+{
+   // transparent padding around images
+   const std::vector<GLubyte> empty(4 * mWidth * mHeight, 0);
+
+   glGenTextures(1, &mTexture);
+   glBindTexture(GL_TEXTURE_2D, mTexture);
+   glTexImage2D(
+      GL_TEXTURE_2D,
+      0,
+      GL_RGBA,
+      mWidth, mHeight,
+      0,
+      GL_RGBA, GL_UNSIGNED_BYTE,
+      &empty[0]);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+   glBindTexture(GL_TEXTURE_2D, 0);
+
+   return (0 != mTexture);
+}
+
+bool CTextureAtlas::insert(
+   int width, int height,
+   GLenum format, const void * pixels, int pitch,
+   glm::vec2 & texMin, glm::vec2 & texMax)
+{
+   if (width + 2 * PADDING > mWidth)
+   {
+      return false;
+   }
+
+   // start a new shelf if the row is full
+   if (mShelfX + width + PADDING > mWidth)
+   {
+      mShelfX = PADDING;
+      mShelfY += mShelfHeight + PADDING;
+      mShelfHeight = 0;
+   }
+   if (mShelfY + height + PADDING > mHeight)
+   {
+      return false;
+   }
+
+   if (width > 0 && height > 0)
+   {
+      glBindTexture(GL_TEXTURE_2D, mTexture);
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+      glPixelStorei(GL_UNPACK_ROW_LENGTH, pitch / 4);
+      glTexSubImage2D(GL_TEXTURE_2D, 0, mShelfX, mShelfY, width, height, format, GL_UNSIGNED_BYTE, pixels);
+      glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+      glBindTexture(GL_TEXTURE_2D, 0);
+   }
+
+   texMin = glm::vec2((float)mShelfX / mWidth, (float)mShelfY / mHeight);
+   texMax = glm::vec2((float)(mShelfX + width) / mWidth, (float)(mShelfY + height) / mHeight);
+
+   mShelfX += width + PADDING;
+   mShelfHeight = std::max(mShelfHeight, height);
+
+   return true;
+}
+
+} /* namespace NApp */
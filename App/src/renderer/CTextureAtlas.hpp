@@ -0,0 +1,70 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+namespace NApp
+{
+
+/**
+ * One RGBA texture shared by many small images (glyphs, icons).
+ *
+ * Images are packed into horizontal shelves in insertion order and never
+ * removed. Each image is surrounded by transparent padding, so linear
+ * filtering doesn't bleed neighbours in.
+ */
+class CTextureAtlas
+{
+public:
+   /** Constructor. */
+   CTextureAtlas(int width, int height);
+
+   /** Destructor. */
+   ~CTextureAtlas();
+
+   /**
+    * Create texture.
+    * @return true if success, false - otherwise.
+    */
+   bool initialize();
+
+   /**
+    * Copy image into free space of atlas.
+    * @param width width of image
+    * @param height height of image
+    * @param format GL_RGBA or GL_BGRA
+    * @param pixels 32 bit pixels of image
+    * @param pitch size of row in bytes
+    * @param[out] texMin texture coordinates of top left corner
+    * @param[out] texMax texture coordinates of bottom right corner
+    * @return false if there is no space left.
+    */
+   bool insert(
+      int width, int height,
+      GLenum format, const void * pixels, int pitch,
+      glm::vec2 & texMin, glm::vec2 & texMax);
+
+   /** Get GL name of texture. */
+   GLuint getTexture() const;
+
+private:
+   static const int PADDING;
+
+private:
+   int mWidth;
+   int mHeight;
+
+   int mShelfX;
+   int mShelfY;
+   int mShelfHeight;
+
+   GLuint mTexture;
+};
+
+inline
+GLuint CTextureAtlas::getTexture() const
+{
+   return mTexture;
+}
+
+} /* namespace NApp */
@@ -0,0 +1,203 @@
+#include "renderer/CTextureCache.hpp"
+#include "renderer/CModelCache.hpp"
+#include "loader/CMappedFile.hpp"
+
+namespace NApp
+{
+
+/** Settings in key of cooked texture, changed with layout of cooked texture. */
+static const unsigned long long COOKED_TEXTURE_SETTINGS = 0x3158455443ull;
+
+SharedTexture::SharedTexture(GLuint texture, size_t memory, CTextureCache * cache)
+   : mTexture(texture)
+   , mMemory(memory)
+   , mCache(cache)
+{
+}
+
+SharedTexture::~SharedTexture()
+{
+   glDeleteTextures(1, &mTexture);
+   if (0 != mCache)
+   {
+      mCache->release(mMemory);
+   }
+}
+
+CTextureCache::CTextureCache(const CModelCache * cache)
+   : mCache(cache)
+{
+}
+
+CTextureCache::tImage CTextureCache::decode(const std::string & path)
+{
+   std::promise<tImage> decoded;
+   std::shared_future<tImage> pending;
+   std::string key;
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      key = resolve(path);
+      Entry & entry = mEntries[key];
+      if (false == entry.mTexture.expired())
+      {
+         ++mStats.Hits;
+         return tImage();
+      }
+
+      if (true == entry.mImage.valid())
+      {
+         ++mStats.Hits;
+         pending = entry.mImage;
+      }
+      else
+      {
+         ++mStats.Decodes;
+         entry.mImage = decoded.get_future().share();
+      }
+   }
+
+   if (true == pending.valid())
+   {
+      return pending.get();
+   }
+
+   std::shared_ptr<TextureImage> image = std::make_shared<TextureImage>();
+   if (true == loadCooked(key, *image))
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      ++mStats.Cooked;
+   }
+   if ( 0 != image->mCompressedFormat
+     || true == CTextureLoader::decodeFile(key, *image)
+     || CTextureLoader::FALLBACK_PATH == key)
+   {
+      decoded.set_value(image);
+      return image;
+   }
+
+   // files which can't be read share texture of fallback image
+   const tImage fallback = decode(CTextureLoader::FALLBACK_PATH);
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      Entry & entry = mEntries[key];
+      entry.mAlias = CTextureLoader::FALLBACK_PATH;
+      entry.mImage = std::shared_future<tImage>();
+   }
+   decoded.set_value(fallback);
+   return fallback;
+}
+
+CTextureCache::tTexture CTextureCache::upload(const std::string & path, tImage image)
+{
+   std::string key;
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      key = resolve(path);
+      const tTexture texture = mEntries[key].mTexture.lock();
+      if (0 != texture)
+      {
+         return texture;
+      }
+   }
+
+   if (0 == image)
+   {
+      // texture was released after decode(), only this thread uploads
+      image = decode(path);
+      if (0 == image)
+      {
+         return tTexture();
+      }
+   }
+
+   const GLuint id = CTextureLoader::upload(*image);
+   const size_t memory = CTextureLoader::getVideoMemory(*image);
+   tTexture texture;
+   if (0 != id)
+   {
+      if (0 == image->mCompressedFormat)
+      {
+         storeCooked(key, id);
+      }
+      texture = std::make_shared<SharedTexture>(id, memory, this);
+   }
+
+   std::lock_guard<std::mutex> lock(mMutex);
+   Entry & entry = mEntries[key];
+   entry.mTexture = texture;
+   entry.mImage = std::shared_future<tImage>();
+   if (0 != texture)
+   {
+      ++mStats.Uploads;
+      mStats.ResidentBytes += memory;
+   }
+   return texture;
+}
+
+TextureCacheStats CTextureCache::getStats() const
+{
+   std::lock_guard<std::mutex> lock(mMutex);
+   return mStats;
+}
+
+CTextureCache::tTexture CTextureCache::create(const TextureImage & image)
+{
+   const GLuint texture = CTextureLoader::upload(image);
+   if (0 == texture)
+   {
+      return tTexture();
+   }
+   return std::make_shared<SharedTexture>(texture, CTextureLoader::getVideoMemory(image), (CTextureCache *)0);
+}
+
+void CTextureCache::release(size_t memory)
+{
+   std::lock_guard<std::mutex> lock(mMutex);
+   mStats.ResidentBytes -= memory;
+}
+
+std::string CTextureCache::resolve(const std::string & path) const
+{
+   std::map<std::string, Entry>::const_iterator it = mEntries.find(path);
+   return (mEntries.end() != it && false == it->second.mAlias.empty()) ? it->second.mAlias : path;
+}
+
+bool CTextureCache::loadCooked(const std::string & path, TextureImage & image) const
+{
+   if ( 0 == mCache
+     || false == mCache->isEnabled()
+     || false == CTextureLoader::isCompressionEnabled())
+   {
+      return false;
+   }
+
+   const std::string key = mCache->getKey(path, COOKED_TEXTURE_SETTINGS);
+   CMappedFile file;
+   const unsigned char * data = 0;
+   size_t size = 0;
+   return ( false == key.empty()
+         && true == mCache->load(key, file, data, size)
+         && true == CTextureLoader::readCooked(data, size, image));
+}
+
+void CTextureCache::storeCooked(const std::string & path, GLuint texture) const
+{
+   if ( 0 == mCache
+     || false == mCache->isEnabled()
+     || false == CTextureLoader::isCompressionEnabled())
+   {
+      return;
+   }
+
+   // driver compressed the texture, reading it back spares compression next time
+   const std::string key = mCache->getKey(path, COOKED_TEXTURE_SETTINGS);
+   TextureImage compressed;
+   if (false == key.empty() && true == CTextureLoader::readCompressed(texture, compressed))
+   {
+      std::vector<unsigned char> data;
+      CTextureLoader::writeCooked(compressed, data);
+      mCache->store(key, data);
+   }
+}
+
+} /* namespace NApp */
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "renderer/CTextureLoader.hpp"
+
+namespace NApp
+{
+
+class CModelCache;
+class CTextureCache;
+
+/** GL texture shared by models, deleted with the last reference. */
+struct SharedTexture
+{
+   /** @param cache cache counting memory of texture, 0 if texture isn't shared */
+   SharedTexture(GLuint texture, size_t memory, CTextureCache * cache);
+   ~SharedTexture();
+
+   GLuint mTexture;
+   size_t mMemory; ///< estimate of video memory
+   CTextureCache * mCache;
+
+private:
+   SharedTexture(const SharedTexture &);
+   SharedTexture & operator=(const SharedTexture &);
+};
+
+/** Counters of texture cache since start. */
+struct TextureCacheStats
+{
+   TextureCacheStats()
+      : Decodes(0)
+      , Cooked(0)
+      , Uploads(0)
+      , Hits(0)
+      , ResidentBytes(0)
+   {
+   }
+
+   unsigned int Decodes; ///< files decoded
+   unsigned int Cooked;  ///< decodes served by compressed images of cache
+   unsigned int Uploads; ///< textures created
+   unsigned int Hits;    ///< requests served by decoded image or resident texture
+   size_t ResidentBytes; ///< video memory of resident textures, each counted once
+};
+
+/**
+ * Textures of models shared by path. Every file is decoded and uploaded
+ * once while some model holds its texture, files which can't be read share
+ * texture of CTextureLoader::FALLBACK_PATH. Only weak references are kept,
+ * texture is deleted with the last model using it.
+ * Video memory of textures is counted here once, however many models share them.
+ * Paths are keys as they are, models resolve them by CUtils::getFullPath()
+ * at import.
+ * When textures are compressed, compressed mip chain of every file is
+ * cooked into model cache, later loads read it instead of decoding file.
+ */
+class CTextureCache
+{
+public:
+   typedef std::shared_ptr<const TextureImage> tImage;
+   typedef std::shared_ptr<SharedTexture> tTexture;
+
+public:
+   /**
+    * Constructor.
+    * @param cache cache of cooked models keeping compressed textures, may be 0
+    */
+   explicit CTextureCache(const CModelCache * cache);
+
+   /**
+    * Decode image of file unless its texture is resident. Concurrent
+    * requests of one file wait for one decoding, cooked image is read if
+    * it's in cache. Thread safe.
+    * @return 0 if texture is resident, image with no pixels if neither file
+    *    nor fallback can be read
+    */
+   tImage decode(const std::string & path);
+
+   /**
+    * Get texture of file, it's uploaded from image if it isn't resident.
+    * Called on thread with GL context.
+    * @param image result of decode(), decoded again if it's 0 and texture
+    *    was released since
+    * @return 0 if image has no pixels
+    */
+   tTexture upload(const std::string & path, tImage image);
+
+   TextureCacheStats getStats() const;
+
+   /** Upload texture which isn't shared, 0 if image has no pixels. */
+   static tTexture create(const TextureImage & image);
+
+private:
+   friend struct SharedTexture;
+
+   /** Called by the last reference of texture. */
+   void release(size_t memory);
+
+   struct Entry
+   {
+      std::string mAlias;                ///< FALLBACK_PATH if file can't be read
+      std::weak_ptr<SharedTexture> mTexture;
+      std::shared_future<tImage> mImage; ///< from decoding until upload
+   };
+
+   /** Key of path, caller locks mMutex. */
+   std::string resolve(const std::string & path) const;
+
+   bool loadCooked(const std::string & path, TextureImage & image) const;
+   void storeCooked(const std::string & path, GLuint texture) const;
+
+private:
+   const CModelCache * mCache;
+   std::map<std::string, Entry> mEntries;
+   mutable std::mutex mMutex;
+   TextureCacheStats mStats;
+};
+
+} /* namespace NApp */
@@ -0,0 +1,361 @@
+#include <algorithm>
+#include <cstdlib>
+#include <SDL.h>
+#include <cv.h>
+#include <highgui.h>
+#include "renderer/CTextureLoader.hpp"
+#include "loader/CBinaryStream.hpp"
+#include "loader/TGALoader.hpp"
+
+namespace NApp
+{
+
+const std::string CTextureLoader::FALLBACK_PATH = "data/mash.bmp";
+/** DXT1 takes 1/8 of RGB8 texture, DXT5 1/4 of RGBA8 one. */
+const bool CTextureLoader::COMPRESS_TEXTURES = true;
+
+TextureImage::TextureImage()
+   : mWidth(0)
+   , mHeight(0)
+   , mFormat(GL_BGR)
+   , mCompressedFormat(0)
+{
+}
+
+bool CTextureLoader::decode(const std::string & path, TextureImage & image)
+{
+   return ( true == decodeFile(path, image)
+         || true == decodeBMP(FALLBACK_PATH, image));
+}
+
+bool CTextureLoader::decodeFile(const std::string & path, TextureImage & image)
+{
+   return ( true == decodeImage(path, image)
+         || true == decodeTGA(path, image)
+         || true == decodeBMP(path, image));
+}
+
+GLuint CTextureLoader::upload(const TextureImage & image)
+{
+   if (true == image.mPixels.empty())
+   {
+      return 0;
+   }
+
+   if (0 != image.mCompressedFormat)
+   {
+      return uploadCompressed(image);
+   }
+
+   GLuint texture = 0;
+   glGenTextures(1, &texture);
+   glBindTexture(GL_TEXTURE_2D, texture);
+
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+   // rows of decoded images aren't padded
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+   const GLint internalFormat = getInternalFormat(image.mFormat);
+   if ( (GLEW_VERSION_3_0 || GLEW_ARB_framebuffer_object)
+     && (GLEW_VERSION_2_0 || GLEW_ARB_texture_non_power_of_two))
+   {
+      // base level is uploaded once, GPU filters the rest of the chain
+      glTexImage2D(
+         GL_TEXTURE_2D, 0,
+         internalFormat,
+         image.mWidth, image.mHeight, 0,
+         image.mFormat, GL_UNSIGNED_BYTE,
+         image.mPixels.data());
+      glGenerateMipmap(GL_TEXTURE_2D);
+   }
+   else
+   {
+      // scales image to power of two and filters mipmaps on CPU
+      gluBuild2DMipmaps(
+         GL_TEXTURE_2D,
+         internalFormat,
+         image.mWidth, image.mHeight,
+         image.mFormat, GL_UNSIGNED_BYTE,
+         image.mPixels.data());
+   }
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+   return texture;
+}
+
+size_t CTextureLoader::getVideoMemory(const TextureImage & image)
+{
+   if (0 != image.mCompressedFormat)
+   {
+      size_t size = 0;
+      for (size_t i = 0; i < image.mLevelSizes.size(); ++i)
+      {
+         size += image.mLevelSizes[i];
+      }
+      return size;
+   }
+
+   // drivers store RGB8 as 4 bytes per texel, mipmaps add a third
+   size_t texelBits = 32;
+   switch (getInternalFormat(image.mFormat))
+   {
+   case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+      texelBits = 4;
+      break;
+   case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+      texelBits = 8;
+      break;
+   }
+   return (size_t)image.mWidth * image.mHeight * texelBits / 8 * 4 / 3;
+}
+
+bool CTextureLoader::isCompressionEnabled()
+{
+   return (true == COMPRESS_TEXTURES && GLEW_EXT_texture_compression_s3tc) ? true : false;
+}
+
+bool CTextureLoader::readCompressed(GLuint texture, TextureImage & image)
+{
+   glBindTexture(GL_TEXTURE_2D, texture);
+
+   GLint compressed = GL_FALSE;
+   glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed);
+   if (GL_FALSE == compressed)
+   {
+      return false;
+   }
+
+   GLint format = 0;
+   GLint width = 0;
+   GLint height = 0;
+   glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+   glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+   glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+
+   // only formats which upload() asks for are cooked
+   if (0 == getBlockSize((GLenum)format))
+   {
+      return false;
+   }
+
+   image.mWidth = width;
+   image.mHeight = height;
+   image.mFormat = (GL_COMPRESSED_RGB_S3TC_DXT1_EXT == format) ? GL_RGB : GL_RGBA;
+   image.mCompressedFormat = (GLenum)format;
+   image.mPixels.clear();
+   image.mLevelSizes.clear();
+
+   // upload() makes the whole chain down to 1x1
+   for (GLint level = 0; ; ++level)
+   {
+      GLint size = 0;
+      glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+      if (0 >= size)
+      {
+         return false;
+      }
+
+      const size_t offset = image.mPixels.size();
+      image.mPixels.resize(offset + size);
+      glGetCompressedTexImage(GL_TEXTURE_2D, level, image.mPixels.data() + offset);
+      image.mLevelSizes.push_back((size_t)size);
+
+      if (1 >= (width >> level) && 1 >= (height >> level))
+      {
+         return true;
+      }
+   }
+}
+
+void CTextureLoader::writeCooked(const TextureImage & image, std::vector<unsigned char> & data)
+{
+   CBinaryWriter writer(data);
+   writer.write(image.mWidth);
+   writer.write(image.mHeight);
+   writer.write(image.mFormat);
+   writer.write(image.mCompressedFormat);
+   writer.write((unsigned int)image.mLevelSizes.size());
+   for (size_t i = 0; i < image.mLevelSizes.size(); ++i)
+   {
+      writer.write((unsigned long long)image.mLevelSizes[i]);
+   }
+   writer.write(image.mPixels.data(), image.mPixels.size());
+}
+
+bool CTextureLoader::readCooked(const unsigned char * data, size_t size, TextureImage & image)
+{
+   CBinaryReader reader(data, size);
+   TextureImage cooked;
+   unsigned int levelCount = 0;
+   reader.read(cooked.mWidth);
+   reader.read(cooked.mHeight);
+   reader.read(cooked.mFormat);
+   reader.read(cooked.mCompressedFormat);
+   reader.read(levelCount);
+
+   // damaged file must not make large allocations, levels are the whole chain
+   const size_t blockSize = getBlockSize(cooked.mCompressedFormat);
+   if ( false == reader.isValid()
+     || 0 == blockSize
+     || 0 >= cooked.mWidth
+     || 0 >= cooked.mHeight
+     || getLevelCount(cooked.mWidth, cooked.mHeight) != levelCount
+     || levelCount > reader.getRemaining() / sizeof(unsigned long long))
+   {
+      return false;
+   }
+
+   unsigned long long pixelSize = 0;
+   cooked.mLevelSizes.resize(levelCount);
+   for (unsigned int i = 0; i < levelCount; ++i)
+   {
+      // size of level follows from its dimensions
+      const unsigned long long width = std::max(1, cooked.mWidth >> i);
+      const unsigned long long height = std::max(1, cooked.mHeight >> i);
+      const unsigned long long expected = ((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+      unsigned long long levelSize = 0;
+      if ( false == reader.read(levelSize)
+        || expected != levelSize
+        || size < levelSize)
+      {
+         return false;
+      }
+      cooked.mLevelSizes[i] = (size_t)levelSize;
+      pixelSize += levelSize;
+   }
+
+   const unsigned char * pixels = (size >= pixelSize) ? reader.skip((size_t)pixelSize) : 0;
+   if (0 == pixels || 0 != reader.getRemaining())
+   {
+      return false;
+   }
+
+   cooked.mPixels.assign(pixels, pixels + (size_t)pixelSize);
+   std::swap(image, cooked);
+   return true;
+}
+
+bool CTextureLoader::decodeImage(const std::string & path, TextureImage & image)
+{
+   const cv::Mat decoded = cv::imread(path.c_str(), CV_LOAD_IMAGE_COLOR);
+   if (true == decoded.empty())
+   {
+      return false;
+   }
+
+   image.mWidth = decoded.cols;
+   image.mHeight = decoded.rows;
+   image.mFormat = GL_BGR;
+   copyRows(decoded.data, decoded.step, image);
+   return true;
+}
+
+bool CTextureLoader::decodeTGA(const std::string & path, TextureImage & image)
+{
+   Texture texture = Texture();
+   TGALoader loader;
+   if ( false == loader.LoadTGA(&texture, path.c_str())
+     || 0 == texture.imageData)
+   {
+      return false;
+   }
+
+   image.mWidth = texture.width;
+   image.mHeight = texture.height;
+   image.mFormat = texture.type;
+   copyRows(texture.imageData, texture.width * getPixelSize(texture.type), image);
+   free(texture.imageData);
+   return true;
+}
+
+bool CTextureLoader::decodeBMP(const std::string & path, TextureImage & image)
+{
+   SDL_Surface * surface = SDL_LoadBMP(path.c_str());
+   if (0 == surface)
+   {
+      return false;
+   }
+
+   image.mWidth = surface->w;
+   image.mHeight = surface->h;
+   image.mFormat = GL_BGR;
+   copyRows((const GLubyte *)surface->pixels, surface->pitch, image);
+   SDL_FreeSurface(surface);
+   return true;
+}
+
+void CTextureLoader::copyRows(const GLubyte * data, size_t pitch, TextureImage & image)
+{
+   const size_t rowSize = image.mWidth * getPixelSize(image.mFormat);
+   image.mPixels.resize(rowSize * image.mHeight);
+   for (GLsizei y = 0; y < image.mHeight; ++y)
+   {
+      std::copy(data + y * pitch, data + y * pitch + rowSize, image.mPixels.begin() + y * rowSize);
+   }
+}
+
+size_t CTextureLoader::getPixelSize(GLenum format)
+{
+   return (GL_RGBA == format) ? 4 : 3;
+}
+
+GLint CTextureLoader::getInternalFormat(GLenum format)
+{
+   const bool alpha = (GL_RGBA == format);
+   if (true == isCompressionEnabled())
+   {
+      return alpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+   }
+   return alpha ? GL_RGBA8 : GL_RGB8;
+}
+
+size_t CTextureLoader::getBlockSize(GLenum compressedFormat)
+{
+   switch (compressedFormat)
+   {
+   case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+      return 8;
+   case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+      return 16;
+   default:
+      return 0;
+   }
+}
+
+unsigned int CTextureLoader::getLevelCount(GLsizei width, GLsizei height)
+{
+   unsigned int count = 1;
+   for (GLsizei size = std::max(width, height); 1 < size; size >>= 1)
+   {
+      ++count;
+   }
+   return count;
+}
+
+GLuint CTextureLoader::uploadCompressed(const TextureImage & image)
+{
+   GLuint texture = 0;
+   glGenTextures(1, &texture);
+   glBindTexture(GL_TEXTURE_2D, texture);
+
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)image.mLevelSizes.size() - 1);
+
+   size_t offset = 0;
+   for (size_t level = 0; level < image.mLevelSizes.size(); ++level)
+   {
+      glCompressedTexImage2D(
+         GL_TEXTURE_2D, (GLint)level,
+         image.mCompressedFormat,
+         std::max(1, image.mWidth >> level), std::max(1, image.mHeight >> level), 0,
+         (GLsizei)image.mLevelSizes[level],
+         image.mPixels.data() + offset);
+      offset += image.mLevelSizes[level];
+   }
+
+   return texture;
+}
+
+} /* namespace NApp */
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <string>
+#include <vector>
+
+namespace NApp
+{
+
+/**
+ * Decoded image of texture, rows are tightly packed. Cooked image holds
+ * compressed mip chain instead, levels follow each other in mPixels.
+ */
+struct TextureImage
+{
+   TextureImage();
+
+   GLsizei mWidth;
+   GLsizei mHeight;
+   GLenum mFormat;       ///< GL_BGR, GL_RGB or GL_RGBA
+   std::vector<GLubyte> mPixels;
+   GLenum mCompressedFormat;       ///< 0 if pixels aren't compressed
+   std::vector<size_t> mLevelSizes; ///< bytes of compressed levels
+};
+
+/**
+ * Loading of model textures in two steps: decoding of file, which can run
+ * on any thread, and upload, which needs GL context. Mipmaps are generated
+ * by GPU. With S3TC textures are compressed by driver at upload, compressed
+ * mip chain can be read back and cooked, so next load skips decoding and
+ * compression.
+ */
+class CTextureLoader
+{
+public:
+   /** Fallback image of textures which can't be read. */
+   static const std::string FALLBACK_PATH;
+
+   /** Store textures compressed when driver supports S3TC. */
+   static const bool COMPRESS_TEXTURES;
+
+public:
+   /**
+    * Decode image file, FALLBACK_PATH is decoded if it can't be read.
+    * Thread safe.
+    * @return false if neither of them can be read
+    */
+   static bool decode(const std::string & path, TextureImage & image);
+
+   /**
+    * Decode image file without fallback. Thread safe.
+    * @return false if it can't be read
+    */
+   static bool decodeFile(const std::string & path, TextureImage & image);
+
+   /**
+    * Create texture with mipmaps from image.
+    * @return 0 if image is empty
+    */
+   static GLuint upload(const TextureImage & image);
+
+   /** Estimate video memory of texture which upload() creates from image. */
+   static size_t getVideoMemory(const TextureImage & image);
+
+   /** @return true if upload() compresses textures, reading it needs no GL context. */
+   static bool isCompressionEnabled();
+
+   /**
+    * Read back compressed mip chain of texture created by upload().
+    * @return false if texture isn't compressed
+    */
+   static bool readCompressed(GLuint texture, TextureImage & image);
+
+   /** Serialize compressed image, see readCompressed(). */
+   static void writeCooked(const TextureImage & image, std::vector<unsigned char> & data);
+
+   /**
+    * Read image written by writeCooked(). Thread safe.
+    * @return false if data are damaged, image isn't changed then
+    */
+   static bool readCooked(const unsigned char * data, size_t size, TextureImage & image);
+
+private:
+   static bool decodeImage(const std::string & path, TextureImage & image);
+   static bool decodeTGA(const std::string & path, TextureImage & image);
+   static bool decodeBMP(const std::string & path, TextureImage & image);
+   static void copyRows(const GLubyte * data, size_t pitch, TextureImage & image);
+   static size_t getPixelSize(GLenum format);
+   static GLint getInternalFormat(GLenum format);
+   static GLuint uploadCompressed(const TextureImage & image);
+
+   /** Bytes of 4x4 block of DXT1 or DXT5, 0 for other formats. */
+   static size_t getBlockSize(GLenum compressedFormat);
+
+   /** Levels of mip chain down to 1x1. */
+   static unsigned int getLevelCount(GLsizei width, GLsizei height);
+};
+
+} /* namespace NApp */
@@ -0,0 +1,111 @@
+#include <cstring>
+#include <iostream>
+#include "renderer/CUniformStream.hpp"
+
+namespace NApp
+{
+
+CUniformStream::CUniformStream(GLsizeiptr capacity)
+   : mBuffer(0)
+   , mCapacity(capacity)
+   , mOffset(0)
+   , mAlignment(256)
+   , mWritten(0)
+   , mFrameBinding(0)
+{
+}
+
+CUniformStream::~CUniformStream()
+{
+   if (0 != mBuffer)
+   {
+      glDeleteBuffers(1, &mBuffer);
+   }
+}
+
+bool CUniformStream::initialize()
+{
+   if ( !(GLEW_VERSION_3_1 || GLEW_ARB_uniform_buffer_object)
+     || !(GLEW_VERSION_3_0 || GLEW_ARB_map_buffer_range))
+   {
+      std::cerr << "GL_ARB_uniform_buffer_object isn't supported." << std::endl;
+      return false;
+   }
+
+   glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &mAlignment);
+   if (0 >= mAlignment)
+   {
+      mAlignment = 256;
+   }
+
+   glGenBuffers(1, &mBuffer);
+   glBindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+   glBufferData(GL_UNIFORM_BUFFER, mCapacity, 0, GL_STREAM_DRAW);
+   glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+   return true;
+}
+
+void CUniformStream::beginFrame(GLuint binding, const void * data, GLsizeiptr size)
+{
+   mFrameBinding = binding;
+   mFrameData.assign((const unsigned char *)data, (const unsigned char *)data + size);
+
+   glBindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+   orphan();
+   glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void CUniformStream::write(GLuint binding, const void * data, GLsizeiptr size, GLsizeiptr blockSize)
+{
+   glBindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+
+   const GLsizeiptr offset = (mOffset + mAlignment - 1) / mAlignment * mAlignment;
+   if (offset + blockSize > mCapacity)
+   {
+      // earlier ranges may still be in use, frame data are bound again from new storage
+      orphan();
+   }
+   writeRange(binding, data, size, blockSize);
+
+   glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+GLsizeiptr CUniformStream::takeWrittenBytes()
+{
+   const GLsizeiptr written = mWritten;
+   mWritten = 0;
+   return written;
+}
+
+void CUniformStream::orphan()
+{
+   glBufferData(GL_UNIFORM_BUFFER, mCapacity, 0, GL_STREAM_DRAW);
+   mOffset = 0;
+   if (false == mFrameData.empty())
+   {
+      const GLsizeiptr size = (GLsizeiptr)mFrameData.size();
+      writeRange(mFrameBinding, mFrameData.data(), size, size);
+   }
+}
+
+void CUniformStream::writeRange(GLuint binding, const void * data, GLsizeiptr size, GLsizeiptr blockSize)
+{
+   const GLsizeiptr offset = (mOffset + mAlignment - 1) / mAlignment * mAlignment;
+   void * target = glMapBufferRange(
+      GL_UNIFORM_BUFFER,
+      offset, size,
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+   if (0 != target)
+   {
+      memcpy(target, data, size);
+      glUnmapBuffer(GL_UNIFORM_BUFFER);
+   }
+
+   glBindBufferRange(GL_UNIFORM_BUFFER, binding, mBuffer, offset, blockSize);
+
+   mOffset = offset + size;
+   mWritten += size;
+}
+
+} /* namespace NApp */
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <vector>
+
+namespace NApp
+{
+
+/**
+ * Ring of uniform data in one buffer object.
+ *
+ * Every write() appends data after the previous one and binds the written
+ * range to uniform block binding point. Ranges are never rewritten while
+ * draws may still read them: storage is orphaned by beginFrame(), and when
+ * the buffer gets full within frame. Data of beginFrame() stay bound for
+ * the whole frame, they are written again to the new storage then.
+ * Requires GL 3.1 or ARB_uniform_buffer_object and ARB_map_buffer_range.
+ */
+class CUniformStream
+{
+public:
+   /**
+    * Constructor.
+    * @param capacity size of buffer in bytes
+    */
+   explicit CUniformStream(GLsizeiptr capacity);
+
+   /** Destructor. */
+   ~CUniformStream();
+
+   /**
+    * Create buffer.
+    * @return true if success, false - otherwise.
+    */
+   bool initialize();
+
+   /**
+    * Take fresh storage, write data which draws of the whole frame use and
+    * bind it to binding point.
+    * @param binding uniform block binding point
+    * @param data data to write, size of uniform block
+    * @param size size of data
+    */
+   void beginFrame(GLuint binding, const void * data, GLsizeiptr size);
+
+   /**
+    * Write data and bind it to binding point.
+    * @param binding uniform block binding point
+    * @param data data to write
+    * @param size size of data
+    * @param blockSize size of uniform block, bound range has this size, so
+    *        only used part of block (e.g. of array) can be written
+    */
+   void write(GLuint binding, const void * data, GLsizeiptr size, GLsizeiptr blockSize);
+
+   /** Get number of bytes written since the last call. */
+   GLsizeiptr takeWrittenBytes();
+
+private:
+   /** Take fresh storage and write frame data to its beginning. */
+   void orphan();
+
+   /** Copy data to aligned free offset and bind the range. */
+   void writeRange(GLuint binding, const void * data, GLsizeiptr size, GLsizeiptr blockSize);
+
+private:
+   GLuint mBuffer;
+   GLsizeiptr mCapacity;
+   GLsizeiptr mOffset;    ///< start of free part of buffer
+   GLint mAlignment;      ///< GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+   GLsizeiptr mWritten;
+   GLuint mFrameBinding;
+   std::vector<unsigned char> mFrameData; ///< copy of data of beginFrame()
+};
+
+} /* namespace NApp */
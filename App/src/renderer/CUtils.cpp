@@ -1,21 +1,27 @@
 #include <GL/glew.h>
 #include <iostream>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
 #include "renderer/CUtils.hpp"
 
 namespace NApp
 {
 
+const unsigned long long CUtils::HASH_SEED = 14695981039346656037ull;
+
 bool CUtils::isExtensionSupported(const char * extensionsString)
 {
    const char * extensionsList = (const char *)glGetString(GL_EXTENSIONS);
-   size_t extensionsLength = strlen(extensionsString);
-   size_t nextExtensionLength = 0;
-
-   if (0 != extensionsString || 0 != extensionsList)
+   if (0 == extensionsString || 0 == extensionsList)
    {
       return false;
    }
 
+   size_t extensionsLength = strlen(extensionsString);
+   size_t nextExtensionLength = 0;
+
    while (0 != *extensionsList)
    {
       nextExtensionLength = strcspn(extensionsList, " ");
@@ -25,7 +31,11 @@ bool CUtils::isExtensionSupported(const char * extensionsString)
       {
          return true;
       }
-      extensionsList += nextExtensionLength + 1;
+      extensionsList += nextExtensionLength;
+      if (' ' == *extensionsList)
+      {
+         ++extensionsList;
+      }
    }
 
    return false;
@@ -70,4 +80,56 @@ std::string CUtils::replaceString(const std::string & str, const std::string & p
    return result;
 }
 
+bool CUtils::createDirectory(const std::string & path)
+{
+   const std::string normalized = CUtils::replaceString(path, "\\", "/");
+
+   std::string::size_type pos = 0;
+   while (std::string::npos != pos)
+   {
+      pos = normalized.find('/', pos + 1);
+      const std::string parent = normalized.substr(0, pos);
+
+      struct stat info;
+      if (0 == stat(parent.c_str(), &info))
+      {
+         continue;
+      }
+
+#ifdef _WIN32
+      if (0 != _mkdir(parent.c_str()))
+#else
+      if (0 != mkdir(parent.c_str(), 0755))
+#endif
+      {
+         std::cerr << "Can't create directory '" << parent << "'." << std::endl;
+         return false;
+      }
+   }
+   return true;
+}
+
+bool CUtils::getModificationTime(const std::string & path, long long & time)
+{
+   struct stat info;
+   if (0 != stat(path.c_str(), &info))
+   {
+      return false;
+   }
+   time = (long long)info.st_mtime;
+   return true;
+}
+
+void CUtils::hashString(const std::string & str, unsigned long long & hash)
+{
+   for (size_t i = 0; i < str.size(); ++i)
+   {
+      hash ^= (unsigned char)str[i];
+      hash *= 1099511628211ull;
+   }
+   // separator, so "ab" + "c" and "a" + "bc" differ
+   hash ^= 0xffu;
+   hash *= 1099511628211ull;
+}
+
 } /* namespace NApp */
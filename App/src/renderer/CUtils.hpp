@@ -15,6 +15,20 @@ public:
    static std::string getFullPath(const std::string & parent, const std::string & relative);
    static std::string replaceString(const std::string & str, const std::string & pattern, const std::string & replacement);
 
+   /** Create directory and its missing parents, true if it exists after call. */
+   static bool createDirectory(const std::string & path);
+
+   /** Get modification time of file, false if it doesn't exist. */
+   static bool getModificationTime(const std::string & path, long long & time);
+
+   /**
+    * Add string to 64-bit FNV-1a hash, good enough to tell inputs apart.
+    * Hash starts with HASH_SEED.
+    */
+   static void hashString(const std::string & str, unsigned long long & hash);
+
+   static const unsigned long long HASH_SEED;
+
 private:
    CUtils();
 };
@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <cmath>
+#include "renderer/CVertexCache.hpp"
+
+namespace NApp
+{
+
+/** @{ Parameters of Forsyth's scoring. */
+static const int CACHE_SIZE = 32;
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRIANGLE_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+/** @} */
+
+static float getVertexScore(int cachePosition, unsigned int remainingTriangles)
+{
+   if (0 == remainingTriangles)
+   {
+      return -1.f;
+   }
+
+   float score = 0.f;
+   if (cachePosition < 0)
+   {
+      // not in cache
+   }
+   else if (cachePosition < 3)
+   {
+      // vertices of the last triangle score fixed value, so it doesn't matter
+      // which of them is used again
+      score = LAST_TRIANGLE_SCORE;
+   }
+   else
+   {
+      const float scale = 1.f / (CACHE_SIZE - 3);
+      score = std::pow(1.f - (cachePosition - 3) * scale, CACHE_DECAY_POWER);
+   }
+
+   // vertices with few triangles left are finished first
+   score += VALENCE_BOOST_SCALE * std::pow((float)remainingTriangles, -VALENCE_BOOST_POWER);
+   return score;
+}
+
+void CVertexCache::optimizeTriangles(unsigned int * indices, size_t indexCount, size_t vertexCount)
+{
+   const size_t triangleCount = indexCount / 3;
+   if (0 == triangleCount)
+   {
+      return;
+   }
+
+   // triangles of each vertex, active ones are first remaining[v] of them
+   std::vector<unsigned int> remaining(vertexCount, 0);
+   for (size_t i = 0; i < triangleCount * 3; ++i)
+   {
+      ++remaining[indices[i]];
+   }
+
+   std::vector<unsigned int> offsets(vertexCount + 1, 0);
+   for (size_t v = 0; v < vertexCount; ++v)
+   {
+      offsets[v + 1] = offsets[v] + remaining[v];
+   }
+
+   std::vector<unsigned int> adjacency(triangleCount * 3);
+   std::vector<unsigned int> filled(vertexCount, 0);
+   for (size_t i = 0; i < triangleCount * 3; ++i)
+   {
+      const unsigned int v = indices[i];
+      adjacency[offsets[v] + filled[v]++] = (unsigned int)(i / 3);
+   }
+
+   std::vector<int> cachePositions(vertexCount, -1);
+   std::vector<float> vertexScores(vertexCount);
+   for (size_t v = 0; v < vertexCount; ++v)
+   {
+      vertexScores[v] = getVertexScore(-1, remaining[v]);
+   }
+
+   std::vector<float> triangleScores(triangleCount);
+   std::vector<bool> emitted(triangleCount, false);
+   for (size_t t = 0; t < triangleCount; ++t)
+   {
+      triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+   }
+
+   std::vector<unsigned int> result;
+   result.reserve(triangleCount * 3);
+
+   std::vector<unsigned int> cache;
+   std::vector<unsigned int> newCache;
+   cache.reserve(CACHE_SIZE + 3);
+   newCache.reserve(CACHE_SIZE + 3);
+
+   int best = -1;
+   size_t scanStart = 0;
+   for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+   {
+      if (-1 == best)
+      {
+         // nothing in cache is connected to rest of mesh, take the best of all
+         float bestScore = -1.f;
+         for (size_t t = scanStart; t < triangleCount; ++t)
+         {
+            if (false == emitted[t] && triangleScores[t] > bestScore)
+            {
+               bestScore = triangleScores[t];
+               best = (int)t;
+            }
+         }
+         while (scanStart < triangleCount && true == emitted[scanStart])
+         {
+            ++scanStart;
+         }
+      }
+
+      const unsigned int * triangle = &indices[best * 3];
+      result.insert(result.end(), triangle, triangle + 3);
+      emitted[best] = true;
+
+      // remove triangle from active lists of its vertices
+      for (int i = 0; i < 3; ++i)
+      {
+         const unsigned int v = triangle[i];
+         unsigned int * begin = &adjacency[offsets[v]];
+         unsigned int * end = begin + remaining[v];
+         std::iter_swap(std::find(begin, end, (unsigned int)best), end - 1);
+         --remaining[v];
+      }
+
+      // vertices of triangle move to front of LRU cache
+      newCache.assign(triangle, triangle + 3);
+      for (size_t i = 0; i < cache.size(); ++i)
+      {
+         if (cache[i] != triangle[0] && cache[i] != triangle[1] && cache[i] != triangle[2])
+         {
+            newCache.push_back(cache[i]);
+         }
+      }
+      cache.swap(newCache);
+
+      for (size_t i = 0; i < cache.size(); ++i)
+      {
+         const unsigned int v = cache[i];
+         cachePositions[v] = (i < (size_t)CACHE_SIZE) ? (int)i : -1;
+         vertexScores[v] = getVertexScore(cachePositions[v], remaining[v]);
+      }
+
+      // the next triangle is the best one around cached vertices
+      best = -1;
+      float bestScore = -1.f;
+      for (size_t i = 0; i < cache.size(); ++i)
+      {
+         const unsigned int v = cache[i];
+         for (unsigned int j = 0; j < remaining[v]; ++j)
+         {
+            const unsigned int t = adjacency[offsets[v] + j];
+            const unsigned int * other = &indices[t * 3];
+            triangleScores[t] = vertexScores[other[0]] + vertexScores[other[1]] + vertexScores[other[2]];
+            if (triangleScores[t] > bestScore)
+            {
+               bestScore = triangleScores[t];
+               best = (int)t;
+            }
+         }
+      }
+
+      if (cache.size() > (size_t)CACHE_SIZE)
+      {
+         cache.resize(CACHE_SIZE);
+      }
+   }
+
+   std::copy(result.begin(), result.end(), indices);
+}
+
+void CVertexCache::optimizeFetch(std::vector<unsigned int> & indices, size_t vertexCount, std::vector<unsigned int> & order)
+{
+   static const unsigned int UNUSED = 0xffffffffu;
+
+   std::vector<unsigned int> remap(vertexCount, UNUSED);
+   order.clear();
+   order.reserve(vertexCount);
+
+   for (size_t i = 0; i < indices.size(); ++i)
+   {
+      unsigned int & index = indices[i];
+      if (UNUSED == remap[index])
+      {
+         remap[index] = (unsigned int)order.size();
+         order.push_back(index);
+      }
+      index = remap[index];
+   }
+
+   // unreferenced vertices are kept at the end
+   for (size_t v = 0; v < vertexCount; ++v)
+   {
+      if (UNUSED == remap[v])
+      {
+         order.push_back((unsigned int)v);
+      }
+   }
+}
+
+unsigned int CVertexCache::countCacheMisses(const unsigned int * indices, size_t indexCount, unsigned int cacheSize)
+{
+   std::vector<unsigned int> fifo(cacheSize, 0xffffffffu);
+   size_t next = 0;
+   unsigned int misses = 0;
+
+   for (size_t i = 0; i < indexCount; ++i)
+   {
+      if (fifo.end() == std::find(fifo.begin(), fifo.end(), indices[i]))
+      {
+         fifo[next] = indices[i];
+         next = (next + 1) % cacheSize;
+         ++misses;
+      }
+   }
+   return misses;
+}
+
+} /* namespace NApp */
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace NApp
+{
+
+/**
+ * Import time optimisations of indexed triangle lists for post-transform
+ * vertex cache and vertex fetch.
+ */
+class CVertexCache
+{
+public:
+   /** Size of FIFO cache used for ACMR, typical for current GPUs. */
+   static const unsigned int FIFO_SIZE = 16u;
+
+   /**
+    * Reorder triangles so shared vertices stay in cache (Forsyth's linear
+    * speed vertex cache optimisation).
+    * @param indices triangle list
+    * @param indexCount number of indices
+    * @param vertexCount number of vertices referenced by indices
+    */
+   static void optimizeTriangles(unsigned int * indices, size_t indexCount, size_t vertexCount);
+
+   /**
+    * Renumber vertices in order of the first use, so vertices are fetched
+    * from memory sequentially.
+    * @param indices index lists, all of them are renumbered
+    * @param vertexCount number of vertices
+    * @param[out] order old index of each new vertex
+    */
+   static void optimizeFetch(std::vector<unsigned int> & indices, size_t vertexCount, std::vector<unsigned int> & order);
+
+   /**
+    * Count vertex shader runs of triangle list with FIFO cache.
+    * @return number of cache misses, divided by number of triangles it is ACMR
+    */
+   static unsigned int countCacheMisses(const unsigned int * indices, size_t indexCount, unsigned int cacheSize = FIFO_SIZE);
+};
+
+} /* namespace NApp */
@@ -21,6 +21,11 @@ struct IconData
    }
 };
 
+/** Handle of image loaded by IRenderer::loadImage(). */
+typedef unsigned int tImageHandle;
+
+static const tImageHandle INVALID_IMAGE = 0u;
+
 struct FontSize
 {
    enum ESize
@@ -31,6 +36,31 @@ struct FontSize
    };
 };
 
+/** Counters of the last finished frame. */
+struct RenderStats
+{
+   RenderStats()
+      : NameLookups(0)
+      , LocationQueries(0)
+      , UniformBytes(0)
+      , DrawCalls(0)
+      , StateChanges(0)
+      , SkippedStateChanges(0)
+      , ResidentModels(0)
+      , ModelMemory(0)
+   {
+   }
+
+   unsigned int NameLookups;     ///< shader locations searched by name string
+   unsigned int LocationQueries; ///< shader locations queried from GL
+   unsigned int UniformBytes;    ///< model constants, bone palettes and instances uploaded
+   unsigned int DrawCalls;       ///< draw calls of models
+   unsigned int StateChanges;    ///< program, texture, vertex array and capability changes of models
+   unsigned int SkippedStateChanges; ///< redundant changes which weren't passed to GL
+   unsigned int ResidentModels;  ///< uploaded models of markers
+   unsigned int ModelMemory;     ///< CPU and GPU kilobytes of them
+};
+
 /** Interface of renderer. */
 class IRenderer
 {
@@ -47,6 +77,13 @@ public:
    /** Get current FPS value. */
    virtual int getFps() const = 0;
 
+   /**
+    * @brief Start upload of frame for background before render() of this frame,
+    * so transfer overlaps with other work (e.g. detection). Optional.
+    * @param frame frame from camera
+    */
+   virtual void uploadFrame(const CFrame & frame) = 0;
+
    /**
     * @brief render
     * @param ellapsedTime ellaspsed time from previous call
@@ -70,16 +107,46 @@ public:
       const glm::ivec2 & position,
       const glm::ivec3 & color = glm::ivec3(255)) = 0;
 
+   /**
+    * @brief Load image for icons. Each path is loaded only once,
+    * repeated calls return the same handle.
+    * @param[in] path path to image file
+    * @return handle of image or INVALID_IMAGE.
+    */
+   virtual tImageHandle loadImage(const std::string & path) = 0;
+
    /**
     * @brief Render icon at position.
-    * Support only icon with alpha channel (RGBA)
-    * @param[in] icon data of icon
+    * @param[in] image handle returned by loadImage()
     * @param[in] position position of icon
     */
    virtual void renderIcon(
-      const IconData & icon,
+      tImageHandle image,
       const glm::ivec2 & position) = 0;
 
+   /**
+    * @brief Draw everything queued by renderText() and renderIcon().
+    * Must be called once per frame before buffers swapping.
+    */
+   virtual void finishFrame() = 0;
+
+   /** @brief Get counters of the last frame finished by finishFrame(). */
+   virtual RenderStats getStats() const = 0;
+
+   /**
+    * @brief Enable preparation of binary frame for detector on GPU.
+    * @return false if it isn't supported.
+    */
+   virtual bool enablePreprocessing(bool enable) = 0;
+
+   /**
+    * @brief Get binary frame prepared on GPU for one of the previous frames.
+    * @param[out] binary dark pixels are 255, frame size divided by integer factor
+    * @param[out] source frame binary image was made from
+    * @return false if preprocessing is disabled or there is no new result.
+    */
+   virtual bool getPreprocessedFrame(cv::Mat & binary, cv::Mat & source) = 0;
+
    /** @brief Notify render about window resizing. */
    virtual void  resize(int width, int height) = 0;
 
@@ -3,28 +3,70 @@
 namespace NApp
 {
 
-static const char* SHADER_VERTEX_SOURCE =
-      "#version 120\n\n"
+/**
+ * Model shader. It has no #version line: CShaderLibrary prepends it with
+ * defines of variant (TEXTURED, SKINNED, LIT), so each variant compiles
+ * only the code it needs.
+ *
+ * Uniforms are declared once for both stages, so blocks match. With
+ * UNIFORM_BUFFERS frame constants and bones come from uniform buffers,
+ * layout of FrameConstants is the layout of C++ struct FrameConstants.
+ */
+static const char * MODEL_UNIFORMS_SOURCE =
+      "#ifdef UNIFORM_BUFFERS\n"
+      "layout(std140) uniform FrameConstants\n"
+      "{\n"
+      "  mat4 projectionMatrix;\n"
+      "  vec3 lightPosition;\n"
+      "  vec4 lightAmbientColor;\n"
+      "  vec4 lightDiffuseColor;\n"
+      "};\n"
       "\n"
+      "#ifdef SKINNED\n"
+      "layout(std140) uniform BonePalette\n"
+      "{\n"
+      "  mat4 boneMatrices[60];\n"
+      "};\n"
+      "#endif\n"
+      "#else\n"
       "uniform mat4 projectionMatrix;\n"
-      "uniform mat4 viewMatrix;\n"
-      "uniform mat4 modelMatrix;\n"
+      "uniform vec3 lightPosition;\n"
+      "uniform vec4 lightAmbientColor;\n"
+      "uniform vec4 lightDiffuseColor;\n"
+      "\n"
+      "#ifdef SKINNED\n"
       "uniform mat4 boneMatrices[60];\n"
+      "#endif\n"
+      "#endif\n"
       "\n"
+      "uniform mat4 modelMatrix;\n"
+      "\n";
+
+/** View matrix comes per instance: one draw renders model on all its markers. */
+static const char * MODEL_VERTEX_SOURCE =
       "attribute vec4 inPosition;\n"
-      "attribute vec3 inNormal;\n"
-      "attribute vec4 inColor;\n"
-      "attribute vec2 inTexCoord;\n"
+      "attribute mat4 inViewMatrix;\n"
+      "\n"
+      "#ifdef SKINNED\n"
       "attribute vec4 inBoneWeights;\n"
       "attribute vec4 inBoneIndices;\n"
+      "#endif\n"
+      "\n"
+      "#ifdef LIT\n"
+      "attribute vec3 inNormal;\n"
       "\n"
-      "varying vec4 worldPosition;\n"
       "varying vec3 worldNormal;\n"
-      "varying vec4 outColor;\n"
+      "#endif\n"
+      "\n"
+      "#ifdef TEXTURED\n"
+      "attribute vec2 inTexCoord;\n"
+      "\n"
       "varying vec2 outTexCoord;\n"
+      "#endif\n"
       "\n"
       "void main()\n"
       "{\n"
+      "#ifdef SKINNED\n"
       "  vec4 boneWeights = inBoneWeights;\n"
       "  boneWeights.w = 1.0 - dot(boneWeights.xyz, vec3(1.0, 1.0, 1.0));\n"
       "\n"
@@ -33,49 +75,144 @@ static const char* SHADER_VERTEX_SOURCE =
       "  transformMatrix += boneWeights.z * boneMatrices[int(inBoneIndices.z)];\n"
       "  transformMatrix += boneWeights.w * boneMatrices[int(inBoneIndices.w)];\n"
       "\n"
-      "  vec4 newPosition = transformMatrix * inPosition;\n"
-      "  vec4 newNormal = transformMatrix * vec4(inNormal, 0.0);\n"
-      "  worldNormal = (modelMatrix * newNormal).xyz;\n"
+      "  vec4 position = transformMatrix * inPosition;\n"
+      "#else\n"
+      "  vec4 position = inPosition;\n"
+      "#endif\n"
       "\n"
-      "  gl_Position = projectionMatrix * viewMatrix * modelMatrix * newPosition;\n"
-      "  worldPosition = modelMatrix * newPosition;\n"
-      "  outColor = inColor;\n"
+      "#ifdef LIT\n"
+      "#ifdef SKINNED\n"
+      "  vec4 normal = transformMatrix * vec4(inNormal, 0.0);\n"
+      "#else\n"
+      "  vec4 normal = vec4(inNormal, 0.0);\n"
+      "#endif\n"
+      "  worldNormal = (modelMatrix * normal).xyz;\n"
+      "#endif\n"
+      "\n"
+      "#ifdef TEXTURED\n"
       "  outTexCoord = inTexCoord;\n"
+      "#endif\n"
+      "\n"
+      "  gl_Position = projectionMatrix * inViewMatrix * modelMatrix * position;\n"
       "}\n";
 
-static const char * SHADER_FRAGMENT_SOURCE =
-      "#version 120\n\n"
-      "\n"
-      "uniform vec3 lightPosition;\n"
-      "uniform vec4 lightAmbientColor;\n"
-      "uniform vec4 lightDiffuseColor;\n"
-      "uniform int useTexture;\n"
+static const char * MODEL_FRAGMENT_SOURCE =
+      "#ifdef TEXTURED\n"
       "uniform sampler2D texture;\n"
       "\n"
-      "varying vec4 worldPosition;\n"
-      "varying vec3 worldNormal;\n"
-      "varying vec4 outColor;\n"
       "varying vec2 outTexCoord;\n"
+      "#else\n"
+      "uniform vec4 materialColor;\n"
+      "#endif\n"
+      "\n"
+      "#ifdef LIT\n"
+      "varying vec3 worldNormal;\n"
+      "#endif\n"
       "\n"
       "void main()\n"
       "{\n"
+      "#ifdef TEXTURED\n"
+      "  vec4 fragColor = texture2D(texture, outTexCoord);\n"
+      "#else\n"
+      "  vec4 fragColor = materialColor;\n"
+      "#endif\n"
+      "\n"
+      "#ifdef LIT\n"
       "  vec3 normal = normalize(worldNormal);\n"
-      "  vec3 position = worldPosition.xyz - worldPosition.w;\n"
       "  vec3 lightVector = normalize(lightPosition);\n"
-      "  vec4 fragColor;\n"
-      "  \n"
-      "  if (useTexture == 0)\n"
-      "  {\n"
-      "    fragColor = outColor;\n"
-      "  } else\n"
-      "  {\n"
-      "    fragColor = texture2D(texture, outTexCoord);\n"
-      "  }\n"
-      "  \n"
+      "\n"
       "  vec4 ambient = fragColor * lightAmbientColor;\n"
       "  vec4 diffuse = fragColor * lightDiffuseColor * max(0.0, dot(normal, lightVector));\n"
-      "  \n"
+      "\n"
       "  gl_FragColor = ambient + diffuse;\n"
+      "#else\n"
+      "  gl_FragColor = fragColor;\n"
+      "#endif\n"
+      "}\n";
+
+/** Fullscreen pass of frame preprocessing, position is in clip space. */
+static const char * PREPROCESS_VERTEX_SOURCE =
+      "#version 120\n\n"
+      "\n"
+      "attribute vec2 inPosition;\n"
+      "\n"
+      "varying vec2 outTexCoord;\n"
+      "\n"
+      "void main()\n"
+      "{\n"
+      "  outTexCoord = inPosition * 0.5 + 0.5;\n"
+      "  gl_Position = vec4(inPosition, 0.0, 1.0);\n"
+      "}\n";
+
+/** Downscaled grayscale of RGB camera frame. */
+static const char * PREPROCESS_GRAY_FRAGMENT_SOURCE =
+      "#version 120\n\n"
+      "\n"
+      "uniform sampler2D frame;\n"
+      "uniform vec2 texScale;\n"
+      "\n"
+      "varying vec2 outTexCoord;\n"
+      "\n"
+      "void main()\n"
+      "{\n"
+      "  vec3 color = texture2D(frame, outTexCoord * texScale).rgb;\n"
+      "  gl_FragColor = vec4(dot(color, vec3(0.299, 0.587, 0.114)));\n"
+      "}\n";
+
+/**
+ * Adaptive threshold of grayscale image, local mean is taken from mip level
+ * meanLevel. Dark pixels become 1.0.
+ */
+static const char * PREPROCESS_THRESHOLD_FRAGMENT_SOURCE =
+      "#version 120\n\n"
+      "\n"
+      "uniform sampler2D gray;\n"
+      "uniform float meanLevel;\n"
+      "uniform float offset;\n"
+      "\n"
+      "varying vec2 outTexCoord;\n"
+      "\n"
+      "void main()\n"
+      "{\n"
+      "  float value = texture2D(gray, outTexCoord).r;\n"
+      "  float mean = texture2D(gray, outTexCoord, meanLevel).r;\n"
+      "  gl_FragColor = vec4(step(value + offset, mean));\n"
+      "}\n";
+
+/**
+ * Textured 2D quads: background and overlays. Position is mapped to clip
+ * space by transform (xy - scale, zw - offset).
+ */
+static const char * QUAD_VERTEX_SOURCE =
+      "#version 120\n\n"
+      "\n"
+      "uniform vec4 transform;\n"
+      "\n"
+      "attribute vec2 inPosition;\n"
+      "attribute vec2 inTexCoord;\n"
+      "attribute vec4 inColor;\n"
+      "\n"
+      "varying vec2 outTexCoord;\n"
+      "varying vec4 outColor;\n"
+      "\n"
+      "void main()\n"
+      "{\n"
+      "  outTexCoord = inTexCoord;\n"
+      "  outColor = inColor;\n"
+      "  gl_Position = vec4(inPosition * transform.xy + transform.zw, 0.0, 1.0);\n"
+      "}\n";
+
+static const char * QUAD_FRAGMENT_SOURCE =
+      "#version 120\n\n"
+      "\n"
+      "uniform sampler2D texture;\n"
+      "\n"
+      "varying vec2 outTexCoord;\n"
+      "varying vec4 outColor;\n"
+      "\n"
+      "void main()\n"
+      "{\n"
+      "  gl_FragColor = texture2D(texture, outTexCoord) * outColor;\n"
       "}\n";
 
 } /* namespace NApp */
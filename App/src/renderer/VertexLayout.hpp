@@ -0,0 +1,220 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include "renderer/CShader.hpp"
+
+namespace NApp
+{
+
+/**
+ * Compile-time description of interleaved vertex formats.
+ *
+ * Layout is a list of Attribute<location, format>. From the list the
+ * packed vertex structure, the packing code and the attribute setup are
+ * generated, so they can't get out of sync:
+ *
+ *    typedef VertexLayout<
+ *       Attribute<VertexAttribute::POSITION, Float3Format>,
+ *       Attribute<VertexAttribute::NORMAL,   Snorm8x3Format> > tLayout;
+ *
+ *    tLayout::tVertex vertex;
+ *    tLayout::pack(source, vertex);
+ *    tLayout::setup(0);
+ */
+
+/** Unpacked values of one vertex, indexed by VertexAttribute::ELocation. */
+struct VertexSource
+{
+   glm::vec4 values[VertexAttribute::COUNT];
+};
+
+/** @{ Storage formats: packed type, its GL description and packing. */
+struct Float3Format
+{
+   struct tStorage { GLfloat v[3]; };
+
+   static const GLint SIZE = 3;
+   static const GLenum TYPE = GL_FLOAT;
+   static const GLboolean NORMALIZED = GL_FALSE;
+
+   static void pack(const glm::vec4 & value, tStorage & storage)
+   {
+      storage.v[0] = value.x;
+      storage.v[1] = value.y;
+      storage.v[2] = value.z;
+   }
+};
+
+/** Unit vector, 4th byte is padding. */
+struct Snorm8x3Format
+{
+   struct tStorage { GLbyte v[4]; };
+
+   static const GLint SIZE = 3;
+   static const GLenum TYPE = GL_BYTE;
+   static const GLboolean NORMALIZED = GL_TRUE;
+
+   static void pack(const glm::vec4 & value, tStorage & storage)
+   {
+      const glm::vec3 unit = glm::normalize(glm::vec3(value));
+      for (int i = 0; i < 3; ++i)
+      {
+         storage.v[i] = (GLbyte)glm::packSnorm1x8(unit[i]);
+      }
+      storage.v[3] = 0;
+   }
+};
+
+/** Requires GL 3.0 or ARB_half_float_vertex. */
+struct Half2Format
+{
+   struct tStorage { GLhalf v[2]; };
+
+   static const GLint SIZE = 2;
+   static const GLenum TYPE = GL_HALF_FLOAT;
+   static const GLboolean NORMALIZED = GL_FALSE;
+
+   static void pack(const glm::vec4 & value, tStorage & storage)
+   {
+      storage.v[0] = glm::packHalf1x16(value.x);
+      storage.v[1] = glm::packHalf1x16(value.y);
+   }
+};
+
+/** Small integers (indices), shader gets them as floats. */
+struct Ubyte4Format
+{
+   struct tStorage { GLubyte v[4]; };
+
+   static const GLint SIZE = 4;
+   static const GLenum TYPE = GL_UNSIGNED_BYTE;
+   static const GLboolean NORMALIZED = GL_FALSE;
+
+   static void pack(const glm::vec4 & value, tStorage & storage)
+   {
+      for (int i = 0; i < 4; ++i)
+      {
+         storage.v[i] = (GLubyte)glm::clamp(value[i], 0.f, 255.f);
+      }
+   }
+};
+
+/** Values in [0, 1] (weights). */
+struct Unorm16x4Format
+{
+   struct tStorage { GLushort v[4]; };
+
+   static const GLint SIZE = 4;
+   static const GLenum TYPE = GL_UNSIGNED_SHORT;
+   static const GLboolean NORMALIZED = GL_TRUE;
+
+   static void pack(const glm::vec4 & value, tStorage & storage)
+   {
+      for (int i = 0; i < 4; ++i)
+      {
+         storage.v[i] = glm::packUnorm1x16(value[i]);
+      }
+   }
+};
+/** @} */
+
+/** One attribute of layout. */
+template <VertexAttribute::ELocation LOCATION, typename FORMAT>
+struct Attribute
+{
+   typedef FORMAT tFormat;
+   typedef typename FORMAT::tStorage tStorage;
+
+   static const VertexAttribute::ELocation location = LOCATION;
+};
+
+/** Packed vertex: storages of attributes one after another. */
+template <typename... ATTRIBUTES>
+struct VertexData;
+
+template <typename HEAD>
+struct VertexData<HEAD>
+{
+   typename HEAD::tStorage head;
+
+   static const size_t PACKED_SIZE = sizeof(typename HEAD::tStorage);
+
+   void pack(const VertexSource & source)
+   {
+      HEAD::tFormat::pack(source.values[HEAD::location], head);
+   }
+
+   static void setup(GLsizei stride, GLintptr offset)
+   {
+      glEnableVertexAttribArray(HEAD::location);
+      glVertexAttribPointer(
+         HEAD::location,
+         HEAD::tFormat::SIZE, HEAD::tFormat::TYPE, HEAD::tFormat::NORMALIZED,
+         stride, (const GLvoid *)offset);
+   }
+
+   static void disable()
+   {
+      glDisableVertexAttribArray(HEAD::location);
+   }
+};
+
+template <typename HEAD, typename... TAIL>
+struct VertexData<HEAD, TAIL...>
+{
+   typename HEAD::tStorage head;
+   VertexData<TAIL...> tail;
+
+   static const size_t PACKED_SIZE = sizeof(typename HEAD::tStorage) + VertexData<TAIL...>::PACKED_SIZE;
+
+   void pack(const VertexSource & source)
+   {
+      HEAD::tFormat::pack(source.values[HEAD::location], head);
+      tail.pack(source);
+   }
+
+   static void setup(GLsizei stride, GLintptr offset)
+   {
+      VertexData<HEAD>::setup(stride, offset);
+      VertexData<TAIL...>::setup(stride, offset + sizeof(typename HEAD::tStorage));
+   }
+
+   static void disable()
+   {
+      VertexData<HEAD>::disable();
+      VertexData<TAIL...>::disable();
+   }
+};
+
+/** Interleaved layout of attributes. */
+template <typename... ATTRIBUTES>
+struct VertexLayout
+{
+   typedef VertexData<ATTRIBUTES...> tVertex;
+
+   static const GLsizei STRIDE = sizeof(tVertex);
+
+   static_assert(sizeof(tVertex) == tVertex::PACKED_SIZE, "Vertex layout must not have padding.");
+
+   /** Pack values of one vertex. */
+   static void pack(const VertexSource & source, tVertex & vertex)
+   {
+      vertex.pack(source);
+   }
+
+   /** Enable attributes of bound vertex buffer. */
+   static void setup(GLintptr offset)
+   {
+      tVertex::setup(STRIDE, offset);
+   }
+
+   /** Disable attributes of layout. */
+   static void disable()
+   {
+      tVertex::disable();
+   }
+};
+
+} /* namespace NApp */